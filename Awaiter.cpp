@@ -0,0 +1,242 @@
+/**
+ * @file      Awaiter.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `Awaiter` object and its descendants.
+ */
+
+#include <coroutine>       // for coroutine_handle
+#include <cstdint>         // for uint32_t
+#include <exception>       // for current_exception, rethrow_exception
+#include <memory>          // for shared_ptr
+#include <string>          // for string
+#include <string_view>     // for string_view
+#include <sys/epoll.h>     // for EPOLLIN, EPOLLOUT, EPOLLRDHUP
+#include <sys/socket.h>    // for SOCK_CLOEXEC, SOCK_NONBLOCK
+#include <utility>         // for exchange, move
+#include "Awaiter.hpp"     // for Awaiter, AcceptAwaiter, ReadAwaiter, ...
+#include "CFNetwork.hpp"   // for ConnectionClosed, ConnectionState
+#include "Connection.hpp"  // for Connection
+#include "EventLoop.hpp"   // for EventLoop
+#include "Socket.hpp"      // for Socket
+
+namespace CFNetwork {
+  /**
+   * `Awaiter` Constructor.
+   *
+   * @param loop       The `EventLoop` that resumes the awaiting coroutine
+   * @param descriptor The file descriptor that the operation waits for
+   * @param events     The `epoll(7)` event mask that the operation waits for
+   */
+  Awaiter::Awaiter(EventLoop& loop, int descriptor, uint32_t events) :
+    descriptor(descriptor), events(events), loop(loop) {}
+
+  /**
+   * `Awaiter` Destructor.
+   *
+   * If the awaiting coroutine is destroyed while suspended, its registration
+   * is removed from the `EventLoop` so that it can't be resumed.
+   */
+  Awaiter::~Awaiter() {
+    if (this->waiting) this->loop.remove(this->descriptor);
+  }
+
+  /**
+   * Determines whether or not the operation can complete without suspending.
+   *
+   * @return `true` if the operation completed (or failed), `false` otherwise.
+   */
+  bool Awaiter::await_ready() {
+    return this->complete();
+  }
+
+  /**
+   * Suspends the awaiting coroutine until the operation's file descriptor is
+   * ready.
+   *
+   * @param  handle The awaiting coroutine
+   */
+  void Awaiter::await_suspend(std::coroutine_handle<> handle) {
+    this->waiting = handle;
+    this->loop.await(this->descriptor, this->events, *this);
+  }
+
+  /**
+   * Attempts the operation, capturing any exception that it throws.
+   *
+   * @return `true` if the operation completed (or failed), `false` if it
+   *         would block.
+   */
+  bool Awaiter::complete() {
+    try {
+      return this->attempt();
+    }
+    catch (...) {
+      this->error = std::current_exception();
+      return true;
+    }
+  }
+
+  /**
+   * Attempts the operation again once its file descriptor is ready.
+   *
+   * The awaiting coroutine is resumed if the operation completed, otherwise
+   * the file descriptor is armed again. This method is invoked by the
+   * `EventLoop`.
+   */
+  void Awaiter::notify() {
+    if (!this->complete()) {
+      this->loop.await(this->descriptor, this->events, *this);
+      return;
+    }
+    std::exchange(this->waiting, {}).resume();
+  }
+
+  /**
+   * Rethrows the exception thrown by the operation (if any).
+   */
+  void Awaiter::rethrow() const {
+    if (this->error) std::rethrow_exception(this->error);
+  }
+
+  /**
+   * `AcceptAwaiter` Constructor.
+   *
+   * @param loop   The `EventLoop` that resumes the awaiting coroutine
+   * @param socket The `Socket` to accept a client on
+   */
+  AcceptAwaiter::AcceptAwaiter(EventLoop& loop, const Socket& socket) :
+    Awaiter(loop, socket.getDescriptor(), EPOLLIN), socket(socket) {}
+
+  /**
+   * Attempts to accept a client without blocking.
+   *
+   * @return `true` if a client was accepted, `false` otherwise.
+   */
+  bool AcceptAwaiter::attempt() {
+    this->client = this->socket.acceptClient(false,
+      SOCK_NONBLOCK | SOCK_CLOEXEC);
+    return static_cast<bool>(this->client);
+  }
+
+  /**
+   * Produces the accepted client.
+   *
+   * @return `Connection` object (in non-blocking mode) representing the
+   *         accepted client.
+   */
+  std::shared_ptr<Connection> AcceptAwaiter::await_resume() {
+    this->rethrow();
+    return std::move(this->client);
+  }
+
+  /**
+   * `ReadAwaiter` Constructor.
+   *
+   * @param loop       The `EventLoop` that resumes the awaiting coroutine
+   * @param connection The `Connection` to read from
+   * @param length     The maximum number of bytes to read
+   */
+  ReadAwaiter::ReadAwaiter(EventLoop& loop, Connection& connection,
+    size_t length) : Awaiter(loop, connection.getDescriptor(),
+    EPOLLIN | EPOLLRDHUP), connection(connection), length(length) {}
+
+  /**
+   * Attempts to read data without blocking.
+   *
+   * @return `true` if data was read or the remote peer finished sending,
+   *         `false` otherwise.
+   */
+  bool ReadAwaiter::attempt() {
+    std::string_view view = this->connection.readView(false, this->length);
+    if (view.empty())
+      return this->connection.getState() != ConnectionState::Open;
+    this->data.assign(view);
+    this->connection.consume(view.length());
+    return true;
+  }
+
+  /**
+   * Produces the data that was read.
+   *
+   * @return `std::string` of the data, which is empty if the remote peer
+   *         finished sending.
+   */
+  std::string ReadAwaiter::await_resume() {
+    this->rethrow();
+    return std::move(this->data);
+  }
+
+  /**
+   * `ReadDelimAwaiter` Constructor.
+   *
+   * @param loop       The `EventLoop` that resumes the awaiting coroutine
+   * @param connection The `Connection` to read from
+   * @param delim      The delimiter to read up to
+   */
+  ReadDelimAwaiter::ReadDelimAwaiter(EventLoop& loop, Connection& connection,
+    std::string delim) : Awaiter(loop, connection.getDescriptor(),
+    EPOLLIN | EPOLLRDHUP), connection(connection), delim(std::move(delim)) {}
+
+  /**
+   * Attempts to read a delimited message without blocking.
+   *
+   * @throws `ConnectionClosed` if the remote peer finished sending before the
+   *         delimiter was received.
+   *
+   * @return `true` if a message was read, `false` otherwise.
+   */
+  bool ReadDelimAwaiter::attempt() {
+    std::string_view view = this->connection.readDelimView(this->delim);
+    if (view.empty()) {
+      if (this->connection.getState() != ConnectionState::Open)
+        throw ConnectionClosed{"Connection closed by peer " +
+          this->connection.getRemote() + ":" +
+          std::to_string(this->connection.getPort()) +
+          " before the delimiter was received"};
+      return false;
+    }
+    this->data.assign(view);
+    this->connection.consume(view.length());
+    return true;
+  }
+
+  /**
+   * Produces the message that was read.
+   *
+   * @return `std::string` of the message (including the delimiter).
+   */
+  std::string ReadDelimAwaiter::await_resume() {
+    this->rethrow();
+    return std::move(this->data);
+  }
+
+  /**
+   * `WriteAwaiter` Constructor.
+   *
+   * @param loop       The `EventLoop` that resumes the awaiting coroutine
+   * @param connection The `Connection` to write to
+   */
+  WriteAwaiter::WriteAwaiter(EventLoop& loop, Connection& connection) :
+    Awaiter(loop, connection.getDescriptor(), EPOLLOUT),
+    connection(connection) {}
+
+  /**
+   * Attempts to write the queued data without blocking.
+   *
+   * @return `true` if all queued data was written, `false` otherwise.
+   */
+  bool WriteAwaiter::attempt() {
+    return this->connection.flush();
+  }
+
+  /**
+   * Completes the write.
+   *
+   * @throws `UnexpectedError` if the data couldn't be written.
+   */
+  void WriteAwaiter::await_resume() {
+    this->rethrow();
+  }
+}
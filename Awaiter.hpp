@@ -0,0 +1,195 @@
+/**
+ * @file      Awaiter.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Awaiter` object and its descendants.
+ */
+
+#ifndef _CFNETWORKAWAITER_H
+#define _CFNETWORKAWAITER_H
+
+#include <coroutine>      // for coroutine_handle
+#include <cstdint>        // for uint32_t
+#include <exception>      // for exception_ptr
+#include <memory>         // for shared_ptr
+#include <string>         // for string
+#include "CFNetwork.hpp"  // for Awaiter, Connection, EventLoop, Socket
+
+namespace CFNetwork {
+  /**
+   * @class Awaiter
+   * Suspends a coroutine until a non-blocking operation can complete.
+   *
+   * Each descendant describes a single operation using `attempt()`. When
+   * awaited, the operation is attempted immediately; if it can't complete
+   * without blocking, the awaiting coroutine is suspended and the operation's
+   * file descriptor is armed in the `EventLoop` as a one-shot registration.
+   * Each time the descriptor becomes ready the operation is attempted again,
+   * and the coroutine is resumed (on the `EventLoop`'s thread) once it
+   * completes. Exceptions thrown by the operation are rethrown into the
+   * awaiting coroutine.
+   *
+   * An `Awaiter` lives inside the suspended coroutine's frame, so arming and
+   * resuming it doesn't allocate memory. A file descriptor awaited by a
+   * coroutine must not also be registered with `EventLoop::add()`.
+   *
+   * The `Awaiter` object is not copyable or assignable since it is referred to
+   * by the `EventLoop` while suspended.
+   */
+  class Awaiter {
+    private:
+      Awaiter(const Awaiter&);
+      Awaiter& operator= (const Awaiter&);
+
+    protected:
+      /**
+       * @var descriptor
+       * The file descriptor that the operation waits for.
+       */
+      int                     descriptor = -1;
+      /**
+       * @var error
+       * The exception thrown by the operation (if any).
+       */
+      std::exception_ptr      error;
+      /**
+       * @var events
+       * The `epoll(7)` event mask that the operation waits for.
+       */
+      uint32_t                events     = 0;
+      /**
+       * @var loop
+       * The `EventLoop` that resumes the awaiting coroutine.
+       */
+      EventLoop&              loop;
+      /**
+       * @var waiting
+       * The suspended coroutine (if any).
+       */
+      std::coroutine_handle<> waiting;
+
+      Awaiter(EventLoop& loop, int descriptor, uint32_t events);
+      virtual bool attempt() = 0;
+      bool         complete();
+      void         rethrow()                                       const;
+
+    public:
+      virtual ~Awaiter();
+      bool await_ready();
+      void await_suspend(std::coroutine_handle<> handle);
+      void notify();
+  };
+
+  /**
+   * @class AcceptAwaiter
+   * Awaits a client on a `Socket`.
+   *
+   * @see `Socket::acceptAsync()` for more information.
+   */
+  class AcceptAwaiter : public Awaiter {
+    protected:
+      /**
+       * @var client
+       * The accepted client.
+       */
+      std::shared_ptr<Connection> client;
+      /**
+       * @var socket
+       * The `Socket` to accept a client on.
+       */
+      const Socket&               socket;
+
+      bool attempt() override;
+
+    public:
+      AcceptAwaiter(EventLoop& loop, const Socket& socket);
+      std::shared_ptr<Connection> await_resume();
+  };
+
+  /**
+   * @class ReadAwaiter
+   * Awaits data on a `Connection`.
+   *
+   * @see `Connection::readAsync()` for more information.
+   */
+  class ReadAwaiter : public Awaiter {
+    protected:
+      /**
+       * @var connection
+       * The `Connection` to read from.
+       */
+      Connection& connection;
+      /**
+       * @var data
+       * The data that was read.
+       */
+      std::string data;
+      /**
+       * @var length
+       * The maximum number of bytes to read.
+       */
+      size_t      length = 0;
+
+      bool attempt() override;
+
+    public:
+      ReadAwaiter(EventLoop& loop, Connection& connection, size_t length);
+      std::string await_resume();
+  };
+
+  /**
+   * @class ReadDelimAwaiter
+   * Awaits a delimited message on a `Connection`.
+   *
+   * @see `Connection::readDelimAsync()` for more information.
+   */
+  class ReadDelimAwaiter : public Awaiter {
+    protected:
+      /**
+       * @var connection
+       * The `Connection` to read from.
+       */
+      Connection& connection;
+      /**
+       * @var data
+       * The message that was read.
+       */
+      std::string data;
+      /**
+       * @var delim
+       * The delimiter to read up to.
+       */
+      std::string delim;
+
+      bool attempt() override;
+
+    public:
+      ReadDelimAwaiter(EventLoop& loop, Connection& connection,
+        std::string delim);
+      std::string await_resume();
+  };
+
+  /**
+   * @class WriteAwaiter
+   * Awaits the completion of queued writes on a `Connection`.
+   *
+   * @see `Connection::writeAsync()` for more information.
+   */
+  class WriteAwaiter : public Awaiter {
+    protected:
+      /**
+       * @var connection
+       * The `Connection` to write to.
+       */
+      Connection& connection;
+
+      bool attempt() override;
+
+    public:
+      WriteAwaiter(EventLoop& loop, Connection& connection);
+      void await_resume();
+  };
+}
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file      Buffer.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `Buffer` object.
+ */
+
+#include <cstring>           // for memcpy, memmove
+#include "Buffer.hpp"        // for Buffer
+#include "CFNetwork.hpp"     // for BufferLimitExceeded, InvalidArgument, ...
+#include "MemoryBudget.hpp"  // for MemoryBudget
+
+namespace CFNetwork {
+  /**
+   * `Buffer` Destructor.
+   *
+   * Upon destruction of a `Buffer` object, release its allocation (and return
+   * it to the `MemoryBudget`).
+   */
+  Buffer::~Buffer() {
+    this->clear();
+    this->shrink();
+  }
+
+  /**
+   * Appends a copy of the provided data to the end of the `Buffer`.
+   *
+   * @param data   A pointer to the data to append
+   * @param length The number of bytes to append
+   */
+  void Buffer::append(const char* data, size_t length) {
+    if (length == 0) return;
+    memcpy(this->prepare(length), data, length);
+    this->commit(length);
+  }
+
+  /**
+   * Discards the contents of the `Buffer` while retaining its allocation.
+   */
+  void Buffer::clear() {
+    this->head = this->tail = 0;
+  }
+
+  /**
+   * Marks bytes written to the space returned by `prepare()` as readable.
+   *
+   * @throws `InvalidArgument` if `length` exceeds the prepared space.
+   *
+   * @param  length The number of bytes that were written
+   */
+  void Buffer::commit(size_t length) {
+    if (length > this->capacity - this->tail)
+      throw InvalidArgument{"The committed length exceeds the buffer."};
+    this->tail += length;
+  }
+
+  /**
+   * Discards a prefix of the readable bytes in constant time.
+   *
+   * @throws `InvalidArgument` if `length` exceeds the size of the `Buffer`.
+   *
+   * @param  length The number of bytes to discard
+   */
+  void Buffer::consume(size_t length) {
+    if (length > this->size())
+      throw InvalidArgument{"The consumed length exceeds the buffer."};
+    this->head += length;
+    // Rewind to the start of the allocation for free once the buffer is empty
+    if (this->head == this->tail) this->head = this->tail = 0;
+  }
+
+  /**
+   * Fetches a pointer to the first readable byte of the `Buffer`.
+   *
+   * @return A pointer to `size()` readable bytes.
+   */
+  const char* Buffer::data() const {
+    return this->storage + this->head;
+  }
+
+  /**
+   * Determines whether or not the `Buffer` has any readable bytes.
+   *
+   * @return `true` if the `Buffer` is empty, `false` otherwise.
+   */
+  bool Buffer::empty() const {
+    return this->head == this->tail;
+  }
+
+  /**
+   * Fetches the size of the allocation associated with the `Buffer`.
+   *
+   * @return The capacity of the `Buffer` in bytes.
+   */
+  size_t Buffer::getCapacity() const {
+    return this->capacity;
+  }
+
+  /**
+   * Ensures that at least `length` bytes can be written after the readable
+   * bytes of the `Buffer`.
+   *
+   * @see    `tryPrepare()` for more information.
+   *
+   * @throws `BufferLimitExceeded` if the `Buffer` can't grow within the
+   *         `MemoryBudget`.
+   *
+   * @param  length The number of bytes that will be written
+   *
+   * @return        A pointer to at least `length` writable bytes.
+   */
+  char* Buffer::prepare(size_t length) {
+    char* space = this->tryPrepare(length);
+    if (space == nullptr)
+      throw BufferLimitExceeded{"The memory budget is exhausted."};
+    return space;
+  }
+
+  /**
+   * Releases the allocation of an empty `Buffer`.
+   *
+   * The allocation is returned to the heap (and the `MemoryBudget`) so that an
+   * idle `Buffer` doesn't keep holding memory after a burst of data. Calling
+   * this method on a `Buffer` that isn't empty has no effect.
+   */
+  void Buffer::shrink() {
+    if (!this->empty() || this->storage == nullptr) return;
+    delete[] this->storage;
+    MemoryBudget::release(this->capacity);
+    this->storage  = nullptr;
+    this->capacity = 0;
+  }
+
+  /**
+   * Fetches the number of readable bytes in the `Buffer`.
+   *
+   * @return The size of the `Buffer` in bytes.
+   */
+  size_t Buffer::size() const {
+    return this->tail - this->head;
+  }
+
+  /**
+   * Ensures that at least `length` bytes can be written after the readable
+   * bytes of the `Buffer` (if the `MemoryBudget` allows it).
+   *
+   * Space is reclaimed from the front of the allocation if at least half of it
+   * is free, otherwise the allocation is (at least) doubled after reserving
+   * the additional memory from the `MemoryBudget`. Data written to the
+   * returned space must be made readable using `commit()`.
+   *
+   * @param  length The number of bytes that will be written
+   *
+   * @return        A pointer to at least `length` writable bytes, or `nullptr`
+   *                if the `Buffer` can't grow within the `MemoryBudget` (in
+   *                which case it is left unchanged).
+   */
+  char* Buffer::tryPrepare(size_t length) {
+    if (this->capacity - this->tail >= length)
+      return this->storage + this->tail;
+    size_t used = this->size();
+    if (used + length <= this->capacity && used <= this->capacity / 2) {
+      // Moving the readable bytes is cheap relative to the consumed prefix
+      memmove(this->storage, this->data(), used);
+    }
+    else {
+      size_t capacity = this->capacity > 0 ? this->capacity * 2 : MAX_BYTES;
+      while (capacity < used + length) capacity *= 2;
+      if (!MemoryBudget::reserve(capacity - this->capacity)) return nullptr;
+      char* storage = new char[capacity];
+      if (used > 0) memcpy(storage, this->data(), used);
+      delete[] this->storage;
+      this->storage  = storage;
+      this->capacity = capacity;
+    }
+    this->head = 0;
+    this->tail = used;
+    return this->storage + this->tail;
+  }
+}
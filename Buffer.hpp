@@ -0,0 +1,82 @@
+/**
+ * @file      Buffer.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Buffer` object.
+ */
+
+#ifndef _CFNETWORKBUFFER_H
+#define _CFNETWORKBUFFER_H
+
+#include <cstddef>        // for size_t
+#include "CFNetwork.hpp"  // for MAX_BYTES
+
+namespace CFNetwork {
+  /**
+   * @class Buffer
+   * A growable, offset-tracked byte buffer.
+   *
+   * The `Buffer` object stores its readable bytes in the region between a head
+   * and a tail offset of a single allocation. Consuming a prefix only advances
+   * the head offset, so draining many small messages from a large backlog
+   * doesn't move the remaining data. Free space at the front of the allocation
+   * is reclaimed lazily: the readable bytes are only moved to the front when
+   * more space is needed and at least half of the allocation is free, which
+   * keeps the cost of each moved byte amortized constant.
+   *
+   * Each allocation is reserved from the process-wide `MemoryBudget`, and a
+   * `Buffer` that can't grow within the budget refuses the request instead of
+   * allocating.
+   *
+   * Pointers returned by `data()` and `prepare()` are invalidated by the next
+   * call to `append()`, `prepare()`, `shrink()` or `tryPrepare()`.
+   *
+   * The `Buffer` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class Buffer {
+    private:
+      Buffer(const Buffer&);
+      Buffer& operator= (const Buffer&);
+
+    protected:
+      /**
+       * @var capacity
+       * The size of the allocation associated with a `Buffer`.
+       */
+      size_t capacity = 0;
+      /**
+       * @var head
+       * The offset of the first readable byte in the `storage`.
+       */
+      size_t head     = 0;
+      /**
+       * @var storage
+       * The allocation holding the contents of a `Buffer`.
+       */
+      char*  storage  = nullptr;
+      /**
+       * @var tail
+       * The offset one past the last readable byte in the `storage`.
+       */
+      size_t tail     = 0;
+
+    public:
+      Buffer() = default;
+     ~Buffer();
+      void        append(const char* data, size_t length);
+      void        clear();
+      void        commit(size_t length);
+      void        consume(size_t length);
+      const char* data()                                const;
+      bool        empty()                               const;
+      size_t      getCapacity()                         const;
+      char*       prepare(size_t length);
+      void        shrink();
+      size_t      size()                                const;
+      char*       tryPrepare(size_t length);
+  };
+}
+
+#endif
@@ -6,22 +6,110 @@
  * Implementation source for the `CFNetwork` helper functions.
  */
 
-#include <cstring>        // for memcpy
+#include <arpa/inet.h>    // for inet_ntop
+#include <cstddef>        // for offsetof
+#include <cstring>        // for memcpy, strnlen
+#include <fcntl.h>        // for fcntl, F_GETFL, F_SETFL, O_NONBLOCK
 #include <netdb.h>        // for addrinfo, freeaddrinfo, getaddrinfo
+#include <netinet/in.h>   // for INET6_ADDRSTRLEN, sockaddr_in, sockaddr_in6
 #include <string>         // for string
-#include <sys/socket.h>   // for sockaddr_storage, AF_INET, AF_INET6
-#include "CFNetwork.hpp"  // for InvalidArgument
+#include <sys/socket.h>   // for sockaddr_storage, socklen_t, AF_INET, ...
+#include <sys/un.h>       // for sockaddr_un
+#include "CFNetwork.hpp"  // for InvalidArgument, UnexpectedError
 
 namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  namespace {
+    // Local socket names contain a `/` or start with `@`
+    bool isLocalName(const std::string& addr) {
+      return addr.find('/') != std::string::npos ||
+        addr.compare(0, 1, "@") == 0;
+    }
+  }
+  #endif
+
+  /**
+   * Determines the length of the populated part of a socket address, as
+   * expected by system calls such as `bind(2)` and `connect(2)`.
+   *
+   * The path (or abstract name) of an `AF_UNIX` address is measured up to its
+   * terminating null character, so the name of an address in the abstract
+   * namespace can't contain null characters.
+   *
+   * @param  address The address to measure
+   *
+   * @return `socklen_t` containing the length of the address.
+   */
+  socklen_t addressLength(const struct sockaddr_storage& address) {
+    if (address.ss_family == AF_INET)  return sizeof(struct sockaddr_in);
+    if (address.ss_family == AF_INET6) return sizeof(struct sockaddr_in6);
+    const struct sockaddr_un* local =
+      reinterpret_cast<const struct sockaddr_un*>(&address);
+    const size_t capacity = sizeof(local->sun_path);
+    size_t length = strnlen(local->sun_path, capacity);
+    // An abstract name follows a leading null character (an unnamed address
+    // consists of nothing but the family)
+    if (length == 0) {
+      length = strnlen(local->sun_path + 1, capacity - 1);
+      if (length > 0) ++length;
+    }
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) +
+      length);
+  }
+
+  /**
+   * Formats the address held by a `sockaddr_storage` structure as a
+   * `std::string`.
+   *
+   * This is the inverse of `parseAddress()`; the port (if any) is ignored and
+   * no reverse name resolution is performed. An `AF_UNIX` address is formatted
+   * as its path, as its name prefixed by `@` if it belongs to the abstract
+   * namespace, or as an empty string if it is unnamed (such as the address of
+   * a client that connected without binding).
+   *
+   * @throws `InvalidArgument` when an unexpected address family is
+   *         encountered.
+   *
+   * @param  address The address to format
+   *
+   * @return `std::string` containing the canonical IPv4/IPv6 address or the
+   *         local socket name.
+   */
+  std::string formatAddress(const struct sockaddr_storage& address) {
+    if (address.ss_family == AF_UNIX) {
+      const struct sockaddr_un* local =
+        reinterpret_cast<const struct sockaddr_un*>(&address);
+      size_t length = addressLength(address) -
+        offsetof(struct sockaddr_un, sun_path);
+      if (length == 0 || local->sun_path[0] != '\0')
+        return std::string(local->sun_path, length);
+      std::string name{"@"};
+      return name.append(local->sun_path + 1, length - 1);
+    }
+    if (address.ss_family != AF_INET && address.ss_family != AF_INET6)
+      throw InvalidArgument{"The address has an unexpected address family."};
+    struct sockaddr_storage copy = address;
+    // Determine the appropriate pointer type for the address
+    auto addrPtr = (copy.ss_family == AF_INET ? addr4(copy) : addr6(copy));
+    char addressString[INET6_ADDRSTRLEN + 1] = {};
+    return inet_ntop(copy.ss_family, addrPtr, addressString, INET6_ADDRSTRLEN);
+  }
+
   /**
    * Dynamically parse a `std::string` into a `sockaddr_storage` structure that
    * is capable of being used in socket operations.
    *
+   * Numeric IPv4 and IPv6 addresses are accepted, as are local (`AF_UNIX`)
+   * socket names: a string containing a `/` (such as `/run/app.sock` or
+   * `./app.sock`) refers to a filesystem path, while a string starting with
+   * `@` refers to the name following it in the abstract namespace.
+   *
    * The `struct sockaddr_storage` can be reinterpret cast into any of the
    * following structures (after checking the `ss_family` attribute):
    *   - `struct sockaddr`
    *   - `struct sockaddr_in`
    *   - `struct sockaddr_in6`
+   *   - `struct sockaddr_un`
    *
    * @throws `InvalidArgument` on failure or when an unexpected address family
    *         is encountered.
@@ -31,26 +119,79 @@ namespace CFNetwork {
   struct sockaddr_storage parseAddress(const std::string& addr) {
     // Declare storage for the results
     struct sockaddr_storage address = {};
+    // Upon failure to parse or unexpected address family, throw an exception
+    if (!tryParseAddress(addr, address))
+      throw InvalidArgument{isLocalName(addr) ?
+        "The provided local socket name is invalid." :
+        "Could not parse the provided address."};
+    return address;
+  }
+
+  /**
+   * Toggles the `O_NONBLOCK` status flag of the provided file descriptor.
+   *
+   * Non-blocking descriptors cause operations that would otherwise wait for
+   * the kernel to fail immediately with `EAGAIN`, which is required in order to
+   * multiplex many descriptors on a single thread (see `EventLoop`).
+   *
+   * @throws `UnexpectedError` if the descriptor's flags couldn't be changed.
+   *
+   * @param  descriptor The file descriptor to modify
+   * @param  blocking   Whether or not the descriptor should block
+   */
+  void setBlocking(int descriptor, bool blocking) {
+    int flags = fcntl(descriptor, F_GETFL);
+    if (flags < 0)
+      throw UnexpectedError{"Couldn't fetch the file descriptor flags."};
+    // Only issue the second system call if the flags actually need to change
+    int desired = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    if (desired != flags && fcntl(descriptor, F_SETFL, desired) < 0)
+      throw UnexpectedError{"Couldn't modify the file descriptor flags."};
+  }
+
+  /**
+   * Attempts to parse a `std::string` into a `sockaddr_storage` structure
+   * without throwing an exception.
+   *
+   * This is the non-throwing counterpart of `parseAddress()`, intended for
+   * callers (such as `Resolver`) that routinely probe strings which aren't
+   * addresses at all.
+   *
+   * @see    `parseAddress()` for more information regarding the accepted
+   *         addresses.
+   *
+   * @param  addr    The address to parse
+   * @param  address Storage for the parsed address
+   *
+   * @return `true` if the address was parsed, `false` otherwise.
+   */
+  bool tryParseAddress(const std::string& addr,
+      struct sockaddr_storage& address) {
+    address = {};
+    // Local socket names are copied verbatim (leaving room for the null
+    // character that terminates them)
+    if (isLocalName(addr)) {
+      struct sockaddr_un* local = reinterpret_cast<struct sockaddr_un*>(
+        &address);
+      if (addr.size() < 2 || addr.size() >= sizeof(local->sun_path) ||
+          addr.find('\0') != std::string::npos)
+        return false;
+      local->sun_family = AF_UNIX;
+      memcpy(local->sun_path, addr.data(), addr.size());
+      // The abstract namespace is selected by a leading null character
+      if (addr[0] == '@') local->sun_path[0] = '\0';
+      return true;
+    }
     struct addrinfo hints = {}, *res = nullptr;
     hints.ai_family = AF_UNSPEC;
     hints.ai_flags  = AI_NUMERICHOST;
-
-    // Upon failure to parse or unexpected address family, throw an exception
-    InvalidArgument ia{"Could not parse the provided address."};
     if (getaddrinfo(addr.c_str(), nullptr, &hints, &res) != 0 || res == nullptr)
-      throw ia;
-
-    if (res->ai_family != AF_INET && res->ai_family != AF_INET6) {
-      // Free the required storage for getaddrinfo(...)
-      freeaddrinfo(res);
-      throw ia;
-    }
-
-    // Copy the first address into the
-    memcpy(&address, res->ai_addr, res->ai_addrlen);
+      return false;
+    bool parsed = (res->ai_family == AF_INET || res->ai_family == AF_INET6);
+    // Copy the first address into the provided storage
+    if (parsed) memcpy(&address, res->ai_addr, res->ai_addrlen);
     // Free the required storage for getaddrinfo(...)
     freeaddrinfo(res);
-
-    return address;
+    return parsed;
   }
 }
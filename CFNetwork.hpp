@@ -11,7 +11,7 @@
 
 #include <stdexcept>     // for runtime_error
 #include <string>        // for string
-#include <sys/socket.h>  // for AF_INET, AF_INET6, SOCK_DGRAM, SOCK_STREAM, ...
+#include <sys/socket.h>  // for AF_INET, AF_INET6, AF_UNIX, SOCK_DGRAM, ...
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 // Define macros to help select the appropriate address family for things like
@@ -34,11 +34,43 @@
  */
 namespace CFNetwork {
   // Provide forward declaration of classes provided by this namespace
+  class AcceptAwaiter;
+  class Awaiter;
+  class Buffer;
   class Connection;
+  class ConnectionMetrics;
+  class ConnectionPool;
+  struct ConnectionStats;
+  class DatagramSocket;
+  class EventLoop;
+  class Framer;
+  class Histogram;
+  class MemoryBudget;
+  class Metrics;
+  struct MetricsSnapshot;
+  class ReadAwaiter;
+  class ReadDelimAwaiter;
+  class ShardedSocket;
+  class Resolver;
   class Socket;
+  class SocketMetrics;
+  struct SocketStats;
+  template <typename T> class SlabAllocator;
+  class SlabPool;
+  template <typename T> class Task;
+  class TimerWheel;
+  class TLSTransport;
+  class Transport;
+  class WriteAwaiter;
+  class WriteQueue;
 
   // Provide forward declaration of helper functions provided by this namespace
+  socklen_t               addressLength(const struct sockaddr_storage& address);
+  std::string             formatAddress(const struct sockaddr_storage& address);
   struct sockaddr_storage parseAddress(const std::string& addr);
+  void                    setBlocking(int descriptor, bool blocking);
+  bool                    tryParseAddress(const std::string& addr,
+                            struct sockaddr_storage& address);
 
   /**
    * @class InvalidArgument
@@ -60,6 +92,54 @@ namespace CFNetwork {
   class UnexpectedError : public std::runtime_error {
     using std::runtime_error::runtime_error; };
 
+  /**
+   * @class ConnectionClosed
+   * The `ConnectionClosed` exception can be thrown by methods in the
+   * `CFNetwork` namespace when the remote peer closes a connection before the
+   * requested data was received.
+   *
+   * This is a non-critical exception, and can safely be caught.
+   */
+  class ConnectionClosed : public UnexpectedError {
+    using UnexpectedError::UnexpectedError; };
+
+  /**
+   * @class ConnectionReset
+   * The `ConnectionReset` exception can be thrown by methods in the `CFNetwork`
+   * namespace when a connection is reset by the remote peer (`ECONNRESET`) or
+   * written to after the remote peer stopped reading (`EPIPE`).
+   *
+   * This is a non-critical exception, and can safely be caught.
+   */
+  class ConnectionReset : public UnexpectedError {
+    using UnexpectedError::UnexpectedError; };
+
+  /**
+   * @class ConnectionTimedOut
+   * The `ConnectionTimedOut` exception can be thrown by methods in the
+   * `CFNetwork` namespace when a connection couldn't be established, or data
+   * couldn't be read or written, before the applicable timeout expired.
+   *
+   * A `Connection` whose read or write timed out remains open (any data that
+   * was already received remains buffered), so this is a non-critical
+   * exception, and can safely be caught.
+   */
+  class ConnectionTimedOut : public UnexpectedError {
+    using UnexpectedError::UnexpectedError; };
+
+  /**
+   * @class BufferLimitExceeded
+   * The `BufferLimitExceeded` exception can be thrown by methods in the
+   * `CFNetwork` namespace when receiving more data would exceed the buffer
+   * limit of a `Connection` or the process-wide `MemoryBudget`.
+   *
+   * The `Connection` remains open and its buffered data remains available, so
+   * this is a non-critical exception, and can safely be caught (although the
+   * peer responsible is usually best disconnected).
+   */
+  class BufferLimitExceeded : public UnexpectedError {
+    using UnexpectedError::UnexpectedError; };
+
   /**
    * @var MAX_BYTES
    * The maximum number of bytes that should be contained within all buffers in
@@ -67,6 +147,27 @@ namespace CFNetwork {
    */
   const int MAX_BYTES = 8192;
 
+  /**
+   * @enum BufferPolicy
+   * The `BufferPolicy` enum is responsible for communicating how a given
+   * `Connection` reacts when its buffer limit (or the `MemoryBudget`) prevents
+   * it from receiving more data.
+   */
+  enum class BufferPolicy {
+    /**
+     * @var Error
+     * Throw `BufferLimitExceeded` from the method that attempted to receive
+     * more data.
+     */
+    Error,
+    /**
+     * @var Pause
+     * Stop receiving data (leaving it queued in the kernel, which eventually
+     * slows the peer down) until buffered data is consumed.
+     */
+    Pause
+  };
+
   /**
    * @enum ConnectionFlow
    * The `ConnectionFlow` enum is responsible for communicating whether or not a
@@ -86,6 +187,37 @@ namespace CFNetwork {
     Outbound
   };
 
+  /**
+   * @enum ConnectionState
+   * The `ConnectionState` enum is responsible for communicating the lifecycle
+   * stage of a given `Connection`.
+   */
+  enum class ConnectionState {
+    /**
+     * @var Open
+     * The `Connection` can be read from and written to.
+     */
+    Open,
+    /**
+     * @var HalfClosed
+     * The remote peer finished sending (end of file was read), but the
+     * `Connection` can still be written to and buffered data can still be
+     * read.
+     */
+    HalfClosed,
+    /**
+     * @var Closed
+     * The file descriptor of the `Connection` was closed.
+     */
+    Closed,
+    /**
+     * @var Errored
+     * The `Connection` was closed after encountering an error (e.g. it was
+     * reset by the remote peer).
+     */
+    Errored
+  };
+
   /**
    * @enum SocketFamily
    * The `SocketFamily` enum is responsible for communicating which address
@@ -101,18 +233,33 @@ namespace CFNetwork {
      * @var IPv6
      * Refers to the `AF_INET6` socket family.
      */
-    IPv6 = AF_INET6
+    IPv6 = AF_INET6,
+    /**
+     * @var Unix
+     * Refers to the `AF_UNIX` socket family (local sockets addressed by a
+     * filesystem path or a name in the abstract namespace).
+     */
+    Unix = AF_UNIX
   };
 
-  // /*
-  //  * @enum SocketType
-  //  * The `SocketType` enum is responsible for communicating whether a given
-  //  * `Socket` object is using TCP or UDP as its transport.
-  //  */
-  // enum class SocketType {
-  //   TCP = SOCK_STREAM,
-  //   UDP = SOCK_DGRAM
-  // };
+  /**
+   * @enum SocketType
+   * The `SocketType` enum is responsible for communicating whether a given
+   * socket object is using TCP or UDP as its transport.
+   */
+  enum class SocketType {
+    /**
+     * @var TCP
+     * Refers to the `SOCK_STREAM` socket type (used by `Socket` and
+     * `Connection`).
+     */
+    TCP = SOCK_STREAM,
+    /**
+     * @var UDP
+     * Refers to the `SOCK_DGRAM` socket type (used by `DatagramSocket`).
+     */
+    UDP = SOCK_DGRAM
+  };
 }
 
 #endif
@@ -6,21 +6,42 @@
  * Implementation source for the `Connection` object.
  */
 
-#include <arpa/inet.h>     // for inet_ntop
+#include <arpa/inet.h>     // for inet_ntop, ntohs
 #include <cassert>         // for assert
-#include <cstring>         // for memset
+#include <chrono>          // for ceil, microseconds, milliseconds, stea...
+#include <cstring>         // for memcpy, memset
+#include <memory>          // for shared_ptr, unique_ptr
 #include <netinet/in.h>    // for INET_ADDRSTRLEN, INET6_ADDRSTRLEN, sockadd...
+#include <poll.h>          // for poll, pollfd, POLLOUT
 #include <string>          // for allocator, basic_string, operator+, to_string
-#include <sys/errno.h>     // for EBADF, errno
-#include <sys/fcntl.h>     // for fcntl, F_GETFD
-#include <sys/socket.h>    // for sockaddr_storage, AF_INET, AF_INET6
+#include <string_view>     // for string_view
+#include <sys/errno.h>     // for EAGAIN, ECONNRESET, EINTR, EPIPE, errno
+#include <sys/fcntl.h>     // for fcntl, splice, F_GETFD, O_NONBLOCK, ...
+#include <sys/sendfile.h>  // for sendfile
+#include <sys/socket.h>    // for sockaddr_storage, recvmsg, sendmsg, ...
+#include <sys/time.h>      // for timeval
+#include <sys/uio.h>       // for iovec
 #include <unistd.h>        // for close, read, write, ssize_t
-#include "CFNetwork.hpp"   // for InvalidArgument, parseAddress, SocketFamily
+#include <utility>         // for move
+#include <vector>          // for vector
+#include "Awaiter.hpp"     // for ReadAwaiter, ReadDelimAwaiter, WriteAwaiter
+#include "CFNetwork.hpp"   // for InvalidArgument, addressLength, format...
 #include "Connection.hpp"  // for Connection
+#include "EventLoop.hpp"   // for EventLoop
+#include "IOUring.hpp"     // for IOUring
+#include "Metrics.hpp"     // for ConnectionMetrics, Metrics
+#include "Probes.hpp"      // for CFNETWORK_PROBE
+#include "Scanner.hpp"     // for findDelimiter
+#include "Transport.hpp"   // for Transport
+#include "WriteQueue.hpp"  // for WriteQueue
 
 namespace CFNetwork {
   #ifndef DOXYGEN_SHOULD_SKIP_THIS
   const auto& read_fn = ::read;
+  // The maximum number of queued segments gathered into a single write
+  const int   max_segments = 256;
+  // The maximum number of descriptors accepted alongside a single read
+  const int   max_descriptors = 64;
   #endif
 
   /**
@@ -28,19 +49,22 @@ namespace CFNetwork {
    *
    * Allows for constructing a `Connection` object to an outbound endpoint.
    *
+   * The address may also be a local socket name (see `parseAddress()`), in
+   * which case the port is ignored (and reported as zero).
+   *
    * @param addr The address of the remote endpoint
    * @param port The port of the remote endpoint
    */
   Connection::Connection(const std::string& addr, int port) {
     // Set the ConnectionFlow type to Outbound
     this->flow = ConnectionFlow::Outbound;
-    // Ensure the validity of the provided port
-    if (port < 1 || port > 65535)
-      throw InvalidArgument{"The provided port number is out of range."};
     // Fetch a finalized sockaddr_storage for the given address
     struct sockaddr_storage address  = parseAddress(addr);
     // Use the appropriate setup helper depending on the address family
     if (address.ss_family == AF_INET || address.ss_family == AF_INET6) {
+      // Ensure the validity of the provided port
+      if (port < 1 || port > 65535)
+        throw InvalidArgument{"The provided port number is out of range."};
       // Assign the appropriate address family to describe the `Connection`
       this->family = (address.ss_family == AF_INET ?
         SocketFamily::IPv4 : SocketFamily::IPv6);
@@ -54,6 +78,11 @@ namespace CFNetwork {
       // Assign the port to the sockaddr struct
       *(this->family == SocketFamily::IPv4 ? port4(address) : port6(address)) =
         htons(this->port = port);
+      this->remote_address = address;
+    }
+    else if (address.ss_family == AF_UNIX) {
+      this->family         = SocketFamily::Unix;
+      this->remote_address = address;
     }
     else {
       // Remote address has an unexpected address family
@@ -63,16 +92,50 @@ namespace CFNetwork {
     // Setup the socket using the appropriate address family and type
     this->socket = ::socket(address.ss_family, SOCK_STREAM, 0);
     // Attempt to connect the socket to the remote address
-    if (connect(this->socket, addr_(address),
-        this->family == SocketFamily::IPv4 ?
-        sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6)) < 0) {
+    if (::connect(this->socket, addr_(address), addressLength(address)) < 0) {
       // A problem occurred, close the socket and throw an exception
-      close(this->socket);
-      throw UnexpectedError{"Couldn't connect to [" + this->remote + "]:" +
+      ::close(this->socket);
+      throw UnexpectedError{"Couldn't connect to [" + this->getRemote() + "]:" +
         std::to_string(this->port)};
     }
   }
 
+  /**
+   * `Connection` Constructor (outbound, with timeout).
+   *
+   * Allows for constructing a `Connection` object to an outbound endpoint
+   * without waiting longer than the provided timeout for the connection to be
+   * established. The `Connection` is in blocking mode once constructed.
+   *
+   * Like the read and write timeouts, a timeout of zero means that there is no
+   * limit, so the constructor waits indefinitely for the connection.
+   *
+   * The address may also be a local socket name (see `parseAddress()`), in
+   * which case the port is ignored (and reported as zero).
+   *
+   * @throws `InvalidArgument`    if the address, port or timeout is invalid.
+   * @throws `ConnectionTimedOut` if the connection couldn't be established
+   *                              before the timeout expired.
+   * @throws `UnexpectedError`    if the connection was refused (or failed for
+   *                              any other reason).
+   *
+   * @param  addr    The address of the remote endpoint
+   * @param  port    The port of the remote endpoint
+   * @param  timeout The maximum amount of time to wait for the connection (or
+   *                 zero to wait indefinitely)
+   */
+  Connection::Connection(const std::string& addr, int port,
+      std::chrono::milliseconds timeout) {
+    // Set the ConnectionFlow type to Outbound
+    this->flow = ConnectionFlow::Outbound;
+    // Fetch a finalized sockaddr_storage for the given address
+    std::vector<struct sockaddr_storage> candidates{parseAddress(addr)};
+    this->socket = Connection::connectAny(candidates, port, timeout,
+      std::chrono::milliseconds{0}, this->remote_address);
+    this->family = static_cast<SocketFamily>(this->remote_address.ss_family);
+    this->port   = (this->family == SocketFamily::Unix ? 0 : port);
+  }
+
   /**
    * `Connection` Constructor (inbound).
    *
@@ -96,7 +159,7 @@ namespace CFNetwork {
     // Store the provided socket file descriptor for the client
     this->socket = socket;
     // Ensure the validity of the provided socket
-    if (!this->valid())
+    if (this->socket < 0 || fcntl(this->socket, F_GETFD) < 0)
       throw InvalidArgument{"The provided socket file descriptor is invalid."};
     // Verify both addresses and assign them to their instance attributes
     struct sockaddr_storage laddress = parseAddress(laddr);
@@ -129,6 +192,112 @@ namespace CFNetwork {
     }
   }
 
+  /**
+   * `Connection` Constructor (inbound, raw addresses).
+   *
+   * Allows for constructing a `Connection` object from an inbound client file
+   * descriptor using the raw addresses reported by the kernel. Unlike the
+   * `std::string` based constructor, no addresses are parsed and no system
+   * calls are made; the addresses are only formatted once they are requested
+   * using `getListen()` or `getRemote()`. This makes the constructor suitable
+   * for accepting large numbers of clients.
+   *
+   * @throws `InvalidArgument` if the port, file descriptor or address families
+   *         are invalid.
+   *
+   * @param  laddr    The address of the local listening socket
+   * @param  raddr    The address of the remote client
+   * @param  port     The port of the listening socket that received the client
+   *                  (ignored for local sockets)
+   * @param  socket   The file descriptor for the client
+   * @param  blocking Whether or not the file descriptor is in blocking mode
+   */
+  Connection::Connection(const struct sockaddr_storage& laddr,
+      const struct sockaddr_storage& raddr, int port, int socket,
+      bool blocking) {
+    // Set the ConnectionFlow type to Inbound
+    this->flow = ConnectionFlow::Inbound;
+    // Determine if the listening and remote addresses are valid
+    if (laddr.ss_family != raddr.ss_family || (laddr.ss_family != AF_INET &&
+        laddr.ss_family != AF_INET6 && laddr.ss_family != AF_UNIX))
+      throw InvalidArgument{"The listen address and remote address have "
+        "differing or unexpected address families."};
+    // Ensure the validity of the provided port and socket
+    if (laddr.ss_family != AF_UNIX && (port < 1 || port > 65535))
+      throw InvalidArgument{"The provided port number is out of range."};
+    if (socket < 0)
+      throw InvalidArgument{"The provided socket file descriptor is invalid."};
+    // Assign the appropriate address family to describe the `Connection`
+    this->family         = static_cast<SocketFamily>(laddr.ss_family);
+    this->blocking       = blocking;
+    this->listen_address = laddr;
+    this->port           = (this->family == SocketFamily::Unix ? 0 : port);
+    this->remote_address = raddr;
+    this->socket         = socket;
+  }
+
+  /**
+   * `Connection` Constructor (outbound, connected).
+   *
+   * Allows for constructing a `Connection` object from an outbound file
+   * descriptor that has already been connected by `connectAny()`.
+   *
+   * @param raddr  The address of the remote endpoint
+   * @param port   The port of the remote endpoint
+   * @param socket The connected file descriptor
+   */
+  Connection::Connection(const struct sockaddr_storage& raddr, int port,
+      int socket) {
+    this->flow           = ConnectionFlow::Outbound;
+    this->family         = static_cast<SocketFamily>(raddr.ss_family);
+    this->port           = (this->family == SocketFamily::Unix ? 0 : port);
+    this->remote_address = raddr;
+    this->socket         = socket;
+  }
+
+  /**
+   * `Connection` Constructor (adopted).
+   *
+   * Allows for constructing a `Connection` object from a connected stream
+   * socket that was created elsewhere, such as a client accepted by another
+   * process and passed to this one using `receiveDescriptor()`. The addresses
+   * of both endpoints and the blocking mode are fetched from the kernel, and
+   * the `Connection` is considered inbound with the local port as its port.
+   *
+   * The `Connection` takes ownership of the file descriptor once constructed
+   * (the caller remains responsible for it if an exception is thrown).
+   *
+   * @throws `InvalidArgument` if the file descriptor isn't a connected stream
+   *         socket of a supported address family.
+   *
+   * @param  socket The connected file descriptor
+   */
+  Connection::Connection(int socket) {
+    struct sockaddr_storage laddr = {}, raddr = {};
+    socklen_t llength = sizeof(laddr), rlength = sizeof(raddr);
+    int type = 0;
+    socklen_t type_length = sizeof(int);
+    int flags = socket < 0 ? -1 : fcntl(socket, F_GETFL);
+    if (flags < 0 || getsockopt(socket, SOL_SOCKET, SO_TYPE, &type,
+        &type_length) < 0 || type != SOCK_STREAM ||
+        getsockname(socket, addr_(laddr), &llength) < 0 ||
+        getpeername(socket, addr_(raddr), &rlength) < 0)
+      throw InvalidArgument{"The provided socket file descriptor is invalid."};
+    if (laddr.ss_family != AF_INET && laddr.ss_family != AF_INET6 &&
+        laddr.ss_family != AF_UNIX)
+      throw InvalidArgument{"The provided socket has an unexpected address "
+        "family."};
+    this->flow           = ConnectionFlow::Inbound;
+    this->family         = static_cast<SocketFamily>(laddr.ss_family);
+    this->blocking       = (flags & O_NONBLOCK) == 0;
+    this->listen_address = laddr;
+    this->remote_address = raddr;
+    this->socket         = socket;
+    if (this->family != SocketFamily::Unix)
+      this->port = ntohs(*(this->family == SocketFamily::IPv4 ?
+        port4(laddr) : port6(laddr)));
+  }
+
   /**
    * `Connection` Destructor.
    *
@@ -136,8 +305,326 @@ namespace CFNetwork {
    * descriptor (if still valid).
    */
   Connection::~Connection() {
-    if (this->valid())
-      close(this->socket);
+    if (this->pipe_fds[0] >= 0) ::close(this->pipe_fds[0]);
+    if (this->pipe_fds[1] >= 0) ::close(this->pipe_fds[1]);
+    this->terminate(ConnectionState::Closed);
+  }
+
+  /**
+   * Applies the time remaining until a deadline as the timeout of the next
+   * blocking system call on the internal file descriptor.
+   *
+   * The kernel's timeout (`SO_RCVTIMEO` or `SO_SNDTIMEO`) is only modified
+   * when it differs from the remaining time by more than a millisecond, so an
+   * operation that completes without waiting rarely requires a system call.
+   * Without a deadline, any previously applied timeout is removed.
+   *
+   * @throws `ConnectionTimedOut` if the deadline has passed.
+   * @throws `UnexpectedError`    if the timeout couldn't be applied.
+   *
+   * @param  option   Either `SO_RCVTIMEO` or `SO_SNDTIMEO`
+   * @param  deadline The deadline of the current operation (or the maximum
+   *                  time point if it may wait indefinitely)
+   *
+   * @return `true` if the operation has a deadline (and should be retried if
+   *         the system call timed out early), `false` otherwise.
+   */
+  bool Connection::arm(int option,
+      std::chrono::steady_clock::time_point deadline) {
+    std::chrono::microseconds& armed = (option == SO_RCVTIMEO ?
+      this->read_armed : this->write_armed);
+    std::chrono::microseconds remaining{0};
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+      remaining = std::chrono::ceil<std::chrono::microseconds>(
+        deadline - std::chrono::steady_clock::now());
+      if (remaining.count() <= 0)
+        throw ConnectionTimedOut{std::string{option == SO_RCVTIMEO ?
+          "Timed out reading from " : "Timed out writing to "} +
+          this->getRemote() + ":" + std::to_string(this->port)};
+    }
+    std::chrono::microseconds slack = armed - remaining;
+    if ((remaining.count() == 0) != (armed.count() == 0) ||
+        slack > std::chrono::milliseconds{1} ||
+        slack < -std::chrono::milliseconds{1}) {
+      struct timeval value = {};
+      value.tv_sec  = static_cast<time_t>(remaining.count() / 1000000);
+      value.tv_usec = static_cast<suseconds_t>(remaining.count() % 1000000);
+      if (setsockopt(this->socket, SOL_SOCKET, option, &value,
+          sizeof(value)) < 0)
+        throw UnexpectedError{"Couldn't apply the timeout of " +
+          this->getRemote() + ":" + std::to_string(this->port)};
+      armed = remaining;
+    }
+    return remaining.count() != 0;
+  }
+
+  /**
+   * Closes the internal file descriptor.
+   *
+   * Any data that is still queued for writing is discarded. Calling this
+   * method on a `Connection` that is already closed has no effect.
+   */
+  void Connection::close() {
+    this->terminate(ConnectionState::Closed);
+  }
+
+  /**
+   * Calculates the deadline of an operation that begins now.
+   *
+   * Only a blocking `Connection` without an `IOUring` waits in a system call
+   * that the kernel can time out, so every other `Connection` is given no
+   * deadline.
+   *
+   * @param  timeout The read or write timeout of the `Connection`
+   *
+   * @return The point in time by which the operation must complete, or the
+   *         maximum time point if it may wait indefinitely.
+   */
+  std::chrono::steady_clock::time_point Connection::computeDeadline(
+      std::chrono::milliseconds timeout) const {
+    if (!this->blocking || this->ring || timeout.count() == 0)
+      return std::chrono::steady_clock::time_point::max();
+    return std::chrono::steady_clock::now() + timeout;
+  }
+
+  /**
+   * Connects to the first reachable address of a list of candidates.
+   *
+   * Each candidate must be an IPv4 or IPv6 address (e.g. all of the addresses
+   * that a host name resolved to) or a local socket name.
+   *
+   * @see    `connect(const std::vector<struct sockaddr_storage>&, int,
+   *         std::chrono::milliseconds, std::chrono::milliseconds)` for more
+   *         information regarding how candidates are attempted.
+   *
+   * @throws `InvalidArgument`    if any address, the port or the timeout is
+   *                              invalid.
+   * @throws `ConnectionTimedOut` if no candidate could be connected to before
+   *                              the timeout expired.
+   * @throws `UnexpectedError`    if every candidate failed before the timeout
+   *                              expired.
+   *
+   * @param  addrs         The candidate addresses of the remote endpoint
+   * @param  port          The port of the remote endpoint
+   * @param  timeout       The maximum amount of time to wait for a connection
+   *                       (or zero to wait indefinitely)
+   * @param  attempt_delay How long to wait for an attempt before racing it
+   *                       against the next candidate
+   *
+   * @return `Connection` object connected to the first responsive candidate.
+   */
+  std::shared_ptr<Connection> Connection::connect(
+      const std::vector<std::string>& addrs, int port,
+      std::chrono::milliseconds timeout,
+      std::chrono::milliseconds attempt_delay) {
+    std::vector<struct sockaddr_storage> candidates{};
+    candidates.reserve(addrs.size());
+    for (const std::string& addr : addrs)
+      candidates.push_back(parseAddress(addr));
+    return Connection::connect(candidates, port, timeout, attempt_delay);
+  }
+
+  /**
+   * Connects to the first reachable address of a list of candidates.
+   *
+   * Candidates are attempted following the "Happy Eyeballs" algorithm
+   * (RFC 8305): the list is reordered to alternate between address families
+   * (starting with the family of the first candidate), and a new connection
+   * attempt is started every `attempt_delay` (or as soon as the previous
+   * attempt fails) while earlier attempts remain in flight. The first attempt
+   * to succeed is kept and every other attempt is abandoned, so one
+   * unreachable address family doesn't delay the connection by more than
+   * `attempt_delay`.
+   *
+   * The port of each candidate is ignored in favor of `port` (which is itself
+   * ignored for local socket names). The resulting `Connection` is in
+   * blocking mode.
+   *
+   * Like the read and write timeouts, a timeout of zero means that there is no
+   * limit, so candidates are attempted until one of them succeeds or all of
+   * them fail.
+   *
+   * @throws `InvalidArgument`    if the port, the timeout or any address
+   *                              family is invalid.
+   * @throws `ConnectionTimedOut` if no candidate could be connected to before
+   *                              the timeout expired.
+   * @throws `UnexpectedError`    if every candidate failed before the timeout
+   *                              expired.
+   *
+   * @param  addrs         The candidate addresses of the remote endpoint
+   * @param  port          The port of the remote endpoint
+   * @param  timeout       The maximum amount of time to wait for a connection
+   *                       (or zero to wait indefinitely)
+   * @param  attempt_delay How long to wait for an attempt before racing it
+   *                       against the next candidate
+   *
+   * @return `Connection` object connected to the first responsive candidate.
+   */
+  std::shared_ptr<Connection> Connection::connect(
+      const std::vector<struct sockaddr_storage>& addrs, int port,
+      std::chrono::milliseconds timeout,
+      std::chrono::milliseconds attempt_delay) {
+    struct sockaddr_storage connected = {};
+    int socket = Connection::connectAny(addrs, port, timeout, attempt_delay,
+      connected);
+    return std::shared_ptr<Connection>{
+      new Connection{connected, port, socket}
+    };
+  }
+
+  /**
+   * Races non-blocking connection attempts to a list of candidates.
+   *
+   * @see    `connect(const std::vector<struct sockaddr_storage>&, int,
+   *         std::chrono::milliseconds, std::chrono::milliseconds)` for more
+   *         information regarding how candidates are attempted.
+   *
+   * @throws `InvalidArgument`    if no candidates were provided, any
+   *                              candidate has an unexpected address family,
+   *                              the port is invalid for an IPv4/IPv6
+   *                              candidate or the timeout is negative.
+   * @throws `ConnectionTimedOut` if no candidate could be connected to before
+   *                              the timeout expired.
+   * @throws `UnexpectedError`    if every candidate failed before the timeout
+   *                              expired.
+   *
+   * @param  candidates    The candidate addresses of the remote endpoint
+   * @param  port          The port of the remote endpoint
+   * @param  timeout       The maximum amount of time to wait for a connection
+   *                       (or zero to wait indefinitely)
+   * @param  attempt_delay How long to wait for an attempt before racing it
+   *                       against the next candidate
+   * @param  connected     Storage for the address that was connected to
+   *
+   * @return The connected file descriptor (in blocking mode).
+   */
+  int Connection::connectAny(
+      const std::vector<struct sockaddr_storage>& candidates, int port,
+      std::chrono::milliseconds timeout,
+      std::chrono::milliseconds attempt_delay,
+      struct sockaddr_storage& connected) {
+    typedef std::chrono::steady_clock clock;
+    if (candidates.empty())
+      throw InvalidArgument{"No candidate addresses were provided."};
+    if (timeout.count() < 0)
+      throw InvalidArgument{"The connection timeout is invalid."};
+    // Interleave the address families, starting with the first candidate's
+    std::vector<struct sockaddr_storage> ordered{}, primary{}, secondary{};
+    for (struct sockaddr_storage address : candidates) {
+      if (address.ss_family == AF_INET || address.ss_family == AF_INET6) {
+        if (port < 1 || port > 65535)
+          throw InvalidArgument{"The provided port number is out of range."};
+        *(address.ss_family == AF_INET ? port4(address) : port6(address)) =
+          htons(port);
+      }
+      else if (address.ss_family != AF_UNIX)
+        throw InvalidArgument{"The remote address has an unexpected address "
+          "family."};
+      (address.ss_family == candidates[0].ss_family ?
+        primary : secondary).push_back(address);
+    }
+    for (size_t i = 0; i < primary.size() || i < secondary.size(); ++i) {
+      if (i < primary.size())   ordered.push_back(primary[i]);
+      if (i < secondary.size()) ordered.push_back(secondary[i]);
+    }
+
+    // Track each attempt that is in flight alongside its candidate
+    std::vector<struct pollfd> attempts{};
+    std::vector<size_t> indices{};
+    // A timeout of zero imposes no deadline (like the read and write timeouts)
+    clock::time_point deadline   = timeout.count() == 0 ?
+      clock::time_point::max() : clock::now() + timeout;
+    clock::time_point next_start = clock::now();
+    size_t next = 0;
+    int winner = -1;
+    while (winner < 0) {
+      clock::time_point now = clock::now();
+      if (now >= deadline) break;
+      // Start the next attempt once it is due (or nothing else is in flight)
+      if (next < ordered.size() && (attempts.empty() || now >= next_start)) {
+        const struct sockaddr_storage& address = ordered[next];
+        socklen_t length = addressLength(address);
+        int descriptor = ::socket(address.ss_family,
+          SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (descriptor >= 0 && ::connect(descriptor, reinterpret_cast<const
+            struct sockaddr*>(&address), length) == 0) {
+          winner = descriptor;
+          indices.push_back(next);
+          attempts.push_back(pollfd{descriptor, POLLOUT, POLLOUT});
+        }
+        else if (descriptor >= 0 && errno == EINPROGRESS) {
+          indices.push_back(next);
+          attempts.push_back(pollfd{descriptor, POLLOUT, 0});
+          next_start = now + attempt_delay;
+        }
+        // The attempt failed immediately, so move on to the next candidate
+        else if (descriptor >= 0) ::close(descriptor);
+        ++next;
+        continue;
+      }
+      // No candidates remain and every attempt has failed
+      if (attempts.empty()) break;
+      // Wait for an attempt to finish, the next attempt or the deadline
+      clock::time_point until = deadline;
+      if (next < ordered.size() && next_start < until) until = next_start;
+      int wait = until == clock::time_point::max() ? -1 : static_cast<int>(
+        std::chrono::ceil<std::chrono::milliseconds>(until - now).count());
+      if (::poll(attempts.data(), attempts.size(), wait) < 0 && errno != EINTR)
+        break;
+      for (size_t i = 0; i < attempts.size() && winner < 0;) {
+        if (attempts[i].revents == 0) { ++i; continue; }
+        int error = 0;
+        socklen_t length = sizeof(int);
+        if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &error,
+            &length) == 0 && error == 0) {
+          winner = attempts[i].fd;
+          break;
+        }
+        // The attempt failed, so start the next attempt immediately
+        ::close(attempts[i].fd);
+        attempts.erase(attempts.begin() + static_cast<long>(i));
+        indices.erase(indices.begin() + static_cast<long>(i));
+        next_start = now;
+      }
+    }
+    // Abandon every attempt other than the winner
+    for (size_t i = 0; i < attempts.size(); ++i) {
+      if (attempts[i].fd == winner) connected = ordered[indices[i]];
+      else ::close(attempts[i].fd);
+    }
+    if (winner < 0) {
+      std::string message = "Couldn't connect to [" +
+        formatAddress(ordered[0]) + "]:" + std::to_string(port) +
+        (ordered.size() > 1 ? " (or " + std::to_string(ordered.size() - 1) +
+        " other candidates)" : "");
+      // Distinguish an unresponsive endpoint from one that refused each attempt
+      if (clock::now() >= deadline) throw ConnectionTimedOut{message};
+      throw UnexpectedError{message};
+    }
+    CFNetwork::setBlocking(winner, true);
+    return winner;
+  }
+
+  /**
+   * Discards a prefix of the internal buffer.
+   *
+   * This method is intended to be used with the view-based methods of this
+   * class (`peek()`, `readView()` and `readDelimView()`), which don't remove
+   * the data that they return. Discarding a prefix takes constant time and
+   * doesn't move the remaining data. The saved delimiter scan position is
+   * adjusted so that bytes which were already scanned won't be scanned again.
+   *
+   * @throws `InvalidArgument` if `length` exceeds the amount of buffered data.
+   *
+   * @param  length The number of bytes to discard
+   */
+  void Connection::consume(size_t length) {
+    this->buffer.consume(length);
+    // Return the memory of a buffer that grew for a burst of data
+    if (this->buffer.empty() && this->buffer.getCapacity() > MAX_BYTES * 4)
+      this->buffer.shrink();
+    this->scan_offset = this->scan_offset > length ?
+      this->scan_offset - length : 0;
   }
 
   /**
@@ -166,12 +653,43 @@ namespace CFNetwork {
    * data available to read. However, the amount of data that is enqueued is not
    * predictable.
    *
+   * If the `Connection` is in non-blocking mode, either type of request stops
+   * as soon as `read(2)` reports that no more data is available, so the return
+   * value may be less than `request_length` (including zero).
+   *
+   * An unreliable request on a blocking local (`AF_UNIX`) `Connection` that
+   * only receives the marker of a passed descriptor returns zero rather than
+   * waiting for data that may follow it; the descriptor can be claimed using
+   * `receiveDescriptor()`.
+   *
+   * If an `IOUring` is attached to the `Connection`, data is collected from a
+   * multishot receive request instead of calling `read(2)` (see
+   * `enqueueCompletions()`).
+   *
+   * Either type of request stops once the remote peer closes the connection,
+   * after which the `Connection` is half-closed and no more data is enqueued.
    * Each type of request can fail if the connection is reset by the remote peer
    * and an exception will be thrown.
    *
-   * @throws `InvalidArgument` if the `Connection` is invalid or the requested
-   *                           length is invalid.
-   * @throws `UnexpectedError` if the `Connection` was reset by peer.
+   * Neither type of request grows the internal buffer beyond the limit set
+   * using `setBufferLimit()` or beyond the `MemoryBudget`. Once either would
+   * be exceeded, the request either throws `BufferLimitExceeded` or stops
+   * early and pauses (see `isPaused()`), depending on the `BufferPolicy`.
+   *
+   * If a read timeout was set using `setReadTimeout()`, a blocking request
+   * that can't be completed before it expires throws `ConnectionTimedOut`
+   * (keeping any data that was enqueued in the meantime).
+   *
+   * @see    `getState()` to distinguish the end of the data from a lack of
+   *                      available data.
+   *
+   * @throws `InvalidArgument`     if the `Connection` is invalid or the
+   *                               requested length is invalid.
+   * @throws `BufferLimitExceeded` if the buffer limit or `MemoryBudget` was
+   *                               reached using `BufferPolicy::Error`.
+   * @throws `ConnectionTimedOut`  if the read timeout expired.
+   * @throws `ConnectionReset`     if the `Connection` was reset by peer.
+   * @throws `UnexpectedError`     if any other error occurred.
    *
    * @param  reliable       Whether or not the request should be reliable (true)
    *                        or unreliable (false)
@@ -182,6 +700,28 @@ namespace CFNetwork {
    *                        internal buffer.
    */
   size_t Connection::enqueueData(bool reliable, size_t request_length) {
+    return this->enqueueData(reliable, request_length,
+      this->computeDeadline(this->read_timeout));
+  }
+
+  /**
+   * Enqueue data from the internal file descriptor to the internal buffer
+   * before the provided deadline.
+   *
+   * @see    `enqueueData(bool, size_t)` for more information.
+   *
+   * @param  reliable       Whether or not the request should be reliable (true)
+   *                        or unreliable (false)
+   * @param  request_length The total number of bytes to enqueue to the internal
+   *                        buffer
+   * @param  deadline       The point in time by which a blocking request must
+   *                        complete (or the maximum time point)
+   *
+   * @return                The number of bytes that were enqueued to the
+   *                        internal buffer.
+   */
+  size_t Connection::enqueueData(bool reliable, size_t request_length,
+      std::chrono::steady_clock::time_point deadline) {
     assert(MAX_BYTES > 0);
     // Check if the requested length is valid
     if (request_length == 0)
@@ -192,45 +732,307 @@ namespace CFNetwork {
      size_t read_length = request_length = (reliable ? request_length :
        (request_length < MAX_BYTES ? request_length : MAX_BYTES));
     ssize_t return_val  = 0;
+    bool    passed      = false;
     // Check if the file descriptor is valid
     if (!this->valid())
       throw InvalidArgument{"The socket file descriptor is invalid."};
+    // No more data will arrive once the remote peer finished sending
+    if (this->state == ConnectionState::HalfClosed)
+      return 0;
+    // Defer to the `IOUring` backend if one is attached
+    if (this->ring) {
+      size_t enqueued = this->enqueueCompletions(reliable, read_length);
+      CFNETWORK_PROBE(enqueue, this->socket, request_length, enqueued);
+      return enqueued;
+    }
     // Only attempt to enqueue data if a request for more than 0 bytes was made
     if (read_length > 0) do {
-      // Prepare a zero-filled buffer to temporarily store the incoming data
-      // from the upcoming call to `read(2)`
-      unsigned char buffer[MAX_BYTES] = {};
       // Read up to `MAX_BYTES` or `read_length` bytes (whichever is smallest)
-      // from the file descriptor
-      return_val = read_fn(this->socket, buffer, read_length <= MAX_BYTES ?
-        read_length : MAX_BYTES);
-      // If the `read(2)` system call was successful (>= 0) then process the
-      // data that was temporarily stored in the buffer
-      if (return_val >= 0) {
+      // from the file descriptor directly into the internal buffer (retrying
+      // if interrupted by a signal)
+      size_t chunk = read_length <= MAX_BYTES ? read_length : MAX_BYTES;
+      char*  space = this->reserve(chunk);
+      // The buffer limit (or the `MemoryBudget`) was reached, so pause
+      if (space == nullptr) break;
+      // Don't let the kernel wait beyond the deadline (retrying if the wait
+      // ended early)
+      this->arm(SO_RCVTIMEO, deadline);
+      do return_val = this->receive(space, chunk, passed);
+      while (return_val < 0 && (errno == EINTR || ((errno == EAGAIN ||
+        errno == EWOULDBLOCK) && this->arm(SO_RCVTIMEO, deadline))));
+      // A non-blocking `Connection` has drained all available data (as has a
+      // blocking `Connection` whose receive timeout expired)
+      if (return_val < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        this->metrics.countBlockedRead();
+        break;
+      }
+      // The remote peer closed the connection, so no more data will arrive
+      if (return_val == 0) {
+        this->metrics.countRead(0);
+        this->state = ConnectionState::HalfClosed;
+        break;
+      }
+      // If the `read(2)` system call was successful then process the data that
+      // was stored in the internal buffer
+      if (return_val > 0) {
         // Cast the return value to an unsigned `size_t` type to measure the
-        // amount of data that was read
-        size_t data_read = static_cast<size_t>(return_val);
-        // Append the data that was read to the internal buffer using the return
-        // value of the `read(2)` system call as the data size
-        this->buffer    += std::string{reinterpret_cast<const char*>(buffer),
-                                       data_read};
+        // amount of data that was read (excluding the marker byte of passed
+        // descriptors)
+        size_t data_read = static_cast<size_t>(return_val) - (passed ? 1 : 0);
+        // Mark the data that was read as part of the internal buffer using the
+        // return value of the `read(2)` system call as the data size
+        this->buffer.commit(data_read);
+        this->metrics.countRead(data_read);
+        this->metrics.observeBuffer(this->buffer.size());
         // Adjust the appropriate counters using the return value of this
         // iteration's call to `read(2)`
         read_length     -= data_read;
-      } else {
-        // Close the internal file descriptor
-        close(this->socket);
-        // Throw an exception explaining the error
-        throw UnexpectedError{"Connection reset by peer " + this->remote +
-          ":" + std::to_string(this->port)};
       }
+      // Close the internal file descriptor and throw an exception explaining
+      // the error
+      else this->fail(errno, "Couldn't read from");
     // Continue looping if trying to read in a reliable fashion and there is
-    // still data to read
-    } while (reliable && return_val >= 0 && read_length > 0);
+    // still data to read, or if a non-blocking read only received the marker
+    // byte of passed descriptors (more data may be waiting behind it, and
+    // looking for it never waits)
+    } while ((reliable && read_length > 0) ||
+      (passed && return_val == 1 && !this->blocking));
     // Return the total length of data that was enqueued to the internal buffer
+    CFNETWORK_PROBE(enqueue, this->socket, request_length,
+      request_length - read_length);
     return request_length - read_length;
   }
 
+  /**
+   * Enqueue data from the attached `IOUring` to the internal buffer.
+   *
+   * A multishot receive request is armed on the internal file descriptor (if
+   * one isn't already outstanding) and its completions are copied from the
+   * kernel-provided buffers to the internal buffer. Since each completion
+   * carries whatever data was received, more than `request_length` bytes may
+   * be enqueued.
+   *
+   * Reliable requests wait for completions until at least `request_length`
+   * bytes have been enqueued. Unreliable requests wait for (at most) one
+   * completion. Non-blocking requests never wait.
+   *
+   * @throws `ConnectionReset` if the `Connection` was reset by peer.
+   * @throws `UnexpectedError` if any other error occurred.
+   *
+   * @param  reliable       Whether or not the request should be reliable (true)
+   *                        or unreliable (false)
+   * @param  request_length The minimum number of bytes to enqueue to the
+   *                        internal buffer
+   *
+   * @return                The number of bytes that were enqueued to the
+   *                        internal buffer.
+   */
+  size_t Connection::enqueueCompletions(bool reliable, size_t request_length) {
+    size_t enqueued = 0;
+    do {
+      // Ensure that a whole completion will fit before claiming one, since a
+      // claimed completion can't be returned to the ring
+      size_t room = this->ring->getBufferSize();
+      if (this->reserve(room, false) == nullptr) break;
+      // Arm a multishot receive request if one isn't already outstanding
+      if (!this->ring_armed) {
+        this->ring->prepareReceive(this->socket, this->ring_token);
+        this->ring_armed = true;
+      }
+      // Claim the next completion (if any) from the ring
+      IOUring::Completion completion = {};
+      if (this->blocking)
+        completion = this->ring->wait(this->ring_token);
+      else if (!this->ring->poll(this->ring_token, completion))
+        break;
+      if (!(completion.flags & IORING_CQE_F_MORE))
+        this->ring_armed = false;
+      if (completion.result > 0) {
+        // Copy the received data before returning its buffer to the kernel
+        size_t data_read = static_cast<size_t>(completion.result);
+        this->buffer.append(this->ring->getBuffer(completion), data_read);
+        enqueued        += data_read;
+        this->metrics.countRead(data_read);
+        this->metrics.observeBuffer(this->buffer.size());
+      }
+      this->ring->recycle(completion);
+      // The remote peer closed the connection, so no more data will arrive
+      if (completion.result == 0) {
+        this->metrics.countRead(0);
+        this->state = ConnectionState::HalfClosed;
+        break;
+      }
+      // The kernel ran out of provided buffers and will need to be re-armed
+      if (completion.result == -ENOBUFS) continue;
+      // Cancel the request, close the internal file descriptor and throw an
+      // exception explaining the error
+      if (completion.result < 0)
+        this->fail(-completion.result, "Couldn't read from");
+    } while (reliable && enqueued < request_length);
+    return enqueued;
+  }
+
+  /**
+   * Closes the internal file descriptor after an error and throws an exception
+   * describing it.
+   *
+   * Errors caused by the remote peer (`ECONNRESET` and `EPIPE`) are reported
+   * using `ConnectionReset`, while any other error is reported using
+   * `UnexpectedError`.
+   *
+   * @throws `ConnectionReset` if the connection was reset by the remote peer.
+   * @throws `UnexpectedError` if any other error occurred.
+   *
+   * @param  error  The `errno` value describing the error
+   * @param  action A description of the failed operation
+   */
+  void Connection::fail(int error, const std::string& action) {
+    std::string endpoint = this->getRemote() + ":" + std::to_string(this->port);
+    this->terminate(ConnectionState::Errored);
+    if (error == ECONNRESET || error == EPIPE)
+      throw ConnectionReset{"Connection reset by peer " + endpoint};
+    throw UnexpectedError{action + " " + endpoint};
+  }
+
+  /**
+   * Attempts to write all queued data to the internal file descriptor.
+   *
+   * Queued segments are gathered into as few `sendmsg(2)` system calls as
+   * possible. Partial writes are handled by resuming from the first unwritten
+   * byte, so no data is lost when the kernel accepts less than requested.
+   *
+   * In blocking mode this method returns once all queued data was written. In
+   * non-blocking mode it returns as soon as the kernel's send buffer is full,
+   * leaving the remaining data queued; `flush()` should be called again once
+   * the `Connection` becomes writable (e.g. from an `EventLoop` callback).
+   *
+   * If an `IOUring` is attached to the `Connection`, each write is submitted
+   * to the ring as a send request instead. A non-blocking `Connection` doesn't
+   * wait for the request to complete: `flush()` returns `false` until a later
+   * call claims its completion from the ring.
+   *
+   * If a write timeout was set using `setWriteTimeout()`, a blocking
+   * `Connection` throws `ConnectionTimedOut` if the data couldn't be written
+   * before it expired (leaving the unwritten data queued).
+   *
+   * @throws `InvalidArgument`    if the internal file descriptor is
+   *                              considered invalid.
+   * @throws `ConnectionTimedOut` if the write timeout expired.
+   * @throws `UnexpectedError`    if the write fails (e.g. the connection was
+   *                              reset by peer).
+   *
+   * @return `true` if all queued data was written, `false` otherwise.
+   */
+  bool Connection::flush() {
+    if (!this->valid())
+      throw InvalidArgument{"The socket file descriptor is invalid."};
+    std::chrono::steady_clock::time_point deadline = this->outbound.empty() ?
+      std::chrono::steady_clock::time_point::max() :
+      this->computeDeadline(this->write_timeout);
+    if (!this->outbound.empty()) this->metrics.beginFlush();
+    while (!this->outbound.empty()) {
+      size_t  requested = 0;
+      ssize_t written;
+      if (this->ring) {
+        // Submit the next send request unless one is still in flight (its
+        // message must outlive this call, so it's kept by the `Connection`)
+        if (!this->ring_sending) {
+          this->ring_iov.resize(max_segments);
+          this->ring_message            = {};
+          this->ring_message.msg_iov    = this->ring_iov.data();
+          this->ring_message.msg_iovlen = static_cast<size_t>(
+            this->outbound.gather(this->ring_iov.data(), max_segments));
+          this->ring->prepareSendMessage(this->socket, &this->ring_message,
+            this->ring_token + 1);
+          this->ring_sending = true;
+        }
+        for (size_t i = 0; i < this->ring_message.msg_iovlen; ++i)
+          requested += this->ring_iov[i].iov_len;
+        // Claim the completion of the send request (without waiting for it
+        // when in non-blocking mode)
+        IOUring::Completion completion = {};
+        if (this->blocking)
+          completion = this->ring->wait(this->ring_token + 1);
+        else if (!this->ring->poll(this->ring_token + 1, completion)) {
+          this->metrics.countBlockedWrite();
+          return false;
+        }
+        this->ring_sending = false;
+        written = completion.result;
+        if (written < 0) {
+          errno   = static_cast<int>(-written);
+          written = -1;
+        }
+      }
+      else {
+        struct iovec iov[max_segments];
+        struct msghdr message = {};
+        message.msg_iov    = iov;
+        message.msg_iovlen = static_cast<size_t>(
+          this->outbound.gather(iov, max_segments));
+        for (size_t i = 0; i < message.msg_iovlen; ++i)
+          requested += iov[i].iov_len;
+        this->arm(SO_SNDTIMEO, deadline);
+        do written = this->transport ? this->transport->send(iov,
+          static_cast<int>(message.msg_iovlen)) :
+          sendmsg(this->socket, &message, MSG_NOSIGNAL);
+        while (written < 0 && (errno == EINTR || ((errno == EAGAIN ||
+          errno == EWOULDBLOCK) && this->arm(SO_SNDTIMEO, deadline))));
+      }
+      if (written < 0) {
+        // The kernel's send buffer is full, so try again when writable
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          this->metrics.countBlockedWrite();
+          return false;
+        }
+        // Close the internal file descriptor and throw an exception explaining
+        // the error
+        this->fail(errno, "Couldn't write to");
+      }
+      this->metrics.countWrite(static_cast<size_t>(written), requested);
+      CFNETWORK_PROBE(send, this->socket, written);
+      this->outbound.advance(static_cast<size_t>(written));
+    }
+    this->metrics.endFlush();
+    return true;
+  }
+
+  /**
+   * Writes any queued data from a coroutine without blocking its thread.
+   *
+   * Awaiting the result suspends the coroutine until all queued data has been
+   * accepted by the kernel.
+   *
+   * @see    `writeAsync()` for more information.
+   *
+   * @param  loop The `EventLoop` that resumes the awaiting coroutine
+   *
+   * @return `WriteAwaiter` that completes once the data has been written.
+   */
+  WriteAwaiter Connection::flushAsync(EventLoop& loop) {
+    this->prepareAwait();
+    return WriteAwaiter{loop, *this};
+  }
+
+  /**
+   * Fetches the maximum number of bytes that the internal buffer may hold.
+   *
+   * @return The buffer limit in bytes.
+   */
+  size_t Connection::getBufferLimit() const {
+    return this->buffer_limit;
+  }
+
+  /**
+   * Fetches how the `Connection` reacts once its buffer limit (or the
+   * `MemoryBudget`) is reached.
+   *
+   * @return `BufferPolicy` of the `Connection`.
+   */
+  BufferPolicy Connection::getBufferPolicy() const {
+    return this->buffer_policy;
+  }
+
   /**
    * Fetches the file descriptor of the `Connection` instance.
    *
@@ -268,18 +1070,40 @@ namespace CFNetwork {
   /**
    * Fetches the listening address of the `Connection` instance.
    *
-   * This method will produce a `std::string` of an IPv4/IPv6 address only (no
-   * IP addresses will be reverse resolved into hostnames).
+   * This method will produce a `std::string` of an IPv4/IPv6 address or a
+   * local socket name only (no IP addresses will be reverse resolved into
+   * hostnames).
    *
    * In the context of an outbound `Connection`, the resulting value will be an
    * empty `std::string`.
    *
+   * The address is formatted on first use, so the first call should not race
+   * with other threads calling this method on the same `Connection`.
+   *
    * @return `std::string` containing the listening address.
    */
   const std::string& Connection::getListen() const {
+    if (this->listen.empty() && this->listen_address.ss_family != AF_UNSPEC)
+      this->listen = formatAddress(this->listen_address);
     return this->listen;
   }
 
+  /**
+   * Fetches the metrics of the `Connection` instance.
+   *
+   * The counters can be read from any thread (e.g. by a monitoring thread)
+   * while the `Connection` is in use, but the `Connection` must outlive the
+   * reference.
+   *
+   * @see    `Metrics::snapshot()` for the combined metrics of every
+   *                               `Connection`.
+   *
+   * @return `ConnectionMetrics` of the `Connection`.
+   */
+  const ConnectionMetrics& Connection::getMetrics() const {
+    return this->metrics;
+  }
+
   /**
    * Fetches the port of the `Connection` instance.
    *
@@ -293,114 +1117,1128 @@ namespace CFNetwork {
     return this->port;
   }
 
+  /**
+   * Fetches the maximum amount of time that a blocking read may wait.
+   *
+   * @return The read timeout, or zero if reads may wait indefinitely.
+   */
+  std::chrono::milliseconds Connection::getReadTimeout() const {
+    return this->read_timeout;
+  }
+
   /**
    * Fetches the remote address of the `Connection` instance.
    *
-   * This method will produce a `std::string` of an IPv4/IPv6 address only (no
-   * IP addresses will be reverse resolved into hostnames).
+   * This method will produce a `std::string` of an IPv4/IPv6 address or a
+   * local socket name only (no IP addresses will be reverse resolved into
+   * hostnames). The remote address of a local client that didn't bind to a
+   * name is an empty `std::string`.
+   *
+   * The address is formatted on first use, so the first call should not race
+   * with other threads calling this method on the same `Connection`.
    *
    * @return `std::string` containing the remote peer's IP address.
    */
   const std::string& Connection::getRemote() const {
+    if (this->remote.empty() && this->remote_address.ss_family != AF_UNSPEC)
+      this->remote = formatAddress(this->remote_address);
     return this->remote;
   }
 
   /**
-   * Attempts to read data from the internal buffer & file descriptor.
+   * Fetches the lifecycle stage of the `Connection` instance.
    *
-   * Requests to read data will check the internal buffer to determine if a
-   * sufficient amount of data is available to satisfy the request. If not, an
-   * attempt is made to enqueue more data by reading from the file descriptor.
+   * @see    `ConnectionState` for more information on lifecycle stages.
    *
-   * Requests to read data can either be reliable or unreliable as described by
-   * the `enqueueData()` method of this class.
+   * @return `ConnectionState` value describing the lifecycle stage.
+   */
+  ConnectionState Connection::getState() const {
+    return this->state;
+  }
+
+  /**
+   * Fetches the `Transport` attached to the `Connection`.
    *
-   * Exceptions can occur from the `enqueueData()` method that will not be
-   * caught by this method.
+   * @return A pointer to the `Transport`, or `nullptr` if data is read from and
+   *         written to the file descriptor directly.
+   */
+  Transport* Connection::getTransport() const {
+    return this->transport.get();
+  }
+
+  /**
+   * Fetches the maximum amount of time that a blocking write may wait.
    *
-   * @see    `enqueueData()` for more information regarding reliable/unreliable
-   *                         requests and potential exceptions.
+   * @return The write timeout, or zero if writes may wait indefinitely.
+   */
+  std::chrono::milliseconds Connection::getWriteTimeout() const {
+    return this->write_timeout;
+  }
+
+  /**
+   * Determines whether or not the `Connection` blocks while waiting for data.
    *
-   * @param  reliable       Whether or not the request should be reliable (true)
-   *                        or unreliable (false)
-   * @param  request_length The total number of bytes to read
+   * @return `true` if the `Connection` is in blocking mode, `false` otherwise.
+   */
+  bool Connection::isBlocking() const {
+    return this->blocking;
+  }
+
+  /**
+   * Determines whether or not reads are paused.
    *
-   * @return                The resulting `std::string` of the requested data.
+   * Reads are paused once the buffer limit (or the `MemoryBudget`) prevents
+   * more data from being received using `BufferPolicy::Pause`, and resume as
+   * soon as enough buffered data is consumed. Since the pending data remains
+   * queued in the kernel, an `EventLoop` won't report the `Connection` as
+   * readable again; `enqueueData()` should be called again after consuming
+   * data from a paused `Connection`.
+   *
+   * @return `true` if the most recent attempt to receive data was refused,
+   *         `false` otherwise.
    */
-  std::string Connection::read(bool reliable, size_t request_length) {
-    assert(MAX_BYTES > 0);
-    // Keep track of the length of the internal buffer
-    size_t buf_length = this->buffer.length();
-    // Determine if some data needs to be enqueued
-    if (buf_length < request_length) {
-      // Enqueue the necessary amount of data (if there is not enough data
-      // available to satisfy the request)
-      size_t remaining_length = reliable ?
-        request_length - buf_length : MAX_BYTES;
-      // Attempt to enqueue the remaining amount of data
-      if (remaining_length > 0) this->enqueueData(reliable, remaining_length);
-      // Update the value of the buffer length
-      buf_length = this->buffer.length();
-    }
-    // Calculate the maximum bound of the buffer
-    size_t str_length = request_length < buf_length ?
-      request_length : buf_length;
-    // Generate the resulting return value for this read
-    std::string data = this->buffer.substr(0, str_length);
-    // Adjust the internal buffer to remove the requested data
-    this->buffer.erase(0, str_length);
-    return data;
+  bool Connection::isPaused() const {
+    return this->paused;
   }
 
   /**
-   * Attempts to read a string up to the specified delimiter.
+   * Locates the end of the next delimited message in the internal buffer.
    *
-   * Requests to read up to a delimiter will result in a search of the internal
-   * buffer to find the specified delimiter. If the delimiter is not found then
-   * `enqueueData()` will be called until the delimiter can be found.
+   * The internal buffer is scanned for the delimiter (using the vectorized
+   * `findDelimiter()` helper), and `enqueueData()` is called until it can be
+   * found. The scan position is saved between calls, so bytes are only
+   * rescanned when the delimiter changes or when they could form part of a
+   * multi-byte delimiter split across reads.
+   *
+   * The read timeout (if any) applies to the search as a whole, so a peer
+   * that trickles data without sending the delimiter can't keep a blocking
+   * `Connection` waiting beyond it.
+   *
+   * @throws `InvalidArgument`    if the delimiter is empty.
+   * @throws `ConnectionClosed`   if a blocking `Connection` is closed by the
+   *                              remote peer before the delimiter is received.
+   * @throws `ConnectionTimedOut` if the read timeout expired before the
+   *                              delimiter was received.
+   *
+   * @param  delim        A pointer to the delimiter
+   * @param  delim_length The length of the delimiter
+   *
+   * @return              The length of the message (including the delimiter),
+   *                      or zero if a non-blocking `Connection` doesn't have a
+   *                      complete message available.
+   */
+  size_t Connection::locateDelim(const char* delim, size_t delim_length) {
+    if (delim_length == 0)
+      throw InvalidArgument{"The provided delimiter is empty."};
+    // Forget the saved scan position if a different delimiter was requested
+    if (this->scan_delim.compare(0, std::string::npos, delim,
+        delim_length) != 0) {
+      this->scan_delim.assign(delim, delim_length);
+      this->scan_offset = 0;
+    }
+    // Only read the clock if the wait time will be recorded
+    ConnectionMetrics::Clock::time_point start = {};
+    if (Metrics::isHistogramsEnabled())
+      start = ConnectionMetrics::Clock::now();
+    std::chrono::steady_clock::time_point deadline =
+      this->computeDeadline(this->read_timeout);
+    size_t location;
+    // Continue enqueuing data until the specified delimiter is found
+    while ((location = findDelimiter(this->buffer.data() + this->scan_offset,
+        this->buffer.size() - this->scan_offset, delim, delim_length)) ==
+        std::string::npos) {
+      // Resume the next search at the first position where the delimiter could
+      // still begin
+      size_t length = this->buffer.size();
+      if (length >= delim_length) this->scan_offset = length - delim_length + 1;
+      // Attempt to enqueue more data for the next search (giving up for now if
+      // a non-blocking `Connection` has no more data available)
+      if (this->enqueueData(false, MAX_BYTES, deadline) == 0) {
+        // The message can't grow while reads are paused, so give up unless a
+        // non-blocking `Connection` is only waiting for the `MemoryBudget`
+        if (this->paused && (this->blocking || this->buffer.size() +
+            (this->ring ? this->ring->getBufferSize() : 1) >
+            this->buffer_limit))
+          throw BufferLimitExceeded{"The buffer limit was reached by peer " +
+            this->getRemote() + ":" + std::to_string(this->port) +
+            " before the delimiter was received"};
+        // The delimiter can never arrive once the remote peer finished sending
+        if (this->state == ConnectionState::HalfClosed && this->blocking)
+          throw ConnectionClosed{"Connection closed by peer " +
+            this->getRemote() + ":" + std::to_string(this->port) +
+            " before the delimiter was received"};
+        if (!this->blocking || this->state == ConnectionState::HalfClosed)
+          return 0;
+      }
+    }
+    // Remember where the delimiter begins in case the message isn't consumed
+    this->scan_offset += location;
+    this->metrics.recordDelimWait(start);
+    CFNETWORK_PROBE(read_delim, this->socket, this->scan_offset + delim_length);
+    return this->scan_offset + delim_length;
+  }
+
+  /**
+   * Prepares the `Connection` for use by an `Awaiter`.
+   *
+   * @throws `InvalidArgument` if the file descriptor is invalid or an
+   *                           `IOUring` is attached.
+   */
+  void Connection::prepareAwait() {
+    if (!this->valid())
+      throw InvalidArgument{"The socket file descriptor is invalid."};
+    if (this->ring)
+      throw InvalidArgument{"Data can't be awaited alongside a ring."};
+    if (this->blocking) this->setBlocking(false);
+  }
+
+  /**
+   * Fetches a view of all data currently held in the internal buffer.
+   *
+   * No attempt is made to enqueue more data. The view remains valid until the
+   * next call to a method that enqueues data, and its contents can be removed
+   * from the internal buffer using `consume()`.
+   *
+   * @return `std::string_view` of the internal buffer.
+   */
+  std::string_view Connection::peek() const {
+    return std::string_view{this->buffer.data(), this->buffer.size()};
+  }
+
+  /**
+   * Fetches the number of bytes that have been queued for writing but not yet
+   * accepted by the kernel.
+   *
+   * @return The number of pending bytes.
+   */
+  size_t Connection::pending() const {
+    return this->outbound.size();
+  }
+
+  /**
+   * Forwards data received by this `Connection` to another `Connection` without
+   * copying it through user space.
+   *
+   * Any data already held in the internal buffer is queued on `destination`
+   * first. Further data is moved with `splice(2)` from this `Connection`'s
+   * file descriptor into a pipe and from the pipe into `destination`'s file
+   * descriptor, so the kernel never copies it into this process.
+   *
+   * In blocking mode this method returns once `length` bytes were forwarded
+   * or the remote peer closed the connection. If either `Connection` is in
+   * non-blocking mode, this method returns as soon as the kernel can't make
+   * progress; data left in the pipe is retained and forwarded by the next
+   * call, so forwarding can be resumed once both connections are ready. The
+   * same applies to a blocking `Connection` that can't make progress within
+   * its read (or write) timeout.
+   *
+   * @throws `InvalidArgument` if either file descriptor is invalid.
+   * @throws `UnexpectedError` if the pipe couldn't be created or forwarding
+   *         fails (e.g. either connection was reset by peer).
+   *
+   * @param  destination The `Connection` to forward data to
+   * @param  length      The maximum number of bytes to forward
+   *
+   * @return             The number of bytes forwarded to `destination`.
+   */
+  size_t Connection::pipeTo(Connection& destination, size_t length) {
+    if (!this->valid() || !destination.valid())
+      throw InvalidArgument{"The socket file descriptor is invalid."};
+    size_t forwarded = 0;
+    // Forward any data that was already read into user space first
+    if (!this->buffer.empty() && length > 0) {
+      size_t chunk = this->buffer.size() < length ?
+        this->buffer.size() : length;
+      destination.queue(std::string{this->buffer.data(), chunk});
+      this->consume(chunk);
+      forwarded += chunk;
+    }
+    // Preserve ordering with respect to data queued on the destination
+    if (!destination.flush()) return forwarded;
+    // Data can't be spliced through a `Transport` that isn't handled by the
+    // kernel, so copy it through user space instead
+    if ((this->transport && !this->transport->isKernelReceive()) ||
+        (destination.transport && !destination.transport->isKernelSend())) {
+      while (forwarded < length) try {
+        std::string_view view = this->readView(false, length - forwarded);
+        if (view.empty()) break;
+        destination.queue(std::string{view});
+        this->consume(view.length());
+        forwarded += view.length();
+        if (!destination.flush()) break;
+      }
+      // Queued data remains queued, so stop early like a non-blocking transfer
+      catch (const ConnectionTimedOut&) { break; }
+      return forwarded;
+    }
+    if (this->pipe_fds[0] < 0 && pipe2(this->pipe_fds, O_CLOEXEC) < 0)
+      throw UnexpectedError{"Couldn't create a pipe for splicing."};
+    while (forwarded < length) {
+      // Refill the pipe from the source if it was fully drained
+      if (this->pipe_pending == 0) {
+        if (this->state == ConnectionState::HalfClosed) break;
+        size_t chunk = length - forwarded < MAX_BYTES * 8 ?
+          length - forwarded : MAX_BYTES * 8;
+        ssize_t result;
+        this->arm(SO_RCVTIMEO, this->computeDeadline(this->read_timeout));
+        do result = splice(this->socket, nullptr, this->pipe_fds[1], nullptr,
+          chunk, SPLICE_F_MOVE | (this->blocking ? 0 : SPLICE_F_NONBLOCK));
+        while (result < 0 && errno == EINTR);
+        // The remote peer closed the connection
+        if (result == 0) {
+          this->metrics.countRead(0);
+          this->state = ConnectionState::HalfClosed;
+          break;
+        }
+        if (result < 0) {
+          if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            this->metrics.countBlockedRead();
+            break;
+          }
+          this->fail(errno, "Couldn't read from");
+        }
+        this->metrics.countRead(static_cast<size_t>(result));
+        this->pipe_pending = static_cast<size_t>(result);
+      }
+      // Drain the pipe into the destination
+      ssize_t result;
+      destination.arm(SO_SNDTIMEO,
+        destination.computeDeadline(destination.write_timeout));
+      do result = splice(this->pipe_fds[0], nullptr, destination.socket,
+        nullptr, this->pipe_pending, SPLICE_F_MOVE |
+        (destination.blocking ? 0 : SPLICE_F_NONBLOCK));
+      while (result < 0 && errno == EINTR);
+      if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          destination.metrics.countBlockedWrite();
+          break;
+        }
+        destination.fail(errno, "Couldn't write to");
+      }
+      destination.metrics.countWrite(static_cast<size_t>(result),
+        this->pipe_pending);
+      CFNETWORK_PROBE(send, destination.socket, result);
+      this->pipe_pending -= static_cast<size_t>(result);
+      forwarded          += static_cast<size_t>(result);
+    }
+    return forwarded;
+  }
+
+  /**
+   * Queues a `std::string` for writing, taking ownership of its storage.
+   *
+   * No data is written until `flush()` (or `write()`) is called, which allows
+   * many messages to be written with a single system call.
+   *
+   * @param data The data to queue
+   */
+  void Connection::queue(std::string data) {
+    this->outbound.push(std::move(data));
+  }
+
+  /**
+   * Queues a shared buffer for writing without copying it.
+   *
+   * The same buffer can be queued on many connections at once; a reference is
+   * retained until it has been written.
+   *
+   * @param data The data to queue
+   */
+  void Connection::queue(std::shared_ptr<const std::string> data) {
+    this->outbound.push(std::move(data));
+  }
+
+  /**
+   * Queues a view of data for writing without copying or owning it.
+   *
+   * The viewed data must remain valid until `pending()` reports that it has
+   * been written.
+   *
+   * @param data The data to queue
+   */
+  void Connection::queueView(std::string_view data) {
+    this->outbound.push(data);
+  }
+
+  /**
+   * Attempts to read data from the internal buffer & file descriptor.
+   *
+   * Requests to read data will check the internal buffer to determine if a
+   * sufficient amount of data is available to satisfy the request. If not, an
+   * attempt is made to enqueue more data by reading from the file descriptor.
+   *
+   * Requests to read data can either be reliable or unreliable as described by
+   * the `enqueueData()` method of this class.
+   *
+   * Exceptions can occur from the `enqueueData()` method that will not be
+   * caught by this method.
+   *
+   * @see    `enqueueData()` for more information regarding reliable/unreliable
+   *                         requests and potential exceptions.
+   * @see    `readView()`    for a variant of this method that doesn't copy.
+   *
+   * @param  reliable       Whether or not the request should be reliable (true)
+   *                        or unreliable (false)
+   * @param  request_length The total number of bytes to read
+   *
+   * @return                The resulting `std::string` of the requested data.
+   */
+  std::string Connection::read(bool reliable, size_t request_length) {
+    std::string_view view = this->readView(reliable, request_length);
+    std::string data{view};
+    // Remove the data from the internal buffer (which doesn't move the
+    // remaining data)
+    this->consume(view.length());
+    return data;
+  }
+
+  /**
+   * Reads available data from a coroutine without blocking its thread.
+   *
+   * The `Connection` is placed in non-blocking mode. Awaiting the result
+   * suspends the coroutine until data is available, and then produces up to
+   * `length` bytes (or an empty `std::string` once the remote peer finished
+   * sending):
+   *
+   *     std::string data = co_await connection.readAsync(loop);
+   *
+   * @see    `Awaiter` for more information regarding awaitable operations.
+   *
+   * @throws `InvalidArgument` if the file descriptor is invalid or an
+   *                           `IOUring` is attached.
+   *
+   * @param  loop   The `EventLoop` that resumes the awaiting coroutine
+   * @param  length The maximum number of bytes to read
+   *
+   * @return `ReadAwaiter` producing the data.
+   */
+  ReadAwaiter Connection::readAsync(EventLoop& loop, size_t length) {
+    this->prepareAwait();
+    return ReadAwaiter{loop, *this, length};
+  }
+
+  /**
+   * Attempts to read a string up to the specified delimiter.
+   *
+   * Requests to read up to a delimiter will result in a search of the internal
+   * buffer to find the specified delimiter. If the delimiter is not found then
+   * `enqueueData()` will be called until the delimiter can be found.
    *
    * Once the specified delimiter is found all data up to (and including) the
    * delimiter will be extracted from the buffer and returned to the caller.
    *
+   * If the `Connection` is in non-blocking mode and the delimiter can't be
+   * found in the currently available data, an empty `std::string` is returned
+   * and any partial data is retained for the next call.
+   *
+   * If the remote peer closes the connection before the delimiter is received,
+   * a blocking `Connection` throws `ConnectionClosed` while a non-blocking
+   * `Connection` returns an empty `std::string` (and becomes half-closed). Any
+   * partial data remains available using `peek()` or `read()`.
+   *
    * Exceptions can occur from the `enqueueData()` method that will not be
    * caught by this method.
    *
-   * @see    `enqueueData()` for more information regarding how data is enqueued
-   *                         to the internal buffer and potential exceptions.
+   * @see    `enqueueData()`   for more information regarding how data is
+   *                           enqueued to the internal buffer and potential
+   *                           exceptions.
+   * @see    `readDelimView()` for a variant of this method that doesn't copy.
+   *
+   * @param  delim The delimiter to read up to
    *
    * @return The resulting `std::string` of the requested data.
    */
   std::string Connection::readDelim(char delim) {
-    size_t offset = 0, location;
-    // Continue enqueuing data until the specified delimiter is found
-    while ((location = this->buffer.find(delim, offset)) == std::string::npos) {
-      // Calculate the offset for the next search
-      offset  = this->buffer.length();
-      // Attempt to enqueue more data for the next search
-      this->enqueueData();
-    } ++location;
-    // Copy the contents of the buffer up to the resulting location
-    std::string data = this->buffer.substr(0, location);
-    // Erase the extracted portion of the buffer
-    this->buffer.erase(0, location);
+    std::string_view view = this->readDelimView(delim);
+    // Extract the contents of the buffer up to the resulting location
+    std::string data{view};
+    this->consume(view.length());
+    return data;
+  }
+
+  /**
+   * Attempts to read a string up to the specified multi-byte delimiter.
+   *
+   * This method behaves identically to `readDelim(char)`, but allows for
+   * delimiters such as `"\r\n"` to be found in a single pass.
+   *
+   * @throws `InvalidArgument`    if the delimiter is empty.
+   * @throws `ConnectionClosed`   if a blocking `Connection` is closed by the
+   *                              remote peer before the delimiter is received.
+   * @throws `ConnectionTimedOut` if the read timeout of a blocking
+   *                              `Connection` expired first.
+   *
+   * @param  delim The delimiter to read up to
+   *
+   * @return The resulting `std::string` of the requested data.
+   */
+  std::string Connection::readDelim(const std::string& delim) {
+    std::string_view view = this->readDelimView(delim);
+    // Extract the contents of the buffer up to the resulting location
+    std::string data{view};
+    this->consume(view.length());
     return data;
   }
 
+  /**
+   * Reads a delimited message from a coroutine without blocking its thread.
+   *
+   * The `Connection` is placed in non-blocking mode. Awaiting the result
+   * suspends the coroutine until a complete message is available, and then
+   * produces it (including the delimiter):
+   *
+   *     std::string line = co_await connection.readDelimAsync(loop);
+   *
+   * Like a blocking `readDelim()`, the awaiting coroutine receives
+   * `ConnectionClosed` if the remote peer finishes sending before the
+   * delimiter is received.
+   *
+   * @see    `Awaiter` for more information regarding awaitable operations.
+   *
+   * @throws `InvalidArgument` if the file descriptor is invalid or an
+   *                           `IOUring` is attached.
+   *
+   * @param  loop  The `EventLoop` that resumes the awaiting coroutine
+   * @param  delim The delimiter to read up to
+   *
+   * @return `ReadDelimAwaiter` producing the message.
+   */
+  ReadDelimAwaiter Connection::readDelimAsync(EventLoop& loop,
+      std::string delim) {
+    if (delim.empty())
+      throw InvalidArgument{"The provided delimiter is empty."};
+    this->prepareAwait();
+    return ReadDelimAwaiter{loop, *this, std::move(delim)};
+  }
+
+  /**
+   * Attempts to locate a message ending with the specified delimiter without
+   * copying it out of the internal buffer.
+   *
+   * This method enqueues data exactly like `readDelim()`, but returns a view of
+   * the message (including the delimiter) that remains in the internal buffer.
+   * The caller should pass the length of the view to `consume()` once it has
+   * been processed. The view is invalidated by the next call to a method that
+   * enqueues data.
+   *
+   * If the `Connection` is in non-blocking mode and the delimiter can't be
+   * found in the currently available data, an empty view is returned.
+   *
+   * @see    `readDelim()` for more information regarding potential exceptions.
+   *
+   * @param  delim The delimiter to read up to
+   *
+   * @return `std::string_view` of the requested data.
+   */
+  std::string_view Connection::readDelimView(char delim) {
+    // Locate the delimiter first since doing so may reallocate the buffer
+    size_t location = this->locateDelim(&delim, 1);
+    return std::string_view{this->buffer.data(), location};
+  }
+
+  /**
+   * Attempts to locate a message ending with the specified multi-byte
+   * delimiter without copying it out of the internal buffer.
+   *
+   * @see    `readDelimView(char)` for more information.
+   *
+   * @throws `InvalidArgument`    if the delimiter is empty.
+   * @throws `ConnectionClosed`   if a blocking `Connection` is closed by the
+   *                              remote peer before the delimiter is received.
+   * @throws `ConnectionTimedOut` if the read timeout of a blocking
+   *                              `Connection` expired first.
+   *
+   * @param  delim The delimiter to read up to
+   *
+   * @return `std::string_view` of the requested data.
+   */
+  std::string_view Connection::readDelimView(const std::string& delim) {
+    size_t location = this->locateDelim(delim.data(), delim.length());
+    return std::string_view{this->buffer.data(), location};
+  }
+
+  /**
+   * Attempts to read data without copying it out of the internal buffer.
+   *
+   * This method enqueues data exactly like `read()`, but returns a view of (up
+   * to) `request_length` bytes that remain in the internal buffer. The caller
+   * should pass the length of the view to `consume()` once it has been
+   * processed. The view is invalidated by the next call to a method that
+   * enqueues data.
+   *
+   * @see    `read()` for more information regarding reliable/unreliable
+   *                  requests and potential exceptions.
+   *
+   * @param  reliable       Whether or not the request should be reliable (true)
+   *                        or unreliable (false)
+   * @param  request_length The total number of bytes to read
+   *
+   * @return                `std::string_view` of the requested data.
+   */
+  std::string_view Connection::readView(bool reliable, size_t request_length) {
+    assert(MAX_BYTES > 0);
+    // Keep track of the length of the internal buffer
+    size_t buf_length = this->buffer.size();
+    // Determine if some data needs to be enqueued
+    if (buf_length < request_length) {
+      // Enqueue the necessary amount of data (if there is not enough data
+      // available to satisfy the request)
+      size_t remaining_length = reliable ?
+        request_length - buf_length : MAX_BYTES;
+      // Attempt to enqueue the remaining amount of data. An unreliable request
+      // that can already be served from the buffer doesn't fail just because
+      // the buffer limit (or the `MemoryBudget`) prevents receiving more
+      if (reliable || buf_length == 0)
+        this->enqueueData(reliable, remaining_length);
+      else if (buf_length < this->buffer_limit) try {
+        this->enqueueData(reliable, remaining_length);
+      }
+      catch (const BufferLimitExceeded&) {}
+      // Update the value of the buffer length
+      buf_length = this->buffer.size();
+      // A blocking reliable request can't be satisfied while reads are paused
+      if (reliable && this->blocking && this->paused &&
+          buf_length < request_length)
+        throw BufferLimitExceeded{"The buffer limit was reached by peer " +
+          this->getRemote() + ":" + std::to_string(this->port) +
+          " before the requested length was received"};
+    }
+    // Calculate the maximum bound of the buffer
+    size_t str_length = request_length < buf_length ?
+      request_length : buf_length;
+    return std::string_view{this->buffer.data(), str_length};
+  }
+
+  /**
+   * Receives data from the internal file descriptor (or its `Transport`).
+   *
+   * A local (`AF_UNIX`) `Connection` receives using `recvmsg(2)` so that any
+   * descriptors passed by the remote peer are held until they are claimed by
+   * `receiveDescriptor()` rather than being discarded by the kernel. Since the
+   * kernel ends a read at the byte that carries descriptors, the marker byte
+   * sent by `sendDescriptor()` is always the last byte received.
+   *
+   * @param  data   The storage for the received data
+   * @param  length The maximum number of bytes to receive
+   * @param  passed Set to whether or not the last byte received is the marker
+   *                of passed descriptors
+   *
+   * @return        The result of the underlying system call.
+   */
+  ssize_t Connection::receive(char* data, size_t length, bool& passed) {
+    passed = false;
+    if (this->transport) return this->transport->receive(data, length);
+    if (this->family != SocketFamily::Unix)
+      return read_fn(this->socket, data, length);
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) *
+      max_descriptors)];
+    struct iovec  iov     = {data, length};
+    struct msghdr message = {};
+    message.msg_iov        = &iov;
+    message.msg_iovlen     = 1;
+    message.msg_control    = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t result = recvmsg(this->socket, &message, MSG_CMSG_CLOEXEC);
+    if (result <= 0) return result;
+    for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+        header = CMSG_NXTHDR(&message, header)) {
+      if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+        continue;
+      size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (size_t i = 0; i < count; ++i) {
+        int descriptor;
+        memcpy(&descriptor, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+        this->descriptors.push_back(descriptor);
+      }
+      passed = true;
+    }
+    return result;
+  }
+
+  /**
+   * Receives a file descriptor passed by the remote peer using
+   * `sendDescriptor()`.
+   *
+   * Data that arrives before the descriptor is enqueued to the internal
+   * buffer (and remains available to the read methods), while descriptors
+   * that arrive during other reads are held until claimed by this method, so
+   * data and descriptors can be interleaved freely. Reading stops as soon as
+   * a descriptor is received, so this method never waits for data that
+   * follows it.
+   *
+   * The received descriptor has its close-on-exec flag set and is owned by
+   * the caller. A passed connection can be wrapped using the adopting
+   * `Connection` constructor.
+   *
+   * @throws `InvalidArgument`     if the `Connection` is invalid, or if it
+   *                               isn't a local connection without a
+   *                               `Transport` or `IOUring`.
+   * @throws `BufferLimitExceeded` if data preceding the descriptor exceeds
+   *                               the buffer limit (or the `MemoryBudget`)
+   *                               using `BufferPolicy::Error`.
+   * @throws `ConnectionClosed`    if a blocking `Connection` is closed by the
+   *                               remote peer before a descriptor is
+   *                               received.
+   * @throws `ConnectionTimedOut`  if the read timeout expired.
+   * @throws `UnexpectedError`     if the read fails (e.g. the connection was
+   *                               reset by peer).
+   *
+   * @return The received file descriptor, or `-1` if a non-blocking
+   *         `Connection` has no descriptor available (or reads are paused).
+   */
+  int Connection::receiveDescriptor() {
+    if (this->family != SocketFamily::Unix || this->transport || this->ring)
+      throw InvalidArgument{"Descriptors can only be passed over a local "
+        "connection without a transport or ring."};
+    if (!this->valid())
+      throw InvalidArgument{"The socket file descriptor is invalid."};
+    std::chrono::steady_clock::time_point deadline =
+      this->computeDeadline(this->read_timeout);
+    // Unlike `enqueueData()`, stop reading as soon as a descriptor arrives
+    while (this->descriptors.empty()) {
+      // The descriptor can never arrive once the remote peer finished sending
+      if (this->state == ConnectionState::HalfClosed) {
+        if (!this->blocking) return -1;
+        throw ConnectionClosed{"Connection closed by peer " +
+          this->getRemote() + ":" + std::to_string(this->port) +
+          " before a descriptor was received"};
+      }
+      size_t chunk = MAX_BYTES;
+      char*  space = this->reserve(chunk);
+      // The buffer limit (or the `MemoryBudget`) was reached, so pause
+      if (space == nullptr) return -1;
+      bool    passed = false;
+      ssize_t result;
+      this->arm(SO_RCVTIMEO, deadline);
+      do result = this->receive(space, chunk, passed);
+      while (result < 0 && (errno == EINTR || ((errno == EAGAIN ||
+        errno == EWOULDBLOCK) && this->arm(SO_RCVTIMEO, deadline))));
+      // A non-blocking `Connection` has drained all available data
+      if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        this->metrics.countBlockedRead();
+        return -1;
+      }
+      if (result < 0) this->fail(errno, "Couldn't read from");
+      if (result == 0) {
+        this->metrics.countRead(0);
+        this->state = ConnectionState::HalfClosed;
+        continue;
+      }
+      // Keep any data that preceded the descriptor (excluding its marker)
+      size_t data_read = static_cast<size_t>(result) - (passed ? 1 : 0);
+      this->buffer.commit(data_read);
+      this->metrics.countRead(data_read);
+      this->metrics.observeBuffer(this->buffer.size());
+    }
+    int descriptor = this->descriptors.front();
+    this->descriptors.pop_front();
+    return descriptor;
+  }
+
+  /**
+   * Reserves space in the internal buffer for incoming data.
+   *
+   * The space is limited by the buffer limit and by the `MemoryBudget`. If no
+   * space can be reserved, the `Connection` is paused and (when using
+   * `BufferPolicy::Error`) an exception is thrown.
+   *
+   * @throws `BufferLimitExceeded` if no space could be reserved using
+   *                               `BufferPolicy::Error`.
+   *
+   * @param  length  The number of bytes to reserve, which is reduced to the
+   *                 space left below the buffer limit
+   * @param  partial Whether or not less than `length` bytes are acceptable
+   *
+   * @return         A pointer to `length` writable bytes, or `nullptr` if
+   *                 reads are paused.
+   */
+  char* Connection::reserve(size_t& length, bool partial) {
+    size_t size = this->buffer.size();
+    size_t room = size < this->buffer_limit ? this->buffer_limit - size : 0;
+    bool limited = length > room;
+    if (limited) length = partial ? room : 0;
+    char* space = length > 0 ? this->buffer.tryPrepare(length) : nullptr;
+    this->paused = (space == nullptr);
+    if (this->paused && this->buffer_policy == BufferPolicy::Error)
+      throw BufferLimitExceeded{std::string{limited ? "The buffer limit" :
+        "The memory budget"} + " was reached by peer " + this->getRemote() +
+        ":" + std::to_string(this->port)};
+    return space;
+  }
+
+  /**
+   * Restores the default options of an idle `Connection` so that it can be
+   * handed to another user by a `ConnectionPool`.
+   *
+   * The blocking mode, read and write timeouts, buffer limit and policy (and
+   * with them the paused state) are restored, and any passed descriptors that
+   * weren't claimed are closed. The session of an attached `Transport` or
+   * `IOUring` can't be detached safely, so such a `Connection` isn't reset.
+   *
+   * @return `true` if the defaults were restored, `false` if the `Connection`
+   *         shouldn't be reused.
+   */
+  bool Connection::reset() {
+    if (this->transport || this->ring) return false;
+    try {
+      this->setBlocking(true);
+    }
+    catch (const UnexpectedError&) {
+      return false;
+    }
+    this->buffer_limit  = static_cast<size_t>(-1);
+    this->buffer_policy = BufferPolicy::Error;
+    this->paused        = false;
+    this->read_timeout  = std::chrono::milliseconds{0};
+    this->write_timeout = std::chrono::milliseconds{0};
+    for (int descriptor : this->descriptors) ::close(descriptor);
+    this->descriptors.clear();
+    return true;
+  }
+
+  /**
+   * Passes a file descriptor to the remote peer of a local (`AF_UNIX`)
+   * `Connection` using `SCM_RIGHTS`.
+   *
+   * The kernel installs a duplicate of the descriptor (such as a client
+   * accepted by a `Socket`) in the remote process, where it can be claimed
+   * using `receiveDescriptor()`, so a connection can be handed to another
+   * process without relaying its data. The caller remains responsible for
+   * closing its own copy. Queued data is flushed first so that the descriptor
+   * keeps its place in the stream, and the descriptor travels alongside a
+   * single marker byte that the receiving `Connection` never exposes to its
+   * read methods.
+   *
+   * @throws `InvalidArgument`    if the `Connection` or the descriptor is
+   *                              invalid, or if the `Connection` isn't a local
+   *                              connection without a `Transport` or
+   *                              `IOUring`.
+   * @throws `ConnectionTimedOut` if the write timeout expired.
+   * @throws `UnexpectedError`    if the write fails (e.g. the connection was
+   *                              reset by peer).
+   *
+   * @param  descriptor The file descriptor to pass
+   *
+   * @return `true` if the descriptor was passed, `false` if a non-blocking
+   *         `Connection` couldn't write it (or its queued data) yet.
+   */
+  bool Connection::sendDescriptor(int descriptor) {
+    if (this->family != SocketFamily::Unix || this->transport || this->ring)
+      throw InvalidArgument{"Descriptors can only be passed over a local "
+        "connection without a transport or ring."};
+    if (descriptor < 0 || fcntl(descriptor, F_GETFD) < 0)
+      throw InvalidArgument{"The provided file descriptor is invalid."};
+    // Preserve the order of the stream by writing any queued data first
+    if (!this->flush()) return false;
+    char marker = '\0';
+    struct iovec iov = {&marker, 1};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr message = {};
+    message.msg_iov        = &iov;
+    message.msg_iovlen     = 1;
+    message.msg_control    = control;
+    message.msg_controllen = sizeof(control);
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level     = SOL_SOCKET;
+    header->cmsg_type      = SCM_RIGHTS;
+    header->cmsg_len       = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+    std::chrono::steady_clock::time_point deadline =
+      this->computeDeadline(this->write_timeout);
+    ssize_t written;
+    this->arm(SO_SNDTIMEO, deadline);
+    do written = sendmsg(this->socket, &message, MSG_NOSIGNAL);
+    while (written < 0 && (errno == EINTR || ((errno == EAGAIN ||
+      errno == EWOULDBLOCK) && this->arm(SO_SNDTIMEO, deadline))));
+    if (written < 0) {
+      // The kernel's send buffer is full, so try again when writable
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        this->metrics.countBlockedWrite();
+        return false;
+      }
+      this->fail(errno, "Couldn't pass a descriptor to");
+    }
+    this->metrics.countWrite(1, 1);
+    CFNETWORK_PROBE(send, this->socket, 1);
+    return true;
+  }
+
+  /**
+   * Writes part of a file to the internal file descriptor without copying it
+   * through user space.
+   *
+   * Any data that was previously queued is flushed first to preserve ordering.
+   * The file's contents are then transferred by the kernel using
+   * `sendfile(2)`; the file's own offset is left unchanged.
+   *
+   * In blocking mode this method returns once `length` bytes were written or
+   * the end of the file was reached. In non-blocking mode it returns as soon
+   * as the kernel's send buffer is full; the transfer can be resumed once the
+   * `Connection` becomes writable by calling this method again with `offset`
+   * and `length` adjusted by the return value. If a write timeout was set
+   * using `setWriteTimeout()`, a blocking transfer also returns early once no
+   * progress could be made within it.
+   *
+   * @throws `InvalidArgument` if the internal file descriptor is
+   *         considered invalid.
+   * @throws `UnexpectedError` if the transfer fails (e.g. the connection was
+   *         reset by peer).
+   *
+   * @param  descriptor The file descriptor of the file to send
+   * @param  offset     The offset of the first byte of the file to send
+   * @param  length     The number of bytes of the file to send
+   *
+   * @return            The number of bytes that were written.
+   */
+  size_t Connection::sendFile(int descriptor, off_t offset, size_t length) {
+    // Preserve ordering with respect to previously queued data
+    if (!this->flush()) return 0;
+    size_t sent = 0;
+    while (sent < length) {
+      ssize_t result;
+      this->arm(SO_SNDTIMEO, this->computeDeadline(this->write_timeout));
+      do result = this->transport ?
+        this->transport->sendFile(descriptor, offset, length - sent) :
+        sendfile(this->socket, descriptor, &offset, length - sent);
+      while (result < 0 && errno == EINTR);
+      // `sendfile(2)` advances the offset itself but a `Transport` doesn't
+      if (this->transport && result > 0) offset += result;
+      // The end of the file was reached
+      if (result == 0) break;
+      if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          this->metrics.countBlockedWrite();
+          break;
+        }
+        this->fail(errno, "Couldn't send file to");
+      }
+      this->metrics.countWrite(static_cast<size_t>(result), length - sent);
+      CFNETWORK_PROBE(send, this->socket, result);
+      sent += static_cast<size_t>(result);
+    }
+    return sent;
+  }
+
+  /**
+   * Toggles blocking mode for the `Connection`.
+   *
+   * A non-blocking `Connection` never waits for data to arrive: `enqueueData()`
+   * returns as soon as the kernel has no more data available, which allows
+   * many connections to be multiplexed on a single thread by an `EventLoop`.
+   *
+   * @param blocking Whether or not the `Connection` should block
+   */
+  void Connection::setBlocking(bool blocking) {
+    CFNetwork::setBlocking(this->socket, blocking);
+    this->blocking = blocking;
+  }
+
+  /**
+   * Limits the number of bytes that the internal buffer may hold.
+   *
+   * Without a limit, a peer that never sends the delimiter requested by
+   * `readDelim()` (or that sends faster than data is consumed) can grow the
+   * internal buffer without bound. Once the limit is reached, no more data is
+   * received and the `Connection` reacts according to `policy`:
+   *   - `BufferPolicy::Error` throws `BufferLimitExceeded` from the method
+   *     that attempted to receive more data
+   *   - `BufferPolicy::Pause` stops receiving until buffered data is consumed
+   *     (see `isPaused()`), which lets TCP flow control slow the peer down
+   *
+   * Either way, `readDelim()` throws `BufferLimitExceeded` once the buffer is
+   * full without containing the delimiter since the message could never fit.
+   * The same policy applies when the process-wide `MemoryBudget` is exhausted.
+   * When using an `IOUring`, reads pause once less than one receive buffer
+   * of space remains.
+   *
+   * The `Connection` has no limit by default.
+   *
+   * @throws `InvalidArgument` if the limit is zero.
+   *
+   * @param  limit  The maximum number of bytes to buffer
+   * @param  policy How to react once the limit is reached
+   */
+  void Connection::setBufferLimit(size_t limit, BufferPolicy policy) {
+    if (limit == 0)
+      throw InvalidArgument{"The buffer limit must be at least one byte."};
+    this->buffer_limit  = limit;
+    this->buffer_policy = policy;
+  }
+
+  /**
+   * Limits how long a blocking `Connection` may wait to read data.
+   *
+   * The timeout bounds each read operation as a whole rather than each system
+   * call, so a peer that trickles data can't keep a reliable `read()` (or a
+   * `readDelim()` waiting for its delimiter) blocked beyond it. Once it
+   * expires, `ConnectionTimedOut` is thrown; the `Connection` remains open
+   * and any data received in the meantime remains buffered.
+   *
+   * The deadline is enforced by the kernel (using `SO_RCVTIMEO`), so no
+   * additional system call is needed unless an operation actually has to
+   * wait. The timeout doesn't apply to a non-blocking `Connection` (see
+   * `EventLoop::setIdleTimeout()` instead) or to reads performed by an
+   * `IOUring`. A timeout of zero (the default) waits indefinitely.
+   *
+   * @throws `InvalidArgument` if the timeout is negative.
+   *
+   * @param  timeout The maximum amount of time that a read may wait
+   */
+  void Connection::setReadTimeout(std::chrono::milliseconds timeout) {
+    if (timeout.count() < 0)
+      throw InvalidArgument{"The read timeout is invalid."};
+    this->read_timeout = timeout;
+  }
+
+  /**
+   * Attaches an `IOUring` execution backend to the `Connection`.
+   *
+   * Once attached, `enqueueData()` collects data from a multishot receive
+   * request armed in the ring and `write()` submits send requests to the ring
+   * instead of calling `read(2)` and `write(2)` directly. Passing an empty
+   * `std::shared_ptr` detaches the current ring (cancelling any outstanding
+   * request) and restores the plain system call path. A send request that is
+   * still in flight is allowed to complete first, so that its data is neither
+   * lost nor written twice.
+   *
+   * @throws `InvalidArgument` if a `Transport` is attached.
+   *
+   * @param  ring The `IOUring` to attach (or `nullptr` to detach)
+   */
+  void Connection::setRing(std::shared_ptr<IOUring> ring) {
+    if (ring && this->transport)
+      throw InvalidArgument{"A ring can't be attached alongside a transport."};
+    if (this->ring && this->ring_sending) {
+      IOUring::Completion completion = this->ring->wait(this->ring_token + 1);
+      if (completion.result > 0)
+        this->outbound.advance(static_cast<size_t>(completion.result));
+    }
+    if (this->ring) this->ring->cancel(this->ring_token);
+    this->ring         = std::move(ring);
+    this->ring_armed   = false;
+    this->ring_sending = false;
+    this->ring_token = this->ring ? this->ring->allocateToken() : 0;
+  }
+
+  /**
+   * Attaches a `Transport` (such as a `TLSTransport`) to the `Connection`.
+   *
+   * Once attached, every read, write and file transfer is routed through the
+   * `Transport`, and its handshake is started immediately. A blocking
+   * `Connection` completes the handshake before returning, while a
+   * non-blocking `Connection` completes it implicitly as data is read and
+   * written. Passing an empty `std::unique_ptr` detaches the current
+   * `Transport`.
+   *
+   * Data that was already received or queued would bypass the `Transport`, so
+   * it must be consumed and flushed beforehand.
+   *
+   * @throws `InvalidArgument` if the file descriptor is invalid, data is
+   *                           buffered, or an `IOUring` is attached.
+   * @throws `UnexpectedError` if the handshake failed (in which case the
+   *                           `Connection` is closed).
+   *
+   * @param  transport The `Transport` to attach (or `nullptr` to detach)
+   */
+  void Connection::setTransport(std::unique_ptr<Transport> transport) {
+    if (!this->valid())
+      throw InvalidArgument{"The socket file descriptor is invalid."};
+    if (this->ring)
+      throw InvalidArgument{"A transport can't be attached alongside a ring."};
+    if (!this->buffer.empty() || !this->outbound.empty())
+      throw InvalidArgument{"Buffered data must be drained before attaching a "
+        "transport."};
+    this->transport = std::move(transport);
+    if (this->transport) try {
+      this->transport->attach(this->socket);
+      this->transport->handshake();
+    }
+    catch (const UnexpectedError&) {
+      this->terminate(ConnectionState::Errored);
+      throw;
+    }
+  }
+
+  /**
+   * Limits how long a blocking `Connection` may wait to write data.
+   *
+   * The timeout bounds each call to `flush()` (and therefore `write()`) as a
+   * whole. Once it expires, `ConnectionTimedOut` is thrown; the `Connection`
+   * remains open and the data that couldn't be written remains queued.
+   * Transfers made using `sendFile()` and `pipeTo()` instead return early once
+   * no progress could be made within the timeout.
+   *
+   * Like the read timeout, the deadline is enforced by the kernel (using
+   * `SO_SNDTIMEO`) and doesn't apply to a non-blocking `Connection` or to
+   * writes performed by an `IOUring`. A timeout of zero (the default) waits
+   * indefinitely.
+   *
+   * @see    `setReadTimeout()` for more information.
+   *
+   * @throws `InvalidArgument` if the timeout is negative.
+   *
+   * @param  timeout The maximum amount of time that a write may wait
+   */
+  void Connection::setWriteTimeout(std::chrono::milliseconds timeout) {
+    if (timeout.count() < 0)
+      throw InvalidArgument{"The write timeout is invalid."};
+    this->write_timeout = timeout;
+  }
+
+  /**
+   * Closes the internal file descriptor and enters the provided lifecycle
+   * stage.
+   *
+   * Any outstanding `IOUring` requests are cancelled, any queued data is
+   * discarded and any passed descriptors that weren't claimed are closed. The
+   * file descriptor is forgotten once closed so that a descriptor later
+   * reused by the kernel can't be mistaken for this `Connection`'s.
+   *
+   * An `EventLoop` that the `Connection` is registered with is notified, so
+   * that it can release its registration even if the `Connection` wasn't
+   * closed by one of its own callbacks.
+   *
+   * This method never throws since it is called by the destructor. If the
+   * cancellation can't be submitted right away, it remains queued in the
+   * `IOUring` and is submitted along with its next request.
+   *
+   * @param state The resulting lifecycle stage
+   */
+  void Connection::terminate(ConnectionState state) {
+    if (this->socket >= 0) {
+      if (this->ring) try {
+        this->ring->cancel(this->ring_token);
+      }
+      catch (const UnexpectedError&) {}
+      this->ring_armed   = false;
+      this->ring_sending = false;
+      if (this->loop) this->loop->release(this->socket);
+      ::close(this->socket);
+      this->socket = -1;
+      this->state  = state;
+    }
+    this->outbound.clear();
+    // Close any passed descriptors that were never claimed
+    for (int descriptor : this->descriptors) ::close(descriptor);
+    this->descriptors.clear();
+  }
+
   /**
    * Determines if the file descriptor is considered valid for read, write, or
    * any other operations.
    *
-   * A file descriptor is considered invalid if a call requesting its flags
-   * fails with the return value of `-1` or `errno` is set to `EBADF` (the
-   * provided argument is not an open file descriptor). If neither case is
-   * satisfied, the file descriptor is considered valid.
+   * The `Connection` tracks its lifecycle explicitly, so this test doesn't
+   * require a system call. A `Connection` is valid until it is closed (either
+   * explicitly or after encountering an error); a half-closed `Connection` is
+   * still valid since it can be written to.
    *
-   * @see    `fcntl(2)` for more information regarding this procedure's test.
+   * @see    `getState()` for more information regarding the lifecycle stage.
    *
    * @return `true` if the file descriptor is valid, `false` otherwise.
    */
   bool Connection::valid() const {
-    return (fcntl(this->socket, F_GETFD) != -1 || errno != EBADF);
+    return this->state == ConnectionState::Open ||
+      this->state == ConnectionState::HalfClosed;
   }
 
   /**
@@ -408,17 +2246,49 @@ namespace CFNetwork {
    *
    * An optional newline character is inserted into the provided data by
    * default, however this can be avoided using the appropriate parameter for
-   * this method.
+   * this method. The data (and newline) are queued without being copied and
+   * then written along with any previously queued data using `flush()`.
    *
-   * @throws `InvalidArgument` if the internal file descriptor is
-   *         considered invalid.
+   * In non-blocking mode, any data that the kernel couldn't accept remains
+   * queued until the next call to `flush()`.
+   *
+   * @see    `flush()` for more information regarding potential exceptions.
    *
    * @param  data    `std::string` containing the contents to write
    * @param  newline Whether or not a newline character should be included
    */
-  void Connection::write(std::string data, bool newline) const {
-    if (newline) data += "\n";
-    if (this->valid()) ::write(this->socket, data.c_str(), data.length());
-    else throw InvalidArgument{"The socket file descriptor is invalid."};
+  void Connection::write(std::string data, bool newline) {
+    CFNETWORK_PROBE(write, this->socket, data.length() + (newline ? 1 : 0));
+    this->outbound.push(std::move(data));
+    if (newline) this->outbound.push(std::string_view{"\n"});
+    this->flush();
+  }
+
+  /**
+   * Writes the provided data from a coroutine without blocking its thread.
+   *
+   * The data (and an optional newline) is queued and the `Connection` is placed
+   * in non-blocking mode. Awaiting the result suspends the coroutine until all
+   * queued data has been accepted by the kernel:
+   *
+   *     co_await connection.writeAsync(loop, "Hello");
+   *
+   * @see    `Awaiter` for more information regarding awaitable operations.
+   *
+   * @throws `InvalidArgument` if the file descriptor is invalid or an
+   *                           `IOUring` is attached.
+   *
+   * @param  loop    The `EventLoop` that resumes the awaiting coroutine
+   * @param  data    `std::string` containing the contents to write
+   * @param  newline Whether or not a newline character should be included
+   *
+   * @return `WriteAwaiter` that completes once the data has been written.
+   */
+  WriteAwaiter Connection::writeAsync(EventLoop& loop, std::string data,
+      bool newline) {
+    this->prepareAwait();
+    this->outbound.push(std::move(data));
+    if (newline) this->outbound.push(std::string_view{"\n"});
+    return WriteAwaiter{loop, *this};
   }
 }
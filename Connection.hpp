@@ -9,8 +9,23 @@
 #ifndef _CFNETWORKCONNECTION_H
 #define _CFNETWORKCONNECTION_H
 
-#include <string>         // for string
-#include "CFNetwork.hpp"  // for ConnectionFlow, SocketFamily
+#include <chrono>          // for microseconds, milliseconds, steady_clock
+#include <cstdint>         // for uint64_t
+#include <deque>           // for deque
+#include <memory>          // for shared_ptr
+#include <string>          // for string
+#include <string_view>     // for string_view
+#include <sys/socket.h>    // for msghdr, sockaddr_storage
+#include <sys/types.h>     // for off_t, ssize_t
+#include <sys/uio.h>       // for iovec
+#include <vector>          // for vector
+#include "Awaiter.hpp"     // for ReadAwaiter, ReadDelimAwaiter, WriteAwaiter
+#include "Buffer.hpp"      // for Buffer
+#include "CFNetwork.hpp"   // for ConnectionFlow, ConnectionState, ...
+#include "IOUring.hpp"     // for IOUring
+#include "Metrics.hpp"     // for ConnectionMetrics
+#include "Transport.hpp"   // for Transport
+#include "WriteQueue.hpp"  // for WriteQueue
 
 namespace CFNetwork {
   /**
@@ -29,6 +44,8 @@ namespace CFNetwork {
     private:
       Connection(const Connection&);
       Connection& operator= (const Connection&);
+      friend class ConnectionPool;
+      friend class EventLoop;
 
     protected:
       /**
@@ -36,57 +53,277 @@ namespace CFNetwork {
        * Used to hold intermediate data from the `read(2)` system call to allow
        * for reading up to a specified delimiter.
        */
-      std::string    buffer = "";
+      Buffer         buffer;
+      /**
+       * @var blocking
+       * Whether or not the file descriptor of a `Connection` blocks when no
+       * data is available.
+       */
+      bool           blocking = true;
+      /**
+       * @var buffer_limit
+       * The maximum number of bytes that the `buffer` may hold.
+       */
+      size_t         buffer_limit  = static_cast<size_t>(-1);
+      /**
+       * @var buffer_policy
+       * How a `Connection` reacts once the `buffer_limit` (or the
+       * `MemoryBudget`) prevents it from receiving more data.
+       */
+      BufferPolicy   buffer_policy = BufferPolicy::Error;
+      /**
+       * @var descriptors
+       * Holds the descriptors passed by the remote peer of a local
+       * `Connection` until they are claimed by `receiveDescriptor()`.
+       */
+      std::deque<int> descriptors;
       /**
        * @var family
        * Used to describe the socket family type of a `Connection`.
        */
-      SocketFamily   family = SocketFamily::IPv4;
+      SocketFamily   family   = SocketFamily::IPv4;
       /**
        * @var flow
        * Used to describe the connection flow direction of a `Connection`.
        */
-      ConnectionFlow flow   = ConnectionFlow::Inbound;
+      ConnectionFlow flow     = ConnectionFlow::Inbound;
       /**
        * @var listen
-       * Holds the listening address associated with an inbound `Connection`.
+       * Holds the listening address associated with an inbound `Connection`
+       * once it has been formatted by `getListen()`.
+       */
+      mutable std::string     listen = "";
+      /**
+       * @var listen_address
+       * Holds the raw listening address associated with an inbound
+       * `Connection`.
+       */
+      struct sockaddr_storage listen_address = {};
+      /**
+       * @var loop
+       * The `EventLoop` that the `Connection` is registered with (if any),
+       * which is notified once the `Connection` is closed.
+       */
+      EventLoop*              loop = nullptr;
+      /**
+       * @var metrics
+       * The counters and histograms describing the activity of a `Connection`.
+       */
+      ConnectionMetrics       metrics;
+      /**
+       * @var outbound
+       * Holds data that has been queued for writing but not yet accepted by
+       * the kernel.
+       */
+      WriteQueue     outbound;
+      /**
+       * @var paused
+       * Whether or not the most recent attempt to receive data was refused by
+       * the `buffer_limit` (or the `MemoryBudget`).
+       */
+      bool           paused   = false;
+      /**
+       * @var pipe_fds
+       * Holds the pipe used by `pipeTo()` to splice data between connections.
        */
-      std::string    listen = "";
+      int            pipe_fds[2] = {-1, -1};
+      /**
+       * @var pipe_pending
+       * The number of bytes held in the `pipe_fds` awaiting a destination.
+       */
+      size_t         pipe_pending = 0;
       /**
        * @var port
        * Holds the listening port for an inbound `Connection` or the outbound
        * port for an outbound `Connection`.
        */
-      int            port   = 0;
+      int            port     = 0;
+      /**
+       * @var read_armed
+       * The receive timeout (`SO_RCVTIMEO`) currently applied to the file
+       * descriptor, or zero if none is applied.
+       */
+      std::chrono::microseconds read_armed{0};
+      /**
+       * @var read_timeout
+       * The maximum amount of time that a blocking read may wait, or zero to
+       * wait indefinitely.
+       */
+      std::chrono::milliseconds read_timeout{0};
       /**
        * @var remote
-       * Holds the remote address of a `Connection`.
+       * Holds the remote address of a `Connection` once it has been formatted
+       * by `getRemote()`.
        */
-      std::string    remote = "0.0.0.0";
+      mutable std::string     remote = "";
+      /**
+       * @var remote_address
+       * Holds the raw remote address of a `Connection`.
+       */
+      struct sockaddr_storage remote_address = {};
+      /**
+       * @var ring
+       * The optional `IOUring` used to receive and send data.
+       */
+      std::shared_ptr<IOUring> ring;
+      /**
+       * @var ring_armed
+       * Whether or not a multishot receive request is armed in the `ring`.
+       */
+      bool           ring_armed = false;
+      /**
+       * @var ring_iov, ring_message
+       * The message describing the send request submitted to the `ring`,
+       * which must remain valid until the request completes.
+       */
+      std::vector<struct iovec> ring_iov;
+      struct msghdr  ring_message = {};
+      /**
+       * @var ring_sending
+       * Whether or not a send request submitted to the `ring` has yet to be
+       * claimed by `flush()`.
+       */
+      bool           ring_sending = false;
+      /**
+       * @var ring_token
+       * Identifies the requests of a `Connection` in its `ring`.
+       */
+      uint64_t       ring_token = 0;
+      /**
+       * @var scan_delim
+       * The delimiter most recently searched for by `readDelim()`.
+       */
+      std::string    scan_delim;
+      /**
+       * @var scan_offset
+       * The offset (relative to the start of the `buffer`) before which
+       * `scan_delim` is known not to begin.
+       */
+      size_t         scan_offset = 0;
       /**
        * @var socket
        * Holds the file descriptor associated with a `Connection`.
        */
-      int            socket = -1;
+      int            socket   = -1;
+      /**
+       * @var state
+       * Describes the lifecycle stage of a `Connection`.
+       */
+      ConnectionState state   = ConnectionState::Open;
+      /**
+       * @var transport
+       * The optional `Transport` used to receive and send data.
+       */
+      std::unique_ptr<Transport> transport;
+      /**
+       * @var write_armed
+       * The send timeout (`SO_SNDTIMEO`) currently applied to the file
+       * descriptor, or zero if none is applied.
+       */
+      std::chrono::microseconds write_armed{0};
+      /**
+       * @var write_timeout
+       * The maximum amount of time that a blocking write may wait, or zero to
+       * wait indefinitely.
+       */
+      std::chrono::milliseconds write_timeout{0};
+
+      Connection(const struct sockaddr_storage& raddr, int port, int socket);
+      bool               arm(int option,
+                           std::chrono::steady_clock::time_point deadline);
+      std::chrono::steady_clock::time_point computeDeadline(
+                           std::chrono::milliseconds timeout) const;
+      static int         connectAny(const std::vector<struct sockaddr_storage>&
+                           candidates, int port,
+                           std::chrono::milliseconds timeout,
+                           std::chrono::milliseconds attempt_delay,
+                           struct sockaddr_storage& connected);
+      size_t             enqueueCompletions(bool reliable,
+                           size_t request_length);
+      size_t             enqueueData(bool reliable, size_t request_length,
+                           std::chrono::steady_clock::time_point deadline);
+      [[noreturn]] void  fail(int error, const std::string& action);
+      size_t             locateDelim(const char* delim, size_t delim_length);
+      void               prepareAwait();
+      ssize_t            receive(char* data, size_t length, bool& passed);
+      char*              reserve(size_t& length, bool partial = true);
+      bool               reset();
+      void               terminate(ConnectionState state);
 
     public:
       Connection(const std::string& addr, int port);
+      Connection(const std::string& addr, int port,
+        std::chrono::milliseconds timeout);
       Connection(const std::string& laddr, const std::string& raddr,
         int port, int socket);
+      Connection(const struct sockaddr_storage& laddr,
+        const struct sockaddr_storage& raddr, int port, int socket,
+        bool blocking = true);
+      explicit Connection(int socket);
      ~Connection();
+      static std::shared_ptr<Connection> connect(
+        const std::vector<std::string>& addrs, int port,
+        std::chrono::milliseconds timeout, std::chrono::milliseconds
+        attempt_delay = std::chrono::milliseconds{250});
+      static std::shared_ptr<Connection> connect(
+        const std::vector<struct sockaddr_storage>& addrs, int port,
+        std::chrono::milliseconds timeout, std::chrono::milliseconds
+        attempt_delay = std::chrono::milliseconds{250});
+      void               close();
+      void               consume(size_t length);
       size_t             enqueueData(bool reliable = false, size_t
                            request_length = MAX_BYTES);
+      bool               flush();
+      WriteAwaiter       flushAsync(EventLoop& loop);
+      size_t             getBufferLimit()               const;
+      BufferPolicy       getBufferPolicy()              const;
       int                getDescriptor()                const;
       SocketFamily       getFamily()                    const;
       ConnectionFlow     getFlow()                      const;
       const std::string& getListen()                    const;
+      const ConnectionMetrics& getMetrics()             const;
       int                getPort()                      const;
+      std::chrono::milliseconds getReadTimeout()        const;
       const std::string& getRemote()                    const;
+      ConnectionState    getState()                     const;
+      Transport*         getTransport()                 const;
+      std::chrono::milliseconds getWriteTimeout()       const;
+      bool               isBlocking()                   const;
+      bool               isPaused()                     const;
+      std::string_view   peek()                         const;
+      size_t             pending()                      const;
+      size_t             pipeTo(Connection& destination, size_t length =
+                           static_cast<size_t>(-1));
+      void               queue(std::string data);
+      void               queue(std::shared_ptr<const std::string> data);
+      void               queueView(std::string_view data);
       std::string        read(bool reliable = false, size_t
                            request_length = MAX_BYTES);
+      ReadAwaiter        readAsync(EventLoop& loop, size_t length =
+                           MAX_BYTES);
       std::string        readDelim(char delim = '\n');
+      std::string        readDelim(const std::string& delim);
+      ReadDelimAwaiter   readDelimAsync(EventLoop& loop,
+                           std::string delim = "\n");
+      std::string_view   readDelimView(char delim = '\n');
+      std::string_view   readDelimView(const std::string& delim);
+      std::string_view   readView(bool reliable = false, size_t
+                           request_length = MAX_BYTES);
+      int                receiveDescriptor();
+      bool               sendDescriptor(int descriptor);
+      size_t             sendFile(int descriptor, off_t offset,
+                           size_t length);
+      void               setBlocking(bool blocking);
+      void               setBufferLimit(size_t limit, BufferPolicy policy =
+                           BufferPolicy::Error);
+      void               setReadTimeout(std::chrono::milliseconds timeout);
+      void               setRing(std::shared_ptr<IOUring> ring);
+      void               setTransport(std::unique_ptr<Transport> transport);
+      void               setWriteTimeout(std::chrono::milliseconds timeout);
       bool               valid()                        const;
-      void write(std::string data, bool newline = true) const;
+      void write(std::string data, bool newline = true);
+      WriteAwaiter writeAsync(EventLoop& loop, std::string data,
+        bool newline = true);
   };
 }
 
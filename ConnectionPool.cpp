@@ -0,0 +1,244 @@
+/**
+ * @file      ConnectionPool.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `ConnectionPool` object.
+ */
+
+#include <chrono>              // for steady_clock
+#include <memory>              // for shared_ptr, unique_ptr, weak_ptr
+#include <mutex>               // for lock_guard, mutex
+#include <string>              // for string
+#include <sys/errno.h>         // for EAGAIN, EINTR, EWOULDBLOCK, errno
+#include <sys/socket.h>        // for recv, MSG_DONTWAIT, MSG_PEEK
+#include <utility>             // for move
+#include <vector>              // for vector
+#include "CFNetwork.hpp"       // for UnexpectedError
+#include "Connection.hpp"      // for Connection
+#include "ConnectionPool.hpp"  // for ConnectionPool
+
+namespace CFNetwork {
+  /**
+   * `ConnectionPool` Constructor.
+   *
+   * Constructs an empty `ConnectionPool` with the provided limits.
+   *
+   * @param max_idle     The maximum number of idle connections kept for each
+   *                     destination
+   * @param max_total    The maximum number of connections (idle or in use)
+   *                     open to each destination
+   * @param idle_timeout How long a connection may remain idle before it is
+   *                     closed
+   */
+  ConnectionPool::ConnectionPool(size_t max_idle, size_t max_total,
+      std::chrono::steady_clock::duration idle_timeout) :
+      state{std::make_shared<State>()} {
+    this->state->idle_timeout = idle_timeout;
+    this->state->max_idle     = max_idle;
+    this->state->max_total    = max_total;
+  }
+
+  /**
+   * `ConnectionPool` Destructor.
+   *
+   * Upon destruction of a `ConnectionPool` object, close every idle
+   * connection. Connections that are still in use are closed once released.
+   */
+  ConnectionPool::~ConnectionPool() {
+    this->clear();
+  }
+
+  /**
+   * Fetches a `Connection` to the provided destination.
+   *
+   * The most recently released idle `Connection` that passes a health check is
+   * reused if available, otherwise a new `Connection` is made (which blocks
+   * until connected). The returned `Connection` is returned to the pool once
+   * the last `std::shared_ptr` referring to it is released.
+   *
+   * @throws `InvalidArgument` if the address or port is invalid.
+   * @throws `UnexpectedError` if the destination already has the maximum
+   *         number of connections in use, or a new connection couldn't be made.
+   *
+   * @param  addr The address of the remote endpoint
+   * @param  port The port of the remote endpoint
+   *
+   * @return `Connection` object connected to the destination.
+   */
+  std::shared_ptr<Connection> ConnectionPool::acquire(const std::string& addr,
+      int port) {
+    Key key{addr, port};
+    std::unique_ptr<Connection> connection{};
+    std::vector<std::unique_ptr<Connection>> stale{};
+    {
+      std::lock_guard<std::mutex> lock{this->state->mutex};
+      Destination& destination = this->state->destinations[key];
+      auto now = std::chrono::steady_clock::now();
+      // Prefer the most recently released connection since it is the least
+      // likely to have been closed by the remote peer
+      while (!connection && !destination.idle.empty()) {
+        Idle& idle = destination.idle.back();
+        if (now - idle.since <= this->state->idle_timeout &&
+            ConnectionPool::healthy(*idle.connection))
+          connection = std::move(idle.connection);
+        else {
+          stale.push_back(std::move(idle.connection));
+          --destination.total;
+        }
+        destination.idle.pop_back();
+      }
+      // Reserve a slot for a new connection if no idle connection was usable
+      if (!connection) {
+        if (destination.total >= this->state->max_total)
+          throw UnexpectedError{"The connection limit for [" + addr + "]:" +
+            std::to_string(port) + " was reached."};
+        ++destination.total;
+      }
+    }
+    // Stale connections are closed once `stale` goes out of scope, after the
+    // lock has been released
+    if (!connection) {
+      try {
+        connection.reset(new Connection{addr, port});
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock{this->state->mutex};
+        --this->state->destinations[key].total;
+        throw;
+      }
+    }
+    std::weak_ptr<State> state = this->state;
+    return std::shared_ptr<Connection>{connection.release(),
+      [state, key](Connection* released) {
+        ConnectionPool::release(state, key, released);
+      }};
+  }
+
+  /**
+   * Closes every idle connection.
+   */
+  void ConnectionPool::clear() {
+    std::vector<std::unique_ptr<Connection>> stale{};
+    std::lock_guard<std::mutex> lock{this->state->mutex};
+    for (auto& entry : this->state->destinations) {
+      for (Idle& idle : entry.second.idle)
+        stale.push_back(std::move(idle.connection));
+      entry.second.total -= entry.second.idle.size();
+      entry.second.idle.clear();
+    }
+  }
+
+  /**
+   * Fetches the number of idle connections to the provided destination.
+   *
+   * @param  addr The address of the remote endpoint
+   * @param  port The port of the remote endpoint
+   *
+   * @return The number of idle connections.
+   */
+  size_t ConnectionPool::getIdle(const std::string& addr, int port) const {
+    std::lock_guard<std::mutex> lock{this->state->mutex};
+    auto it = this->state->destinations.find(Key{addr, port});
+    return it == this->state->destinations.end() ? 0 : it->second.idle.size();
+  }
+
+  /**
+   * Fetches the number of connections (idle or in use) open to the provided
+   * destination.
+   *
+   * @param  addr The address of the remote endpoint
+   * @param  port The port of the remote endpoint
+   *
+   * @return The number of open connections.
+   */
+  size_t ConnectionPool::getTotal(const std::string& addr, int port) const {
+    std::lock_guard<std::mutex> lock{this->state->mutex};
+    auto it = this->state->destinations.find(Key{addr, port});
+    return it == this->state->destinations.end() ? 0 : it->second.total;
+  }
+
+  /**
+   * Cheaply determines whether or not an idle `Connection` can be reused.
+   *
+   * A single non-blocking `recv(2)` peeks at the `Connection`. An idle
+   * connection should have nothing to read; if the remote peer closed it, sent
+   * unsolicited data or reset it, the `Connection` is considered unhealthy.
+   *
+   * @param  connection The `Connection` to check
+   *
+   * @return `true` if the `Connection` can be reused, `false` otherwise.
+   */
+  bool ConnectionPool::healthy(const Connection& connection) {
+    char byte;
+    ssize_t result;
+    do result = recv(connection.getDescriptor(), &byte, 1,
+      MSG_PEEK | MSG_DONTWAIT);
+    while (result < 0 && errno == EINTR);
+    return result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+
+  /**
+   * Closes every connection that has been idle for longer than the idle
+   * timeout.
+   *
+   * Expired connections are also discarded lazily by `acquire()`; this method
+   * can be called periodically to release their resources sooner.
+   *
+   * @return The number of connections that were closed.
+   */
+  size_t ConnectionPool::prune() {
+    std::vector<std::unique_ptr<Connection>> stale{};
+    std::lock_guard<std::mutex> lock{this->state->mutex};
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = this->state->destinations.begin();
+        it != this->state->destinations.end();) {
+      Destination& destination = it->second;
+      // Idle connections are ordered by release time, oldest first
+      while (!destination.idle.empty() && now - destination.idle.front().since >
+          this->state->idle_timeout) {
+        stale.push_back(std::move(destination.idle.front().connection));
+        destination.idle.pop_front();
+        --destination.total;
+      }
+      if (destination.total == 0)
+        it = this->state->destinations.erase(it);
+      else ++it;
+    }
+    return stale.size();
+  }
+
+  /**
+   * Returns a released `Connection` to the pool or closes it.
+   *
+   * A `Connection` is only kept if the pool still exists, the destination has
+   * room for another idle connection, and the `Connection` is open with no
+   * unconsumed or unwritten data. Its default options are restored first, and
+   * a `Connection` with a `Transport` or `IOUring` attached is never kept.
+   *
+   * @param state      The state of the `ConnectionPool`
+   * @param key        The destination of the `Connection`
+   * @param connection The released `Connection`
+   */
+  void ConnectionPool::release(const std::weak_ptr<State>& state,
+      const Key& key, Connection* connection) {
+    std::unique_ptr<Connection> owned{connection};
+    std::shared_ptr<State> pool = state.lock();
+    if (!pool) return;
+    // Restore the default options so that the next user gets a fresh
+    // connection
+    bool reusable = owned->valid() && owned->peek().empty() &&
+      owned->pending() == 0 && owned->reset();
+    {
+      std::lock_guard<std::mutex> lock{pool->mutex};
+      Destination& destination = pool->destinations[key];
+      if (reusable && destination.idle.size() < pool->max_idle) {
+        destination.idle.push_back(Idle{std::move(owned),
+          std::chrono::steady_clock::now()});
+        return;
+      }
+      --destination.total;
+    }
+    // `owned` is closed here, after the lock has been released
+  }
+}
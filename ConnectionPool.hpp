@@ -0,0 +1,113 @@
+/**
+ * @file      ConnectionPool.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `ConnectionPool` object.
+ */
+
+#ifndef _CFNETWORKCONNECTIONPOOL_H
+#define _CFNETWORKCONNECTIONPOOL_H
+
+#include <chrono>         // for steady_clock, seconds
+#include <deque>          // for deque
+#include <map>            // for map
+#include <memory>         // for shared_ptr, unique_ptr, weak_ptr
+#include <mutex>          // for mutex
+#include <string>         // for string
+#include <utility>        // for pair
+#include "CFNetwork.hpp"  // for Connection
+
+namespace CFNetwork {
+  /**
+   * @class ConnectionPool
+   * A thread-safe cache of idle outbound `Connection` objects.
+   *
+   * The `ConnectionPool` object hands out outbound `Connection` objects keyed
+   * by their remote address and port. When the last `std::shared_ptr` to a
+   * pooled `Connection` is released, the `Connection` is returned to the pool
+   * (instead of being closed) so that the next request to the same destination
+   * can skip the TCP handshake.
+   *
+   * A `Connection` is only returned to the pool if it is still open and all of
+   * its data has been consumed and written. Idle connections are checked with a
+   * single non-blocking `recv(2)` before being reused, and are closed once they
+   * have been idle for longer than the configured timeout. The number of idle
+   * and total connections per destination is capped.
+   *
+   * Pooled `Connection` objects may outlive the `ConnectionPool`, in which case
+   * they are simply closed when released.
+   *
+   * The `ConnectionPool` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class ConnectionPool {
+    private:
+      ConnectionPool(const ConnectionPool&);
+      ConnectionPool& operator= (const ConnectionPool&);
+
+    protected:
+      /**
+       * @typedef Key
+       * Identifies a destination by its remote address and port.
+       */
+      typedef std::pair<std::string, int> Key;
+
+      /**
+       * @struct Idle
+       * An idle `Connection` along with the time that it was released.
+       */
+      struct Idle {
+        std::unique_ptr<Connection>           connection;
+        std::chrono::steady_clock::time_point since;
+      };
+
+      /**
+       * @struct Destination
+       * The idle connections of a single destination and the number of
+       * connections (idle or in use) that it currently has open.
+       */
+      struct Destination {
+        std::deque<Idle> idle;
+        size_t           total = 0;
+      };
+
+      /**
+       * @struct State
+       * The state shared between a `ConnectionPool` and the deleters of the
+       * `Connection` objects that it hands out.
+       */
+      struct State {
+        std::map<Key, Destination>          destinations;
+        std::chrono::steady_clock::duration idle_timeout;
+        size_t                              max_idle  = 0;
+        size_t                              max_total = 0;
+        std::mutex                          mutex;
+      };
+
+      /**
+       * @var state
+       * Holds the destinations of a `ConnectionPool`.
+       */
+      std::shared_ptr<State> state;
+
+      static bool healthy(const Connection& connection);
+      static void release(const std::weak_ptr<State>& state, const Key& key,
+                    Connection* connection);
+
+    public:
+      ConnectionPool(size_t max_idle = 8, size_t max_total = 64,
+        std::chrono::steady_clock::duration idle_timeout =
+          std::chrono::seconds{60});
+     ~ConnectionPool();
+      std::shared_ptr<Connection> acquire(const std::string& addr, int port);
+      void                        clear();
+      size_t                      getIdle(const std::string& addr,
+                                    int port)                 const;
+      size_t                      getTotal(const std::string& addr,
+                                    int port)                 const;
+      size_t                      prune();
+  };
+}
+
+#endif
@@ -0,0 +1,481 @@
+/**
+ * @file      DatagramSocket.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `DatagramSocket` object.
+ */
+
+#include <cstdint>             // for uint16_t
+#include <cstring>             // for memcpy
+#include <netinet/in.h>        // for sockaddr_in, sockaddr_in6, htons, ntohs
+#include <netinet/udp.h>       // for SOL_UDP, UDP_GRO, UDP_SEGMENT
+#include <string>              // for string, to_string
+#include <string_view>         // for string_view
+#include <sys/errno.h>         // for EAGAIN, EINTR, EIO, ENOPROTOOPT, ...
+#include <sys/socket.h>        // for recvmmsg, sendmmsg, mmsghdr, cmsghdr, ...
+#include <sys/uio.h>           // for iovec
+#include <unistd.h>            // for close
+#include <vector>              // for vector
+#include "CFNetwork.hpp"       // for InvalidArgument, UnexpectedError, ...
+#include "DatagramSocket.hpp"  // for DatagramSocket, Datagram
+
+namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  namespace {
+    // The largest UDP payload that fits in a single IPv4 datagram
+    const size_t UDP_MAX_PAYLOAD  = 65507;
+    // The most segments that the kernel accepts in a single offloaded send
+    const size_t UDP_MAX_SEGMENTS = 64;
+    // The largest buffer that can be produced by generic receive offload
+    const size_t UDP_GRO_SLOT     = 65535;
+  }
+  #endif
+
+  /**
+   * `DatagramSocket` Constructor.
+   *
+   * Constructs a `DatagramSocket` object bound to the given local address and
+   * port, and allocates storage for `batch` datagrams of up to `slot_size`
+   * bytes each. A port of zero binds to an ephemeral port, which can be
+   * fetched afterwards using `getPort()`.
+   *
+   * @throws `InvalidArgument` if the address, port, batch or slot size is
+   *         invalid.
+   * @throws `UnexpectedError` if the socket couldn't be created or bound.
+   *
+   * @param  addr      `std::string` object containing the local address
+   * @param  port      `int` containing the local port number
+   * @param  batch     The maximum number of datagrams moved per system call
+   * @param  slot_size The largest datagram that can be received without
+   *                   truncation
+   */
+  DatagramSocket::DatagramSocket(const std::string& addr, int port,
+      size_t batch, size_t slot_size) {
+    // Ensure the validity of the provided port and storage sizes
+    if (port < 0 || port > 65535)
+      throw InvalidArgument{"The provided port number is out of range."};
+    if (batch == 0 || slot_size == 0)
+      throw InvalidArgument{"The batch and slot sizes must be non-zero."};
+    // Fetch a finalized sockaddr_storage for the given address
+    struct sockaddr_storage address = parseAddress(addr);
+    if (address.ss_family != AF_INET && address.ss_family != AF_INET6)
+      throw InvalidArgument{"The local address has an unexpected address "
+        "family."};
+    this->family = (address.ss_family == AF_INET ?
+      SocketFamily::IPv4 : SocketFamily::IPv6);
+    this->host   = formatAddress(address);
+    *(this->family == SocketFamily::IPv4 ? port4(address) : port6(address)) =
+      htons(static_cast<uint16_t>(port));
+    // Setup the socket using the appropriate address family and type
+    this->socket = ::socket(address.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (this->socket < 0)
+      throw UnexpectedError{"Couldn't create a socket for [" + this->host +
+        "]:" + std::to_string(port)};
+    // Attempt to bind the socket to the local address
+    socklen_t length = addressLength(address);
+    if (bind(this->socket, addr_(address), length) < 0 ||
+        getsockname(this->socket, addr_(address), &length) < 0) {
+      // A problem occurred, close the socket and throw an exception
+      close(this->socket);
+      throw UnexpectedError{"Couldn't bind to [" + this->host + "]:" +
+        std::to_string(port)};
+    }
+    // Record the port that was actually bound (in case it was ephemeral)
+    this->port = ntohs(*(this->family == SocketFamily::IPv4 ?
+      port4(address) : port6(address)));
+
+    // Allocate every structure needed for a batch up front
+    this->batch     = batch;
+    this->slot_size = slot_size;
+    this->slots.reset(new char[batch * slot_size]);
+    this->addresses.resize(batch);
+    this->controls.resize(batch);
+    this->headers.resize(batch);
+    this->vectors.resize(batch);
+  }
+
+  /**
+   * `DatagramSocket` Destructor.
+   *
+   * Upon destruction of a `DatagramSocket` object, close its associated file
+   * descriptor.
+   */
+  DatagramSocket::~DatagramSocket() {
+    if (this->valid())
+      close(this->socket);
+  }
+
+  /**
+   * Toggles generic receive offload (`UDP_GRO`) for the `DatagramSocket`.
+   *
+   * With generic receive offload enabled, the kernel may coalesce consecutive
+   * equal-sized datagrams from the same sender into a single buffer, which
+   * `receive()` splits back into individual datagrams. Since a coalesced
+   * buffer can be up to 64 KiB, enabling this option grows every receive slot
+   * to 64 KiB (so the `DatagramSocket` then holds `batch` times 64 KiB of
+   * receive storage).
+   *
+   * @throws `UnexpectedError` if the kernel doesn't support the option.
+   *
+   * @param  enabled Whether or not generic receive offload should be enabled
+   */
+  void DatagramSocket::enableGRO(bool enabled) {
+    int value = enabled ? 1 : 0;
+    if (setsockopt(this->socket, SOL_UDP, UDP_GRO, &value, sizeof(value)) < 0)
+      throw UnexpectedError{"Couldn't configure receive offload on [" +
+        this->host + "]:" + std::to_string(this->port)};
+    if (enabled && this->slot_size < UDP_GRO_SLOT) {
+      this->slot_size = UDP_GRO_SLOT;
+      this->slots.reset(new char[this->batch * this->slot_size]);
+    }
+    this->gro = enabled;
+  }
+
+  /**
+   * Fetches the file descriptor of the `DatagramSocket` instance.
+   *
+   * The internal file descriptor can be used to perform more advanced actions
+   * that this class doesn't accommodate for.
+   *
+   * @return `int` representing a file descriptor.
+   */
+  int DatagramSocket::getDescriptor() const {
+    return this->socket;
+  }
+
+  /**
+   * Fetches the address family of the `DatagramSocket` instance.
+   *
+   * @see    `SocketFamily` for more information on socket families.
+   *
+   * @return `SocketFamily` value describing the address family.
+   */
+  SocketFamily DatagramSocket::getFamily() const {
+    return this->family;
+  }
+
+  /**
+   * Fetches the local address of the associated `DatagramSocket`.
+   *
+   * @return `std::string` of the local address.
+   */
+  const std::string& DatagramSocket::getHost() const {
+    return this->host;
+  }
+
+  /**
+   * Fetches the local port of the `DatagramSocket` instance.
+   *
+   * If the `DatagramSocket` was bound to an ephemeral port, the port that was
+   * chosen by the kernel is returned.
+   *
+   * @return `int` representing the port.
+   */
+  int DatagramSocket::getPort() const {
+    return this->port;
+  }
+
+  /**
+   * Fetches the transport type of the `DatagramSocket` instance.
+   *
+   * @see    `SocketType` for more information on transport types.
+   *
+   * @return `SocketType::UDP`
+   */
+  SocketType DatagramSocket::getType() const {
+    return SocketType::UDP;
+  }
+
+  /**
+   * Determines whether or not the `DatagramSocket` blocks while waiting for
+   * datagrams.
+   *
+   * @return `true` if the `DatagramSocket` is in blocking mode, `false`
+   *         otherwise.
+   */
+  bool DatagramSocket::isBlocking() const {
+    return this->blocking;
+  }
+
+  /**
+   * Determines whether or not generic receive offload is enabled.
+   *
+   * @return `true` if `receive()` may split coalesced buffers, `false`
+   *         otherwise.
+   */
+  bool DatagramSocket::isGROEnabled() const {
+    return this->gro;
+  }
+
+  /**
+   * Receives a batch of datagrams using a single system call.
+   *
+   * `datagrams` is cleared and then filled with up to `batch` datagrams. In
+   * blocking mode this method waits for at least one datagram, and then
+   * collects any others that are already available without waiting. In
+   * non-blocking mode it returns zero if no datagram is available.
+   *
+   * If generic receive offload is enabled, each coalesced buffer is split into
+   * the datagrams that it was built from, so more than `batch` datagrams may
+   * be returned.
+   *
+   * The payload of each datagram refers to storage owned by the
+   * `DatagramSocket`, and remains valid until the next call to this method.
+   *
+   * @throws `UnexpectedError` if the datagrams couldn't be received.
+   *
+   * @param  datagrams The container to fill with the received datagrams
+   *
+   * @return The number of datagrams that were received.
+   */
+  size_t DatagramSocket::receive(std::vector<Datagram>& datagrams) {
+    datagrams.clear();
+    for (size_t i = 0; i < this->batch; ++i) {
+      this->vectors[i].iov_base = this->slots.get() + i * this->slot_size;
+      this->vectors[i].iov_len  = this->slot_size;
+      struct msghdr& header = this->headers[i].msg_hdr;
+      header = {};
+      header.msg_name    = &this->addresses[i];
+      header.msg_namelen = sizeof(struct sockaddr_storage);
+      header.msg_iov     = &this->vectors[i];
+      header.msg_iovlen  = 1;
+      if (this->gro) {
+        header.msg_control    = this->controls[i].data;
+        header.msg_controllen = sizeof(Control::data);
+      }
+    }
+    // Only wait for the first datagram so that a partial batch is returned
+    int result;
+    do result = recvmmsg(this->socket, this->headers.data(),
+      static_cast<unsigned>(this->batch), MSG_WAITFORONE, nullptr);
+    while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+      throw UnexpectedError{"Couldn't receive datagrams on [" + this->host +
+        "]:" + std::to_string(this->port)};
+    }
+    for (int i = 0; i < result; ++i) {
+      const struct mmsghdr& message = this->headers[i];
+      size_t length = message.msg_len < this->slot_size ?
+        message.msg_len : this->slot_size;
+      bool truncated = (message.msg_hdr.msg_flags & MSG_TRUNC) != 0;
+      const char* payload = static_cast<const char*>(this->vectors[i].iov_base);
+      // Determine the size of each segment of a coalesced buffer
+      size_t segment = length;
+      if (this->gro) {
+        for (struct cmsghdr* control = CMSG_FIRSTHDR(&message.msg_hdr);
+            control != nullptr; control = CMSG_NXTHDR(
+            const_cast<struct msghdr*>(&message.msg_hdr), control)) {
+          if (control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(control), sizeof(size));
+            if (size > 0) segment = static_cast<size_t>(size);
+          }
+        }
+      }
+      // Split the buffer into its datagrams (the last may be shorter)
+      for (size_t offset = 0; offset < length || offset == 0;
+          offset += segment) {
+        size_t part = length - offset < segment ? length - offset : segment;
+        datagrams.push_back(Datagram{this->addresses[i],
+          std::string_view{payload + offset, part}, truncated});
+        if (part == 0) break;
+      }
+    }
+    return datagrams.size();
+  }
+
+  /**
+   * Sends a sequence of datagrams using as few system calls as possible.
+   *
+   * The datagrams are sent in batches of up to `batch` datagrams per call to
+   * `sendmmsg(2)`. In non-blocking mode this method stops early if the
+   * kernel's send buffer is full.
+   *
+   * @throws `UnexpectedError` if a datagram couldn't be sent.
+   *
+   * @param  datagrams The datagrams (and their destinations) to send
+   * @param  count     The number of datagrams to send
+   *
+   * @return The number of datagrams that were sent.
+   */
+  size_t DatagramSocket::send(const Datagram* datagrams, size_t count) {
+    size_t sent = 0;
+    while (sent < count) {
+      size_t chunk = count - sent < this->batch ? count - sent : this->batch;
+      for (size_t i = 0; i < chunk; ++i) {
+        const Datagram& datagram = datagrams[sent + i];
+        this->vectors[i].iov_base = const_cast<char*>(datagram.payload.data());
+        this->vectors[i].iov_len  = datagram.payload.length();
+        struct msghdr& header = this->headers[i].msg_hdr;
+        header = {};
+        header.msg_name    = const_cast<struct sockaddr_storage*>(
+          &datagram.address);
+        header.msg_namelen = addressLength(datagram.address);
+        header.msg_iov     = &this->vectors[i];
+        header.msg_iovlen  = 1;
+      }
+      int result;
+      do result = sendmmsg(this->socket, this->headers.data(),
+        static_cast<unsigned>(chunk), 0);
+      while (result < 0 && errno == EINTR);
+      if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        throw UnexpectedError{"Couldn't send datagram to [" +
+          formatAddress(datagrams[sent].address) + "]"};
+      }
+      sent += static_cast<size_t>(result);
+    }
+    return sent;
+  }
+
+  /**
+   * Sends a sequence of datagrams using as few system calls as possible.
+   *
+   * @see    `send(const Datagram*, size_t)` for more information.
+   *
+   * @param  datagrams The datagrams (and their destinations) to send
+   *
+   * @return The number of datagrams that were sent.
+   */
+  size_t DatagramSocket::send(const std::vector<Datagram>& datagrams) {
+    return this->send(datagrams.data(), datagrams.size());
+  }
+
+  /**
+   * Sends a single datagram to the provided address and port.
+   *
+   * This convenience method parses the address on every call; use one of the
+   * batched overloads to send many datagrams efficiently.
+   *
+   * @throws `InvalidArgument` if the address, its address family or the port
+   *         is invalid.
+   * @throws `UnexpectedError` if the datagram couldn't be sent.
+   *
+   * @param  addr    The address of the remote endpoint
+   * @param  port    The port of the remote endpoint
+   * @param  payload The contents of the datagram
+   *
+   * @return `true` if the datagram was sent, `false` if a non-blocking
+   *         `DatagramSocket` couldn't send it without waiting.
+   */
+  bool DatagramSocket::send(const std::string& addr, int port,
+      std::string_view payload) {
+    if (port < 1 || port > 65535)
+      throw InvalidArgument{"The provided port number is out of range."};
+    Datagram datagram{parseAddress(addr), payload, false};
+    if (datagram.address.ss_family != AF_INET &&
+        datagram.address.ss_family != AF_INET6)
+      throw InvalidArgument{"The remote address has an unexpected address "
+        "family."};
+    *(datagram.address.ss_family == AF_INET ? port4(datagram.address) :
+      port6(datagram.address)) = htons(static_cast<uint16_t>(port));
+    return this->send(&datagram, 1) == 1;
+  }
+
+  /**
+   * Sends a run of equal-sized datagrams to a single destination using generic
+   * segmentation offload (`UDP_SEGMENT`).
+   *
+   * `data` is split into datagrams of `segment_size` bytes (the last may be
+   * shorter). Rather than describing every datagram to the kernel, up to 64
+   * consecutive datagrams are passed as a single buffer which the kernel (or
+   * network device) segments, and up to `batch` of those buffers are passed
+   * to each call to `sendmmsg(2)`. If the kernel doesn't support segmentation
+   * offload, the datagrams are sent individually instead.
+   *
+   * In non-blocking mode this method stops early if the kernel's send buffer
+   * is full. Since whole buffers are either sent or not, the returned length
+   * always ends on a datagram boundary.
+   *
+   * @throws `InvalidArgument` if the segment size is out of range.
+   * @throws `UnexpectedError` if the datagrams couldn't be sent.
+   *
+   * @param  address      The destination of every datagram
+   * @param  data         The concatenated contents of the datagrams
+   * @param  segment_size The size of each datagram
+   *
+   * @return The number of bytes of `data` that were sent.
+   */
+  size_t DatagramSocket::sendSegmented(const struct sockaddr_storage& address,
+      std::string_view data, size_t segment_size) {
+    if (segment_size == 0 || segment_size > UDP_MAX_PAYLOAD)
+      throw InvalidArgument{"The provided segment size is out of range."};
+    size_t sent = 0;
+    // Each buffer holds as many whole segments as the kernel accepts at once
+    size_t segments = UDP_MAX_PAYLOAD / segment_size;
+    if (segments > UDP_MAX_SEGMENTS) segments = UDP_MAX_SEGMENTS;
+    size_t span = segments * segment_size;
+    while (this->gso && sent < data.length()) {
+      size_t offset = sent, chunk = 0;
+      for (; chunk < this->batch && offset < data.length(); ++chunk) {
+        size_t length = data.length() - offset < span ?
+          data.length() - offset : span;
+        this->vectors[chunk].iov_base = const_cast<char*>(data.data() + offset);
+        this->vectors[chunk].iov_len  = length;
+        offset += length;
+        struct msghdr& header = this->headers[chunk].msg_hdr;
+        header = {};
+        header.msg_name       = const_cast<struct sockaddr_storage*>(&address);
+        header.msg_namelen    = addressLength(address);
+        header.msg_iov        = &this->vectors[chunk];
+        header.msg_iovlen     = 1;
+        header.msg_control    = this->controls[chunk].data;
+        header.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        struct cmsghdr* control = CMSG_FIRSTHDR(&header);
+        control->cmsg_level = SOL_UDP;
+        control->cmsg_type  = UDP_SEGMENT;
+        control->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+        uint16_t size = static_cast<uint16_t>(segment_size);
+        memcpy(CMSG_DATA(control), &size, sizeof(size));
+      }
+      int result;
+      do result = sendmmsg(this->socket, this->headers.data(),
+        static_cast<unsigned>(chunk), 0);
+      while (result < 0 && errno == EINTR);
+      if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return sent;
+        // Fall back to individual datagrams if offload isn't supported
+        if (sent == 0 && (errno == ENOPROTOOPT || errno == EOPNOTSUPP ||
+            errno == EIO || errno == EINVAL)) {
+          this->gso = false;
+          break;
+        }
+        throw UnexpectedError{"Couldn't send datagram to [" +
+          formatAddress(address) + "]"};
+      }
+      for (int i = 0; i < result; ++i)
+        sent += this->vectors[i].iov_len;
+    }
+    // Send any remaining data one datagram at a time
+    std::vector<Datagram> datagrams;
+    for (size_t offset = sent; offset < data.length(); offset += segment_size)
+      datagrams.push_back(Datagram{address, data.substr(offset, segment_size),
+        false});
+    size_t count = this->send(datagrams);
+    for (size_t i = 0; i < count; ++i)
+      sent += datagrams[i].payload.length();
+    return sent;
+  }
+
+  /**
+   * Toggles blocking mode for the `DatagramSocket`.
+   *
+   * @param blocking Whether or not the `DatagramSocket` should block
+   */
+  void DatagramSocket::setBlocking(bool blocking) {
+    CFNetwork::setBlocking(this->socket, blocking);
+    this->blocking = blocking;
+  }
+
+  /**
+   * Determines if the file descriptor is considered valid for sending,
+   * receiving or any other operations.
+   *
+   * @return `true` if the file descriptor is valid, `false` otherwise.
+   */
+  bool DatagramSocket::valid() const {
+    return this->socket >= 0;
+  }
+}
@@ -0,0 +1,181 @@
+/**
+ * @file      DatagramSocket.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `DatagramSocket` object.
+ */
+
+#ifndef _CFNETWORKDATAGRAMSOCKET_H
+#define _CFNETWORKDATAGRAMSOCKET_H
+
+#include <cstddef>        // for size_t
+#include <memory>         // for unique_ptr
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <sys/socket.h>   // for mmsghdr, sockaddr_storage
+#include <sys/uio.h>      // for iovec
+#include <vector>         // for vector
+#include "CFNetwork.hpp"  // for SocketFamily, SocketType
+
+namespace CFNetwork {
+  /**
+   * @struct Datagram
+   * A single datagram and the address of its sender (or recipient).
+   *
+   * Received datagrams refer to storage owned by the `DatagramSocket` that
+   * received them, so their `payload` is only valid until the next call to
+   * `receive()`.
+   */
+  struct Datagram {
+    /**
+     * @var address
+     * The address (and port) of the remote endpoint.
+     */
+    struct sockaddr_storage address;
+    /**
+     * @var payload
+     * The contents of the datagram.
+     */
+    std::string_view        payload;
+    /**
+     * @var truncated
+     * Whether or not the datagram was larger than the receive slot and was
+     * truncated to fit.
+     */
+    bool                    truncated;
+  };
+
+  /**
+   * @class DatagramSocket
+   * An object-oriented encapsulation for UDP sockets.
+   *
+   * The `DatagramSocket` object sends and receives batches of datagrams using
+   * `recvmmsg(2)` and `sendmmsg(2)`, so that a single system call moves up to
+   * `batch` datagrams. Every structure required by the kernel (message
+   * headers, `iovec` arrays, address storage and the receive slots themselves)
+   * is allocated once at construction and reused by every call.
+   *
+   * Bulk transfers can additionally be offloaded to the kernel: equal-sized
+   * datagrams to one peer can be sent as a single large buffer that the kernel
+   * segments (generic segmentation offload, see `sendSegmented()`), and
+   * consecutive datagrams from one peer can be received as a single coalesced
+   * buffer that is split back into datagrams in user space (generic receive
+   * offload, see `enableGRO()`).
+   *
+   * The `DatagramSocket` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class DatagramSocket {
+    private:
+      DatagramSocket(const DatagramSocket&);
+      DatagramSocket& operator= (const DatagramSocket&);
+
+    protected:
+      /**
+       * @struct Control
+       * Storage for the ancillary data of a single message (which carries the
+       * segment size used by generic segmentation and receive offload).
+       */
+      struct Control {
+        alignas(struct cmsghdr) char data[CMSG_SPACE(sizeof(int))];
+      };
+
+      /**
+       * @var addresses
+       * Storage for the sender address of each received datagram.
+       */
+      std::vector<struct sockaddr_storage> addresses;
+      /**
+       * @var batch
+       * The maximum number of datagrams moved by each system call.
+       */
+      size_t                               batch    = 0;
+      /**
+       * @var blocking
+       * Whether or not the file descriptor of a `DatagramSocket` blocks when no
+       * datagrams are available.
+       */
+      bool                                 blocking = true;
+      /**
+       * @var controls
+       * The ancillary data storage of each message.
+       */
+      std::vector<Control>                 controls;
+      /**
+       * @var family
+       * Used to describe the socket family type of a `DatagramSocket`.
+       */
+      SocketFamily                         family   = SocketFamily::IPv4;
+      /**
+       * @var gro
+       * Whether or not generic receive offload is enabled.
+       */
+      bool                                 gro      = false;
+      /**
+       * @var gso
+       * Whether or not generic segmentation offload is supported by the kernel.
+       */
+      bool                                 gso      = true;
+      /**
+       * @var headers
+       * The message headers passed to `recvmmsg(2)` and `sendmmsg(2)`.
+       */
+      std::vector<struct mmsghdr>          headers;
+      /**
+       * @var host
+       * Holds the local address associated with a `DatagramSocket`.
+       */
+      std::string                          host     = "0.0.0.0";
+      /**
+       * @var port
+       * Holds the local port associated with a `DatagramSocket`.
+       */
+      int                                  port     = 0;
+      /**
+       * @var slot_size
+       * The size of each receive slot (the largest datagram that can be
+       * received without truncation).
+       */
+      size_t                               slot_size = 0;
+      /**
+       * @var slots
+       * The receive slots that datagram payloads are written into.
+       */
+      std::unique_ptr<char[]>              slots;
+      /**
+       * @var socket
+       * Holds the file descriptor associated with a `DatagramSocket`.
+       */
+      int                                  socket   = -1;
+      /**
+       * @var vectors
+       * The `iovec` structure describing each message.
+       */
+      std::vector<struct iovec>            vectors;
+
+    public:
+      DatagramSocket(const std::string& addr = "0.0.0.0", int port = 0,
+        size_t batch = 64, size_t slot_size = 2048);
+     ~DatagramSocket();
+      void               enableGRO(bool enabled = true);
+      int                getDescriptor()                          const;
+      SocketFamily       getFamily()                              const;
+      const std::string& getHost()                                const;
+      int                getPort()                                const;
+      SocketType         getType()                                const;
+      bool               isBlocking()                             const;
+      bool               isGROEnabled()                           const;
+      size_t             receive(std::vector<Datagram>& datagrams);
+      size_t             send(const Datagram* datagrams, size_t count);
+      size_t             send(const std::vector<Datagram>& datagrams);
+      bool               send(const std::string& addr, int port,
+                           std::string_view payload);
+      size_t             sendSegmented(const struct sockaddr_storage& address,
+                           std::string_view data, size_t segment_size);
+      void               setBlocking(bool blocking);
+      bool               valid()                                  const;
+  };
+}
+
+#endif
@@ -0,0 +1,461 @@
+/**
+ * @file      EventLoop.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `EventLoop` object.
+ */
+
+#include <chrono>          // for milliseconds
+#include <cstdint>         // for uint32_t, uint64_t
+#include <memory>          // for shared_ptr, make_shared
+#include <new>             // for bad_alloc
+#include <string>          // for to_string
+#include <sys/epoll.h>     // for epoll_create1, epoll_ctl, epoll_wait, ...
+#include <sys/errno.h>     // for EEXIST, EINTR, ENOENT, errno
+#include <sys/eventfd.h>   // for eventfd, EFD_CLOEXEC, EFD_NONBLOCK
+#include <unistd.h>        // for close, read, write
+#include <utility>         // for exchange, move
+#include <vector>          // for vector
+#include "Awaiter.hpp"     // for Awaiter
+#include "CFNetwork.hpp"   // for InvalidArgument, UnexpectedError
+#include "Connection.hpp"  // for Connection
+#include "EventLoop.hpp"   // for EventLoop
+#include "Socket.hpp"      // for Socket
+#include "TimerWheel.hpp"  // for TimerWheel
+
+namespace CFNetwork {
+  /**
+   * `EventLoop` Constructor.
+   *
+   * Constructs an `EventLoop` object capable of retrieving up to `max_events`
+   * events from the kernel per iteration.
+   *
+   * @throws `InvalidArgument` if `max_events` is zero.
+   * @throws `UnexpectedError` if the `epoll(7)` instance couldn't be created.
+   *
+   * @param max_events The maximum number of events to handle per iteration
+   */
+  EventLoop::EventLoop(size_t max_events) {
+    if (max_events == 0)
+      throw InvalidArgument{"The maximum number of events is invalid."};
+    this->events.resize(max_events);
+    // Create the epoll instance and the eventfd used to interrupt it
+    this->epoll  = epoll_create1(EPOLL_CLOEXEC);
+    this->wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (this->epoll < 0 || this->wakeup < 0) {
+      // A problem occurred, close any descriptors and throw an exception
+      if (this->epoll  >= 0) close(this->epoll);
+      if (this->wakeup >= 0) close(this->wakeup);
+      throw UnexpectedError{"Couldn't create the event loop."};
+    }
+    // Drain the eventfd counter whenever `stop()` signals it
+    int wakeup = this->wakeup;
+    this->watch(wakeup, EPOLLIN, [wakeup](uint32_t) {
+      uint64_t value = 0;
+      while (::read(wakeup, &value, sizeof(value)) > 0);
+    });
+  }
+
+  /**
+   * `EventLoop` Destructor.
+   *
+   * Upon destruction of an `EventLoop` object, close its associated file
+   * descriptors and release any registered `Connection` objects.
+   */
+  EventLoop::~EventLoop() {
+    // Registered `Connection` objects may outlive the loop, so they must no
+    // longer notify it once closed
+    for (auto& entry : this->handlers)
+      if (entry.second->connection) entry.second->connection->loop = nullptr;
+    close(this->wakeup);
+    close(this->epoll);
+  }
+
+  /**
+   * Registers a `Socket` with the `EventLoop` to accept clients.
+   *
+   * The `Socket` is placed in non-blocking mode and every pending client is
+   * accepted (in batches) and passed to `accepted` when the `Socket` becomes
+   * readable. Accepted clients are already in non-blocking mode. The
+   * caller retains ownership of the `Socket`, which must outlive its
+   * registration.
+   *
+   * @param socket   The listening `Socket` to register
+   * @param accepted The callback to invoke with each accepted `Connection`
+   */
+  void EventLoop::add(Socket& socket, AcceptHandler accepted) {
+    socket.setBlocking(false);
+    Socket* listener = &socket;
+    this->watch(socket.getDescriptor(), EPOLLIN | EPOLLET,
+        [listener, accepted, clients = std::vector<std::shared_ptr<
+          Connection>>{}](uint32_t) mutable {
+      // Drain all pending clients since no further edge will be reported
+      clients.clear();
+      while (listener->accept(clients) > 0) {
+        for (std::shared_ptr<Connection>& client : clients)
+          accepted(std::move(client));
+        clients.clear();
+      }
+    });
+  }
+
+  /**
+   * Registers a `Connection` with the `EventLoop`.
+   *
+   * The `Connection` is placed in non-blocking mode and retained by the loop
+   * until it is closed by the remote peer or removed using `remove()`.
+   *
+   * `readable` is invoked when new data arrives, `writable` (if provided) is
+   * invoked when the kernel's send buffer has room for more data, and `closed`
+   * (if provided) is invoked once the remote peer hangs up, an error occurs or
+   * the `Connection` is closed elsewhere (e.g. by another callback, a timer or
+   * a `ConnectionPool`). After `closed` is invoked, the `Connection` is
+   * automatically removed.
+   *
+   * @param connection The `Connection` to register
+   * @param readable   The callback to invoke when data is available
+   * @param writable   The callback to invoke when data can be written
+   * @param closed     The callback to invoke when the peer hangs up
+   */
+  void EventLoop::add(const std::shared_ptr<Connection>& connection,
+      ConnectionHandler readable, ConnectionHandler writable,
+      ConnectionHandler closed) {
+    if (!connection)
+      throw InvalidArgument{"The provided connection is invalid."};
+    if (connection->isBlocking())
+      connection->setBlocking(false);
+    int descriptor = connection->getDescriptor();
+    Connection* target = connection.get();
+    uint32_t events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    if (writable) events |= EPOLLOUT;
+    this->watch(descriptor, events,
+        [this, descriptor, target, readable, writable, closed](uint32_t ev) {
+      // Deliver any remaining data before reporting that the peer hung up
+      if ((ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && readable)
+        readable(*target);
+      if ((ev & EPOLLOUT) && writable)
+        writable(*target);
+      // A `Connection` closed by a callback (or by an error) will never report
+      // another event, so treat it as though the peer hung up
+      if ((ev & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) || !target->valid()) {
+        if (closed) closed(*target);
+        this->remove(descriptor);
+      }
+    });
+    // Keep the `Connection` alive for as long as it remains registered, and
+    // have it report being closed outside of its own callbacks
+    this->handlers[descriptor]->connection = connection;
+    connection->loop = this;
+  }
+
+  /**
+   * Arms a one-shot registration that notifies an `Awaiter` once the provided
+   * file descriptor is ready.
+   *
+   * The `Awaiter` is notified at most once per call. The registration is kept
+   * (disarmed) afterwards so that the next call for the same descriptor only
+   * needs to re-arm it, which doesn't allocate memory. At most one `Awaiter`
+   * may wait for a given descriptor at a time.
+   *
+   * @throws `UnexpectedError` if the descriptor couldn't be registered.
+   *
+   * @param  descriptor The file descriptor to wait for
+   * @param  events     The `epoll(7)` event mask to wait for
+   * @param  awaiter    The `Awaiter` to notify
+   */
+  void EventLoop::await(int descriptor, uint32_t events, Awaiter& awaiter) {
+    this->control(descriptor, events | EPOLLONESHOT);
+    std::shared_ptr<Registration>& registration = this->handlers[descriptor];
+    // Replace any callback registration since the two can't be combined
+    if (!registration || registration->handler) {
+      if (registration && registration->timer)
+        this->timers.cancel(registration->timer);
+      if (registration && registration->connection)
+        registration->connection->loop = nullptr;
+      registration = std::make_shared<Registration>();
+    }
+    registration->awaiter = &awaiter;
+  }
+
+  /**
+   * Disarms a timer armed using `schedule()`.
+   *
+   * @param  timer The identifier returned by `schedule()`
+   *
+   * @return `true` if the timer was disarmed, `false` if it had already fired
+   *         (or been cancelled).
+   */
+  bool EventLoop::cancel(uint64_t timer) {
+    return this->timers.cancel(timer);
+  }
+
+  /**
+   * Adds or modifies the kernel's registration of a file descriptor.
+   *
+   * @throws `UnexpectedError` if the descriptor couldn't be registered.
+   *
+   * @param  descriptor The file descriptor to register
+   * @param  events     The `epoll(7)` event mask to watch for
+   */
+  void EventLoop::control(int descriptor, uint32_t events) {
+    struct epoll_event event = {};
+    event.events  = events;
+    event.data.fd = descriptor;
+    // Attempt to modify an existing registration before adding a new one since
+    // the kernel silently drops registrations of closed descriptors
+    int op = this->handlers.count(descriptor) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    int result = epoll_ctl(this->epoll, op, descriptor, &event);
+    if (result < 0 && (errno == ENOENT || errno == EEXIST)) {
+      op = (op == EPOLL_CTL_MOD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+      result = epoll_ctl(this->epoll, op, descriptor, &event);
+    }
+    if (result < 0)
+      throw UnexpectedError{"Couldn't register the file descriptor " +
+        std::to_string(descriptor) + " with the event loop."};
+  }
+
+  /**
+   * Closes a `Connection` whose idle timeout expired.
+   *
+   * The `Connection`'s `closed` callback is invoked (as though the remote peer
+   * hung up) and the `Connection` is removed from the `EventLoop`.
+   *
+   * @param descriptor The file descriptor of the `Connection`
+   */
+  void EventLoop::expire(int descriptor) {
+    auto entry = this->handlers.find(descriptor);
+    if (entry == this->handlers.end()) return;
+    std::shared_ptr<Registration> registration = entry->second;
+    registration->timer = 0;
+    if (registration->connection) registration->connection->close();
+    // An empty event mask only reports that the `Connection` was closed
+    if (registration->handler) registration->handler(0);
+    else this->remove(descriptor);
+  }
+
+  /**
+   * Waits for events and dispatches them to their registered callbacks, then
+   * fires any expired timers.
+   *
+   * The wait is shortened as needed so that no timer fires late. Every event
+   * reported for a `Connection` with an idle timeout postpones the timeout.
+   * `Connection` objects that were closed outside of their own callbacks are
+   * removed (see `sweep()`) both before waiting and after dispatching.
+   *
+   * @throws `UnexpectedError` if `epoll_wait(2)` fails.
+   *
+   * @param  timeout The maximum number of milliseconds to wait for events, or
+   *                 `-1` to wait indefinitely
+   *
+   * @return         The number of events that were dispatched, timers that
+   *                 were fired and closed `Connection` objects that were
+   *                 removed.
+   */
+  size_t EventLoop::poll(int timeout) {
+    size_t swept = this->sweep();
+    int next = this->timers.nextTimeout();
+    if (next >= 0 && (timeout < 0 || next < timeout)) timeout = next;
+    int count = epoll_wait(this->epoll, this->events.data(),
+      static_cast<int>(this->events.size()), timeout);
+    if (count < 0) {
+      if (errno != EINTR) throw UnexpectedError{"Couldn't wait for events."};
+      count = 0;
+    }
+    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+    for (int i = 0; i < count; ++i) {
+      auto entry = this->handlers.find(this->events[i].data.fd);
+      if (entry == this->handlers.end()) continue;
+      // Hold a reference to the registration so that a callback can safely
+      // remove its own descriptor
+      std::shared_ptr<Registration> registration = entry->second;
+      if (registration->timer)
+        this->timers.reschedule(registration->timer, now + registration->idle);
+      if (registration->awaiter)
+        std::exchange(registration->awaiter, nullptr)->notify();
+      else if (registration->handler)
+        registration->handler(this->events[i].events);
+    }
+    size_t fired = this->timers.advance();
+    return swept + static_cast<size_t>(count) + fired + this->sweep();
+  }
+
+  /**
+   * Records that a registered `Connection` was closed.
+   *
+   * This is called by `Connection::terminate()`, which may run while the
+   * loop is dispatching events (or from the `Connection`'s own callbacks), so
+   * the registration is only removed by the next `sweep()`.
+   *
+   * @param descriptor The file descriptor of the `Connection`
+   */
+  void EventLoop::release(int descriptor) noexcept {
+    try {
+      this->released.push_back(descriptor);
+    }
+    catch (const std::bad_alloc&) {
+      // The registration lingers until its descriptor is reused
+    }
+  }
+
+  /**
+   * Removes a file descriptor from the `EventLoop`.
+   *
+   * Any `Connection` retained by the registration is released and its idle
+   * timeout is disarmed. Removing a descriptor that isn't registered has no
+   * effect.
+   *
+   * @param descriptor The file descriptor to remove
+   */
+  void EventLoop::remove(int descriptor) {
+    auto entry = this->handlers.find(descriptor);
+    if (entry == this->handlers.end()) return;
+    if (entry->second->timer) this->timers.cancel(entry->second->timer);
+    if (entry->second->connection) entry->second->connection->loop = nullptr;
+    this->handlers.erase(entry);
+    epoll_ctl(this->epoll, EPOLL_CTL_DEL, descriptor, nullptr);
+  }
+
+  /**
+   * Dispatches events until `stop()` is called.
+   *
+   * Exceptions thrown by callbacks are not caught by this method.
+   */
+  void EventLoop::run() {
+    this->running = true;
+    while (this->running)
+      this->poll();
+  }
+
+  /**
+   * Arms a timer that invokes `handler` from `poll()` once `delay` elapsed.
+   *
+   * Timers are kept in a `TimerWheel`, so arming (or cancelling) a timer takes
+   * constant time and requires no system call. This method isn't thread safe
+   * and should only be called from the thread running the `EventLoop` (e.g.
+   * from a callback).
+   *
+   * @see    `TimerWheel::schedule()` for more information.
+   *
+   * @throws `InvalidArgument` if the handler is empty.
+   *
+   * @param  delay   The amount of time to wait before firing the timer
+   * @param  handler The callback to invoke once the timer expires
+   *
+   * @return A non-zero identifier that can be passed to `cancel()`.
+   */
+  uint64_t EventLoop::schedule(std::chrono::milliseconds delay,
+      TimerWheel::Handler handler) {
+    return this->timers.schedule(delay, std::move(handler));
+  }
+
+  /**
+   * Closes a registered `Connection` once no event was reported for it within
+   * the provided amount of time.
+   *
+   * Every event reported for the `Connection` postpones the timeout, so only
+   * a peer that neither sends data nor accepts written data (while a
+   * `writable` callback is registered) is disconnected. Once the timeout
+   * expires, the `Connection` is closed, its `closed` callback is invoked and
+   * it is removed from the `EventLoop`, which promptly releases its file
+   * descriptor and buffers. A timeout of zero disarms the idle timeout.
+   *
+   * This method isn't thread safe and should only be called from the thread
+   * running the `EventLoop`.
+   *
+   * @throws `InvalidArgument` if the descriptor doesn't belong to a registered
+   *                           `Connection` or the timeout is negative.
+   *
+   * @param  descriptor The file descriptor of the `Connection`
+   * @param  timeout    The maximum amount of time to wait between events
+   */
+  void EventLoop::setIdleTimeout(int descriptor,
+      std::chrono::milliseconds timeout) {
+    auto entry = this->handlers.find(descriptor);
+    if (entry == this->handlers.end() || !entry->second->connection)
+      throw InvalidArgument{"The descriptor isn't a registered connection."};
+    if (timeout.count() < 0)
+      throw InvalidArgument{"The idle timeout is invalid."};
+    Registration& registration = *entry->second;
+    registration.idle = timeout;
+    if (timeout.count() == 0) {
+      if (registration.timer) this->timers.cancel(registration.timer);
+      registration.timer = 0;
+      return;
+    }
+    TimerWheel::Clock::time_point deadline =
+      TimerWheel::Clock::now() + timeout;
+    if (registration.timer &&
+        this->timers.reschedule(registration.timer, deadline))
+      return;
+    registration.timer = this->timers.schedule(deadline,
+      [this, descriptor] { this->expire(descriptor); });
+  }
+
+  /**
+   * Requests that `run()` return after dispatching the current iteration.
+   *
+   * This method is safe to call from any thread (or from within a callback).
+   */
+  void EventLoop::stop() {
+    this->running = false;
+    uint64_t value = 1;
+    if (::write(this->wakeup, &value, sizeof(value)) < 0) {
+      // The counter is already pending, so the loop will wake up regardless
+    }
+  }
+
+  /**
+   * Removes the registrations of `Connection` objects that were closed
+   * outside of their own callbacks.
+   *
+   * The `closed` callback of each such `Connection` is invoked (as though the
+   * remote peer hung up) before its registration is removed, which releases
+   * the loop's reference to it. Descriptors that were already removed (or
+   * reused by another registration) are skipped.
+   *
+   * @return The number of registrations that were removed.
+   */
+  size_t EventLoop::sweep() {
+    size_t swept = 0;
+    while (!this->released.empty()) {
+      for (int descriptor : std::exchange(this->released, {})) {
+        auto entry = this->handlers.find(descriptor);
+        if (entry == this->handlers.end() || !entry->second->connection ||
+            entry->second->connection->valid())
+          continue;
+        // Hold a reference to the registration while its handler runs
+        std::shared_ptr<Registration> registration = entry->second;
+        // An empty event mask only reports that the `Connection` was closed
+        if (registration->handler) registration->handler(0);
+        else this->remove(descriptor);
+        ++swept;
+      }
+    }
+    return swept;
+  }
+
+  /**
+   * Registers (or re-registers) a raw file descriptor with the `EventLoop`.
+   *
+   * This is the low-level primitive behind the `add()` overloads and can be
+   * used to integrate other descriptors (timers, pipes, etc.) with the loop.
+   * The descriptor is not modified and ownership is retained by the caller.
+   *
+   * @throws `UnexpectedError` if the descriptor couldn't be registered.
+   *
+   * @param  descriptor The file descriptor to watch
+   * @param  events     The `epoll(7)` event mask to watch for
+   * @param  handler    The callback to invoke with the reported event mask
+   */
+  void EventLoop::watch(int descriptor, uint32_t events, EventHandler handler) {
+    this->control(descriptor, events);
+    auto registration = std::make_shared<Registration>();
+    registration->handler = std::move(handler);
+    // Disarm the idle timeout of any registration being replaced
+    std::shared_ptr<Registration>& entry = this->handlers[descriptor];
+    if (entry && entry->timer) this->timers.cancel(entry->timer);
+    if (entry && entry->connection) entry->connection->loop = nullptr;
+    entry = registration;
+  }
+}
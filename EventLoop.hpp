@@ -0,0 +1,150 @@
+/**
+ * @file      EventLoop.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `EventLoop` object.
+ */
+
+#ifndef _CFNETWORKEVENTLOOP_H
+#define _CFNETWORKEVENTLOOP_H
+
+#include <atomic>          // for atomic
+#include <chrono>          // for milliseconds
+#include <cstdint>         // for uint32_t, uint64_t
+#include <functional>      // for function
+#include <memory>          // for shared_ptr
+#include <sys/epoll.h>     // for epoll_event
+#include <unordered_map>   // for unordered_map
+#include <vector>          // for vector
+#include "CFNetwork.hpp"   // for Awaiter, Connection, Socket
+#include "TimerWheel.hpp"  // for TimerWheel
+
+namespace CFNetwork {
+  /**
+   * @class EventLoop
+   * An edge-triggered `epoll(7)` reactor for `Socket` and `Connection` objects.
+   *
+   * The `EventLoop` object multiplexes an arbitrary number of file descriptors
+   * on the thread that calls `run()` (or `poll()`). Every `Socket` and
+   * `Connection` registered with the loop is placed in non-blocking mode, and
+   * the appropriate callback is invoked whenever the kernel reports a change
+   * in readiness.
+   *
+   * Since descriptors are registered as edge-triggered, callbacks are only
+   * invoked when new readiness is reported. A readable callback should
+   * therefore consume data until `enqueueData()` returns zero (or `readDelim()`
+   * returns an empty `std::string`), otherwise it won't be invoked again until
+   * more data arrives.
+   *
+   * The loop also drives a `TimerWheel`: `poll()` waits no longer than the
+   * next timer requires, and fires every expired timer after dispatching
+   * events. Timers can be armed using `schedule()`, and a registered
+   * `Connection` can be closed automatically after a period of inactivity
+   * using `setIdleTimeout()`.
+   *
+   * The `EventLoop` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class EventLoop {
+    private:
+      EventLoop(const EventLoop&);
+      EventLoop& operator= (const EventLoop&);
+      friend class Connection;
+
+    public:
+      /**
+       * @typedef AcceptHandler
+       * Callback invoked with each `Connection` accepted by a `Socket`.
+       */
+      typedef std::function<void(std::shared_ptr<Connection>)> AcceptHandler;
+      /**
+       * @typedef ConnectionHandler
+       * Callback invoked when a `Connection` changes readiness.
+       */
+      typedef std::function<void(Connection&)> ConnectionHandler;
+      /**
+       * @typedef EventHandler
+       * Callback invoked with the `epoll(7)` event mask of a raw descriptor.
+       */
+      typedef std::function<void(uint32_t)> EventHandler;
+
+    protected:
+      /**
+       * @struct Registration
+       * Binds a registered file descriptor to its event handler (or to the
+       * `Awaiter` of a suspended coroutine) and, in the case of a
+       * `Connection`, keeps the associated object alive and tracks its idle
+       * timeout.
+       */
+      struct Registration {
+        Awaiter*                    awaiter = nullptr;
+        EventHandler                handler;
+        std::shared_ptr<Connection> connection;
+        std::chrono::milliseconds   idle{0};
+        uint64_t                    timer   = 0;
+      };
+
+      /**
+       * @var epoll
+       * Holds the `epoll(7)` file descriptor associated with an `EventLoop`.
+       */
+      int                       epoll    = -1;
+      /**
+       * @var events
+       * Storage for the events returned by each call to `epoll_wait(2)`.
+       */
+      std::vector<struct epoll_event> events;
+      /**
+       * @var handlers
+       * Maps each registered file descriptor to its `Registration`.
+       */
+      std::unordered_map<int, std::shared_ptr<Registration>> handlers;
+      /**
+       * @var released
+       * The file descriptors of registered `Connection` objects that were
+       * closed since the last `sweep()`.
+       */
+      std::vector<int>          released;
+      /**
+       * @var running
+       * Whether or not `run()` should continue polling for events.
+       */
+      std::atomic<bool>         running{false};
+      /**
+       * @var timers
+       * Holds the timers armed using `schedule()` and `setIdleTimeout()`.
+       */
+      TimerWheel                timers;
+      /**
+       * @var wakeup
+       * Holds an `eventfd(2)` used to interrupt a blocked `poll()`.
+       */
+      int                       wakeup   = -1;
+
+      void   control(int descriptor, uint32_t events);
+      void   expire(int descriptor);
+      void   release(int descriptor) noexcept;
+      size_t sweep();
+
+    public:
+      EventLoop(size_t max_events = 256);
+     ~EventLoop();
+      void   add(Socket& socket, AcceptHandler accepted);
+      void   add(const std::shared_ptr<Connection>& connection,
+               ConnectionHandler readable, ConnectionHandler writable = nullptr,
+               ConnectionHandler closed = nullptr);
+      void   await(int descriptor, uint32_t events, Awaiter& awaiter);
+      bool   cancel(uint64_t timer);
+      size_t poll(int timeout = -1);
+      void   remove(int descriptor);
+      void   run();
+      uint64_t schedule(std::chrono::milliseconds delay,
+               TimerWheel::Handler handler);
+      void   setIdleTimeout(int descriptor, std::chrono::milliseconds timeout);
+      void   stop();
+      void   watch(int descriptor, uint32_t events, EventHandler handler);
+  };
+}
+
+#endif
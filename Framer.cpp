@@ -0,0 +1,269 @@
+/**
+ * @file      Framer.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `Framer` object.
+ */
+
+#include <cstdint>         // for uint64_t
+#include <functional>      // for function
+#include <string>          // for string, to_string
+#include <string_view>     // for string_view
+#include <utility>         // for move
+#include "CFNetwork.hpp"   // for BufferLimitExceeded, ConnectionClosed, ...
+#include "Connection.hpp"  // for Connection
+#include "Framer.hpp"      // for Framer, ByteOrder
+
+namespace CFNetwork {
+  /**
+   * `Framer` Constructor.
+   *
+   * Constructs a `Framer` object for the provided `Connection`. The
+   * `Connection` must outlive the `Framer`.
+   *
+   * @throws `InvalidArgument` if the header width isn't 1, 2, 4 or 8 bytes, or
+   *         if the maximum frame size can't be described by the header.
+   *
+   * @param  connection The `Connection` to read and write frames on
+   * @param  width      The size (in bytes) of each length header
+   * @param  order      The byte order of each length header
+   * @param  max_frame  The largest payload (in bytes) that will be accepted
+   */
+  Framer::Framer(Connection& connection, size_t width, ByteOrder order,
+      size_t max_frame) : connection(connection) {
+    if (width != 1 && width != 2 && width != 4 && width != 8)
+      throw InvalidArgument{"The header width must be 1, 2, 4 or 8 bytes."};
+    if (width < sizeof(uint64_t) && max_frame >> (width * 8) != 0)
+      throw InvalidArgument{"The maximum frame size exceeds the header width."};
+    this->max_frame = max_frame;
+    this->order     = order;
+    this->width     = width;
+  }
+
+  /**
+   * Decodes the length described by a frame header.
+   *
+   * @param  header The first byte of a header of `width` bytes
+   *
+   * @return The length of the frame's payload.
+   */
+  size_t Framer::decode(const char* header) const {
+    uint64_t length = 0;
+    for (size_t i = 0; i < this->width; ++i) {
+      size_t index = this->order == ByteOrder::BigEndian ?
+        i : this->width - i - 1;
+      length = (length << 8) | static_cast<unsigned char>(header[index]);
+    }
+    return static_cast<size_t>(length);
+  }
+
+  /**
+   * Encodes a frame header describing the provided length.
+   *
+   * @param  length The length of the frame's payload
+   *
+   * @return `std::string` of `width` bytes (short enough to avoid allocation).
+   */
+  std::string Framer::encode(size_t length) const {
+    std::string header(this->width, '\0');
+    uint64_t value = length;
+    for (size_t i = 0; i < this->width; ++i, value >>= 8) {
+      size_t index = this->order == ByteOrder::BigEndian ?
+        this->width - i - 1 : i;
+      header[index] = static_cast<char>(value & 0xFF);
+    }
+    return header;
+  }
+
+  /**
+   * Fetches the byte order of each length header.
+   *
+   * @return `ByteOrder` value describing the header encoding.
+   */
+  ByteOrder Framer::getByteOrder() const {
+    return this->order;
+  }
+
+  /**
+   * Fetches the largest payload that will be read or written.
+   *
+   * @return The maximum frame size in bytes.
+   */
+  size_t Framer::getMaxFrame() const {
+    return this->max_frame;
+  }
+
+  /**
+   * Fetches the size of each length header.
+   *
+   * @return The header width in bytes.
+   */
+  size_t Framer::getWidth() const {
+    return this->width;
+  }
+
+  /**
+   * Hands every complete frame held in the `Connection`'s internal buffer to
+   * the provided handler in a single pass, then consumes them all at once.
+   *
+   * @throws `UnexpectedError` if a header describes a frame larger than the
+   *         maximum frame size (the `Connection` is closed since the stream
+   *         can't be resynchronized).
+   *
+   * @param  handler The function to call with the payload of each frame
+   *
+   * @return The number of frames that were handled.
+   */
+  size_t Framer::parse(const std::function<void(std::string_view)>& handler) {
+    std::string_view data = this->connection.peek();
+    size_t frames = 0, offset = 0;
+    try {
+      while (data.length() - offset >= this->width) {
+        size_t length = this->decode(data.data() + offset);
+        if (length > this->max_frame) {
+          this->connection.close();
+          throw UnexpectedError{"Frame of " + std::to_string(length) +
+            " bytes from " + this->connection.getRemote() + ":" +
+            std::to_string(this->connection.getPort()) +
+            " exceeds the maximum frame size"};
+        }
+        // Stop at the first frame that hasn't been completely received
+        if (data.length() - offset - this->width < length) break;
+        handler(data.substr(offset + this->width, length));
+        offset += this->width + length;
+        ++frames;
+      }
+    }
+    catch (...) {
+      // Keep the frames that were already handled from being handled again
+      if (this->connection.valid()) this->connection.consume(offset);
+      throw;
+    }
+    this->connection.consume(offset);
+    return frames;
+  }
+
+  /**
+   * Queues a frame for writing, taking ownership of its payload.
+   *
+   * The frame is written by the next call to `Connection::flush()` (or
+   * `writeFrame()`), which allows many frames to be written together.
+   *
+   * @throws `InvalidArgument` if the payload exceeds the maximum frame size.
+   *
+   * @param  payload The payload of the frame
+   */
+  void Framer::queueFrame(std::string payload) {
+    if (payload.length() > this->max_frame)
+      throw InvalidArgument{"The payload exceeds the maximum frame size."};
+    this->connection.queue(this->encode(payload.length()));
+    this->connection.queue(std::move(payload));
+  }
+
+  /**
+   * Queues a frame for writing without copying or owning its payload.
+   *
+   * The viewed payload must remain valid until `Connection::pending()` reports
+   * that it has been written.
+   *
+   * @see    `queueFrame()` for more information.
+   *
+   * @throws `InvalidArgument` if the payload exceeds the maximum frame size.
+   *
+   * @param  payload The payload of the frame
+   */
+  void Framer::queueFrameView(std::string_view payload) {
+    if (payload.length() > this->max_frame)
+      throw InvalidArgument{"The payload exceeds the maximum frame size."};
+    this->connection.queue(this->encode(payload.length()));
+    this->connection.queueView(payload);
+  }
+
+  /**
+   * Reads every complete frame that is available and hands each one to the
+   * provided handler.
+   *
+   * Each payload is passed as a view of the `Connection`'s internal buffer
+   * and is only valid for the duration of the handler call; the handler must
+   * not read from the `Connection` itself. Every complete frame is parsed in a
+   * single pass and consumed at once, so frames that arrive together cost a
+   * single read.
+   *
+   * If no complete frame is buffered, more data is enqueued until at least one
+   * frame is complete. A non-blocking `Connection` instead returns zero once
+   * no more data is available, so an edge-triggered caller should call this
+   * method until it returns zero.
+   *
+   * @throws `BufferLimitExceeded` if reads are paused by the buffer limit (or
+   *         the `MemoryBudget`) before a complete frame is received, and the
+   *         `Connection` is blocking or the frame can never fit below the
+   *         buffer limit.
+   * @throws `ConnectionClosed`    if a blocking `Connection` is closed by the
+   *         remote peer before a complete frame is received.
+   * @throws `UnexpectedError`     if a frame exceeds the maximum frame size.
+   *
+   * @see    `Connection::enqueueData()` for more information regarding
+   *                                     potential exceptions.
+   *
+   * @param  handler The function to call with the payload of each frame
+   *
+   * @return The number of frames that were handled.
+   */
+  size_t Framer::readFrames(const std::function<void(std::string_view)>&
+      handler) {
+    size_t frames;
+    while ((frames = this->parse(handler)) == 0) {
+      // Attempt to enqueue more data (giving up for now if a non-blocking
+      // `Connection` has no more data available)
+      if (this->connection.enqueueData() == 0) {
+        // The frame can't grow while reads are paused, so give up unless a
+        // non-blocking `Connection` is only waiting for the `MemoryBudget`
+        if (this->connection.isPaused()) {
+          std::string_view data = this->connection.peek();
+          size_t required = this->width + (data.length() >= this->width ?
+            this->decode(data.data()) : 0);
+          if (this->connection.isBlocking() ||
+              required > this->connection.getBufferLimit())
+            throw BufferLimitExceeded{"The buffer limit was reached by peer " +
+              this->connection.getRemote() + ":" +
+              std::to_string(this->connection.getPort()) +
+              " before a complete frame was received"};
+        }
+        bool closed = this->connection.getState() ==
+          ConnectionState::HalfClosed;
+        // The frame can never arrive once the remote peer finished sending
+        if (closed && this->connection.isBlocking())
+          throw ConnectionClosed{"Connection closed by peer " +
+            this->connection.getRemote() + ":" +
+            std::to_string(this->connection.getPort()) +
+            " before a complete frame was received"};
+        if (!this->connection.isBlocking() || closed)
+          return 0;
+      }
+    }
+    return frames;
+  }
+
+  /**
+   * Writes a frame, along with any data that was previously queued.
+   *
+   * The header and payload are written using gather I/O without copying the
+   * payload.
+   *
+   * @see    `Connection::flush()` for more information regarding potential
+   *                               exceptions.
+   *
+   * @throws `InvalidArgument` if the payload exceeds the maximum frame size.
+   *
+   * @param  payload The payload of the frame
+   *
+   * @return `true` if the frame was completely written, `false` if a
+   *         non-blocking `Connection` would block (in which case the viewed
+   *         payload must remain valid until it has been written).
+   */
+  bool Framer::writeFrame(std::string_view payload) {
+    this->queueFrameView(payload);
+    return this->connection.flush();
+  }
+}
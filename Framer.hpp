@@ -0,0 +1,104 @@
+/**
+ * @file      Framer.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Framer` object.
+ */
+
+#ifndef _CFNETWORKFRAMER_H
+#define _CFNETWORKFRAMER_H
+
+#include <cstddef>        // for size_t
+#include <functional>     // for function
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include "CFNetwork.hpp"  // for Connection, Framer
+
+namespace CFNetwork {
+  /**
+   * @var MAX_FRAME_BYTES
+   * The default maximum payload size of a frame accepted by a `Framer`.
+   */
+  const size_t MAX_FRAME_BYTES = 16 * 1024 * 1024;
+
+  /**
+   * @enum ByteOrder
+   * The `ByteOrder` enum describes how the length header of a frame is encoded.
+   */
+  enum class ByteOrder {
+    /**
+     * @var BigEndian
+     * The most significant byte is sent first (network byte order).
+     */
+    BigEndian,
+    /**
+     * @var LittleEndian
+     * The least significant byte is sent first.
+     */
+    LittleEndian
+  };
+
+  /**
+   * @class Framer
+   * A length-prefixed framing codec for a `Connection`.
+   *
+   * The `Framer` object splits the byte stream of a `Connection` into frames,
+   * each of which consists of a fixed-width unsigned length header followed by
+   * that many bytes of payload. Received frames are parsed directly from the
+   * `Connection`'s internal buffer and handed out as views, so no frame is
+   * copied or allocated. Outbound frames are queued as a small header followed
+   * by the payload itself, so that they are written together using gather
+   * I/O without copying the payload.
+   *
+   * The `Framer` object is not copyable or assignable since it refers to a
+   * `Connection` that does not lend itself well to duplication.
+   */
+  class Framer {
+    private:
+      Framer(const Framer&);
+      Framer& operator= (const Framer&);
+
+    protected:
+      /**
+       * @var connection
+       * The `Connection` that frames are read from and written to.
+       */
+      Connection& connection;
+      /**
+       * @var max_frame
+       * The largest payload (in bytes) that will be read or written.
+       */
+      size_t      max_frame = MAX_FRAME_BYTES;
+      /**
+       * @var order
+       * The byte order of each length header.
+       */
+      ByteOrder   order     = ByteOrder::BigEndian;
+      /**
+       * @var width
+       * The size (in bytes) of each length header.
+       */
+      size_t      width     = 4;
+
+      size_t      decode(const char* header)                  const;
+      std::string encode(size_t length)                       const;
+      size_t      parse(const std::function<void(std::string_view)>&
+                    handler);
+
+    public:
+      Framer(Connection& connection, size_t width = 4,
+        ByteOrder order = ByteOrder::BigEndian,
+        size_t max_frame = MAX_FRAME_BYTES);
+      ByteOrder   getByteOrder()                              const;
+      size_t      getMaxFrame()                               const;
+      size_t      getWidth()                                  const;
+      void        queueFrame(std::string payload);
+      void        queueFrameView(std::string_view payload);
+      size_t      readFrames(const std::function<void(std::string_view)>&
+                    handler);
+      bool        writeFrame(std::string_view payload);
+  };
+}
+
+#endif
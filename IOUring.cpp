@@ -0,0 +1,420 @@
+/**
+ * @file      IOUring.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `IOUring` object.
+ */
+
+#include <cstring>           // for memset
+#include <linux/io_uring.h>  // for io_uring_params, io_uring_sqe, ...
+#include <sys/errno.h>       // for EAGAIN, EBUSY, EINTR, errno
+#include <sys/mman.h>        // for mmap, munmap, MAP_FAILED, ...
+#include <sys/socket.h>      // for msghdr, MSG_NOSIGNAL
+#include <sys/syscall.h>     // for __NR_io_uring_setup, __NR_io_uring_enter
+#include <unistd.h>          // for close, syscall
+#include "CFNetwork.hpp"     // for InvalidArgument, UnexpectedError
+#include "IOUring.hpp"       // for IOUring
+
+namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  // The buffer group used for all provided buffers of an `IOUring`
+  const uint16_t buffer_group = 0;
+  // The `user_data` value of internal requests whose completions are ignored
+  const uint64_t internal_token = 0;
+  #endif
+
+  /**
+   * `IOUring` Constructor.
+   *
+   * Creates an `io_uring(7)` instance and registers a ring of provided buffers
+   * that multishot receive requests will fill.
+   *
+   * @throws `InvalidArgument` if any of the provided sizes are invalid.
+   * @throws `UnexpectedError` if the kernel doesn't support the required
+   *                           `io_uring(7)` features.
+   *
+   * @param entries      The number of submission queue entries
+   * @param buffer_count The number of provided receive buffers (a power of two)
+   * @param buffer_size  The size of each provided receive buffer
+   */
+  IOUring::IOUring(unsigned entries, unsigned buffer_count,
+      unsigned buffer_size) {
+    if (entries == 0 || buffer_size == 0 || buffer_count == 0 ||
+        buffer_count > 32768 || (buffer_count & (buffer_count - 1)) != 0)
+      throw InvalidArgument{"The provided ring dimensions are invalid."};
+    struct io_uring_params params = {};
+    this->ring = static_cast<int>(syscall(__NR_io_uring_setup, entries,
+      &params));
+    if (this->ring < 0)
+      throw UnexpectedError{"Couldn't create an io_uring instance."};
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+      close(this->ring);
+      throw UnexpectedError{"The kernel's io_uring implementation is too old."};
+    }
+    // Map the submission and completion queues (which share a mapping)
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes +
+      params.cq_entries * sizeof(struct io_uring_cqe);
+    this->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    this->ring_ptr  = mmap(nullptr, this->ring_size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, this->ring, IORING_OFF_SQ_RING);
+    this->sqe_size  = params.sq_entries * sizeof(struct io_uring_sqe);
+    this->sqe_ptr   = mmap(nullptr, this->sqe_size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, this->ring, IORING_OFF_SQES);
+    if (this->ring_ptr == MAP_FAILED || this->sqe_ptr == MAP_FAILED) {
+      if (this->ring_ptr != MAP_FAILED) munmap(this->ring_ptr, this->ring_size);
+      if (this->sqe_ptr  != MAP_FAILED) munmap(this->sqe_ptr,  this->sqe_size);
+      close(this->ring);
+      throw UnexpectedError{"Couldn't map the io_uring queues."};
+    }
+    char* base       = static_cast<char*>(this->ring_ptr);
+    this->sq_head    = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    this->sq_tail    = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    this->sq_mask    = reinterpret_cast<unsigned*>(base +
+      params.sq_off.ring_mask);
+    this->sq_array   = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    this->sq_entries = params.sq_entries;
+    this->sqes       = static_cast<struct io_uring_sqe*>(this->sqe_ptr);
+    this->cq_head    = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    this->cq_tail    = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    this->cq_mask    = reinterpret_cast<unsigned*>(base +
+      params.cq_off.ring_mask);
+    this->cqes       = reinterpret_cast<struct io_uring_cqe*>(base +
+      params.cq_off.cqes);
+    // Allocate the provided buffer ring and its backing storage
+    this->buffer_count     = buffer_count;
+    this->buffer_size      = buffer_size;
+    this->buffer_ring_size = buffer_count * sizeof(struct io_uring_buf);
+    void* ring_memory = mmap(nullptr, this->buffer_ring_size,
+      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    this->buffers = new char[static_cast<size_t>(buffer_count) * buffer_size];
+    struct io_uring_buf_reg reg = {};
+    if (ring_memory != MAP_FAILED) {
+      this->buffer_ring  = static_cast<struct io_uring_buf*>(ring_memory);
+      reg.ring_addr      = reinterpret_cast<uint64_t>(ring_memory);
+      reg.ring_entries   = buffer_count;
+      reg.bgid           = buffer_group;
+    }
+    if (ring_memory == MAP_FAILED || syscall(__NR_io_uring_register,
+        this->ring, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+      if (ring_memory != MAP_FAILED)
+        munmap(ring_memory, this->buffer_ring_size);
+      delete[] this->buffers;
+      munmap(this->ring_ptr, this->ring_size);
+      munmap(this->sqe_ptr,  this->sqe_size);
+      close(this->ring);
+      throw UnexpectedError{"Couldn't register the io_uring buffer ring."};
+    }
+    // Hand every buffer to the kernel (`struct io_uring_buf_ring` isn't used
+    // directly since its flexible array member is misplaced when compiled as
+    // C++)
+    for (unsigned i = 0; i < buffer_count; ++i) {
+      struct io_uring_buf* buf = &this->buffer_ring[i];
+      buf->addr = reinterpret_cast<uint64_t>(this->buffers +
+        static_cast<size_t>(i) * buffer_size);
+      buf->len  = buffer_size;
+      buf->bid  = static_cast<uint16_t>(i);
+    }
+    __atomic_store_n(&this->buffer_ring[0].resv,
+      static_cast<uint16_t>(buffer_count), __ATOMIC_RELEASE);
+  }
+
+  /**
+   * `IOUring` Destructor.
+   *
+   * Upon destruction of an `IOUring` object, release its memory mappings and
+   * close its associated file descriptor (which cancels outstanding requests).
+   */
+  IOUring::~IOUring() {
+    close(this->ring);
+    munmap(this->buffer_ring, this->buffer_ring_size);
+    munmap(this->ring_ptr,    this->ring_size);
+    munmap(this->sqe_ptr,     this->sqe_size);
+    delete[] this->buffers;
+  }
+
+  /**
+   * Acquires a zeroed submission queue entry, submitting queued entries first
+   * if the submission queue is full.
+   *
+   * @param  user_data The value used to identify the request's completions
+   *
+   * @return           A pointer to the submission queue entry.
+   */
+  struct io_uring_sqe* IOUring::acquire(uint64_t user_data) {
+    unsigned tail = *this->sq_tail;
+    if (tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE) >=
+        this->sq_entries) {
+      this->enter(0);
+      tail = *this->sq_tail;
+    }
+    unsigned index = tail & *this->sq_mask;
+    struct io_uring_sqe* sqe = &this->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = user_data;
+    if (user_data != internal_token) ++this->outstanding[user_data];
+    this->sq_array[index] = index;
+    __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++this->pending;
+    return sqe;
+  }
+
+  /**
+   * Allocates a token used to identify the requests of an attached object.
+   *
+   * Tokens are allocated in pairs: the returned value identifies multishot
+   * accept/receive requests and the following value identifies sends.
+   *
+   * @return A unique, non-zero token.
+   */
+  uint64_t IOUring::allocateToken() {
+    return this->tokens += 2;
+  }
+
+  /**
+   * Cancels every request associated with the provided token.
+   *
+   * Completions that are already queued (or arrive later) for the token are
+   * discarded and their provided buffers are returned to the kernel. Only
+   * requests that are still outstanding are cancelled, so the token is
+   * forgotten entirely once their final completions arrive.
+   *
+   * @param token The token whose requests should be cancelled
+   */
+  void IOUring::cancel(uint64_t token) {
+    for (uint64_t id : {token, token + 1}) {
+      auto queued = this->completions.find(id);
+      if (queued != this->completions.end()) {
+        for (const Completion& completion : queued->second)
+          this->recycle(completion);
+        this->completions.erase(queued);
+      }
+      if (this->outstanding.count(id) == 0) continue;
+      struct io_uring_sqe* sqe = this->acquire(internal_token);
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd     = -1;
+      sqe->addr   = id;
+      sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+      this->cancelled.insert(id);
+    }
+    this->enter(0);
+  }
+
+  /**
+   * Submits all queued submission queue entries to the kernel, optionally
+   * waiting for completions.
+   *
+   * @throws `UnexpectedError` if `io_uring_enter(2)` fails.
+   *
+   * @param  wait The minimum number of completions to wait for
+   */
+  void IOUring::enter(unsigned wait) {
+    if (this->pending == 0 && wait == 0) return;
+    long result;
+    do result = syscall(__NR_io_uring_enter, this->ring, this->pending, wait,
+      wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    while (result < 0 && errno == EINTR);
+    if (result < 0 && errno != EAGAIN && errno != EBUSY)
+      throw UnexpectedError{"Couldn't submit io_uring requests."};
+    if (result > 0)
+      this->pending -= static_cast<unsigned>(result) < this->pending ?
+        static_cast<unsigned>(result) : this->pending;
+  }
+
+  /**
+   * Fetches a pointer to the data of a completed receive request.
+   *
+   * The data remains valid until the completion is passed to `recycle()`.
+   *
+   * @param  completion A receive completion with `IORING_CQE_F_BUFFER` set
+   *
+   * @return            A pointer to the received data, or `nullptr` if the
+   *                    completion doesn't own a buffer.
+   */
+  const char* IOUring::getBuffer(const Completion& completion) const {
+    if (!(completion.flags & IORING_CQE_F_BUFFER)) return nullptr;
+    size_t id = completion.flags >> IORING_CQE_BUFFER_SHIFT;
+    return this->buffers + id * this->buffer_size;
+  }
+
+  /**
+   * Fetches the size of each provided receive buffer.
+   *
+   * A single receive completion never carries more data than this.
+   *
+   * @return The size of each receive buffer in bytes.
+   */
+  unsigned IOUring::getBufferSize() const {
+    return this->buffer_size;
+  }
+
+  /**
+   * Attempts to claim a completion for the provided token without waiting.
+   *
+   * Queued requests are submitted before checking for completions.
+   *
+   * @param  token      The token whose completion should be claimed
+   * @param  completion Storage for the claimed completion
+   *
+   * @return            `true` if a completion was claimed, `false` otherwise.
+   */
+  bool IOUring::poll(uint64_t token, Completion& completion) {
+    this->enter(0);
+    this->reap();
+    auto queued = this->completions.find(token);
+    if (queued == this->completions.end() || queued->second.empty())
+      return false;
+    completion = queued->second.front();
+    queued->second.pop_front();
+    return true;
+  }
+
+  /**
+   * Queues a multishot accept request on a listening file descriptor.
+   *
+   * Each accepted client produces a completion whose result is the client's
+   * file descriptor. The request remains armed while `IORING_CQE_F_MORE` is
+   * set on its completions.
+   *
+   * @param descriptor The listening file descriptor
+   * @param token      The token used to identify the completions
+   */
+  void IOUring::prepareAccept(int descriptor, uint64_t token) {
+    struct io_uring_sqe* sqe = this->acquire(token);
+    sqe->opcode       = IORING_OP_ACCEPT;
+    sqe->fd           = descriptor;
+    sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+  }
+
+  /**
+   * Queues a multishot receive request on a connected file descriptor.
+   *
+   * Each chunk of received data produces a completion that owns one of the
+   * provided buffers, which must be returned using `recycle()`. The request
+   * remains armed while `IORING_CQE_F_MORE` is set on its completions.
+   *
+   * @param descriptor The connected file descriptor
+   * @param token      The token used to identify the completions
+   */
+  void IOUring::prepareReceive(int descriptor, uint64_t token) {
+    struct io_uring_sqe* sqe = this->acquire(token);
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = descriptor;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+  }
+
+  /**
+   * Queues a send request on a connected file descriptor.
+   *
+   * The provided data must remain valid until the request completes.
+   *
+   * @param descriptor The connected file descriptor
+   * @param data       A pointer to the data to send
+   * @param length     The number of bytes to send
+   * @param token      The token used to identify the completion
+   */
+  void IOUring::prepareSend(int descriptor, const void* data, size_t length,
+      uint64_t token) {
+    struct io_uring_sqe* sqe = this->acquire(token);
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = descriptor;
+    sqe->addr      = reinterpret_cast<uint64_t>(data);
+    sqe->len       = static_cast<uint32_t>(length);
+    sqe->msg_flags = MSG_NOSIGNAL;
+  }
+
+  /**
+   * Queues a gathering send request on a connected file descriptor.
+   *
+   * The provided message (and the data that it references) must remain valid
+   * until the request completes.
+   *
+   * @param descriptor The connected file descriptor
+   * @param message    The message describing the data to send
+   * @param token      The token used to identify the completion
+   */
+  void IOUring::prepareSendMessage(int descriptor,
+      const struct msghdr* message, uint64_t token) {
+    struct io_uring_sqe* sqe = this->acquire(token);
+    sqe->opcode    = IORING_OP_SENDMSG;
+    sqe->fd        = descriptor;
+    sqe->addr      = reinterpret_cast<uint64_t>(message);
+    sqe->len       = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+  }
+
+  /**
+   * Moves all available completions from the completion queue into the
+   * per-token queues (discarding completions for cancelled tokens).
+   */
+  void IOUring::reap() {
+    unsigned head = *this->cq_head;
+    unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe& cqe = this->cqes[head & *this->cq_mask];
+      Completion completion{cqe.res, cqe.flags};
+      if (cqe.user_data == internal_token) continue;
+      // Retire the request once the kernel reports that no more completions
+      // will follow it
+      bool retired = false;
+      if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        auto entry = this->outstanding.find(cqe.user_data);
+        retired = (entry == this->outstanding.end() || --entry->second == 0);
+        if (retired && entry != this->outstanding.end())
+          this->outstanding.erase(entry);
+      }
+      if (this->cancelled.count(cqe.user_data)) {
+        // Return any buffer immediately and forget the identifier once its
+        // last outstanding request has finished
+        this->recycle(completion);
+        if (retired) this->cancelled.erase(cqe.user_data);
+        continue;
+      }
+      this->completions[cqe.user_data].push_back(completion);
+    }
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  /**
+   * Returns the provided buffer owned by a completion to the kernel.
+   *
+   * Completions that don't own a buffer are ignored.
+   *
+   * @param completion The completion whose buffer should be recycled
+   */
+  void IOUring::recycle(const Completion& completion) {
+    if (!(completion.flags & IORING_CQE_F_BUFFER)) return;
+    uint16_t id   = static_cast<uint16_t>(completion.flags >>
+      IORING_CQE_BUFFER_SHIFT);
+    uint16_t tail = this->buffer_ring[0].resv;
+    struct io_uring_buf* buf =
+      &this->buffer_ring[tail & (this->buffer_count - 1)];
+    buf->addr = reinterpret_cast<uint64_t>(this->buffers +
+      static_cast<size_t>(id) * this->buffer_size);
+    buf->len  = this->buffer_size;
+    buf->bid  = id;
+    __atomic_store_n(&this->buffer_ring[0].resv,
+      static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+  }
+
+  /**
+   * Waits for a completion for the provided token.
+   *
+   * Completions for other tokens that arrive in the meantime are queued for
+   * their respective owners.
+   *
+   * @param  token The token whose completion should be claimed
+   *
+   * @return       The claimed completion.
+   */
+  IOUring::Completion IOUring::wait(uint64_t token) {
+    Completion completion = {};
+    while (!this->poll(token, completion))
+      this->enter(1);
+    return completion;
+  }
+}
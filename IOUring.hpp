@@ -0,0 +1,172 @@
+/**
+ * @file      IOUring.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `IOUring` object.
+ */
+
+#ifndef _CFNETWORKIOURING_H
+#define _CFNETWORKIOURING_H
+
+#include <cstddef>           // for size_t
+#include <cstdint>           // for int32_t, uint16_t, uint32_t, uint64_t
+#include <deque>             // for deque
+#include <linux/io_uring.h>  // for io_uring_sqe, io_uring_cqe, ...
+#include <sys/socket.h>      // for msghdr
+#include <unordered_map>     // for unordered_map
+#include <unordered_set>     // for unordered_set
+#include "CFNetwork.hpp"     // for MAX_BYTES
+
+namespace CFNetwork {
+  /**
+   * @class IOUring
+   * An optional `io_uring(7)` execution backend for `Socket` and `Connection`.
+   *
+   * The `IOUring` object owns a submission/completion queue pair and a ring of
+   * kernel-provided receive buffers. A `Socket` or `Connection` attached to an
+   * `IOUring` (see their respective `setRing()` methods) keeps a multishot
+   * accept or receive request armed in the kernel so that new clients and new
+   * data are delivered as completions without issuing a system call per
+   * operation. The public API of both classes is unchanged, which allows the
+   * backend to be compared directly against the plain system call path.
+   *
+   * Every attached object is identified by a token which is encoded into the
+   * `user_data` of its requests. Completions that arrive for another token
+   * while waiting are queued until their owner asks for them.
+   *
+   * An `IOUring` is not thread-safe and should be used from a single thread.
+   *
+   * The `IOUring` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class IOUring {
+    private:
+      IOUring(const IOUring&);
+      IOUring& operator= (const IOUring&);
+
+    public:
+      /**
+       * @struct Completion
+       * The result of a single completed request.
+       */
+      struct Completion {
+        /**
+         * @var result
+         * The result of the request (a negated `errno` value on failure).
+         */
+        int32_t  result;
+        /**
+         * @var flags
+         * The `IORING_CQE_F_*` flags associated with the completion.
+         */
+        uint32_t flags;
+      };
+
+    protected:
+      /**
+       * @var buffer_count
+       * The number of buffers in the provided buffer ring.
+       */
+      unsigned                 buffer_count = 0;
+      /**
+       * @var buffer_ring
+       * The provided buffer ring shared with the kernel (the ring's tail
+       * overlays the `resv` field of the first entry).
+       */
+      struct io_uring_buf*     buffer_ring  = nullptr;
+      /**
+       * @var buffer_size
+       * The size of each buffer in the provided buffer ring.
+       */
+      unsigned                 buffer_size  = 0;
+      /**
+       * @var buffers
+       * Backing storage for the provided buffer ring.
+       */
+      char*                    buffers      = nullptr;
+      /**
+       * @var cancelled
+       * Request identifiers whose outstanding requests were cancelled and
+       * whose remaining completions should be discarded.
+       */
+      std::unordered_set<uint64_t> cancelled;
+      /**
+       * @var completions
+       * Completions that have been reaped but not yet claimed by their owner.
+       */
+      std::unordered_map<uint64_t, std::deque<Completion>> completions;
+      /**
+       * @var cq_head, cq_tail, cq_mask, cqes
+       * Pointers into the completion queue shared with the kernel.
+       */
+      unsigned*                cq_head      = nullptr;
+      unsigned*                cq_tail      = nullptr;
+      unsigned*                cq_mask      = nullptr;
+      struct io_uring_cqe*     cqes         = nullptr;
+      /**
+       * @var outstanding
+       * The number of requests per identifier for which the kernel has yet to
+       * post a final completion (one without `IORING_CQE_F_MORE`).
+       */
+      std::unordered_map<uint64_t, unsigned> outstanding;
+      /**
+       * @var pending
+       * The number of submission queue entries that have yet to be submitted.
+       */
+      unsigned                 pending      = 0;
+      /**
+       * @var ring
+       * Holds the `io_uring(7)` file descriptor associated with an `IOUring`.
+       */
+      int                      ring         = -1;
+      /**
+       * @var ring_ptr, ring_size, sqe_ptr, sqe_size, buffer_ring_size
+       * Memory mappings (and their lengths) owned by an `IOUring`.
+       */
+      void*                    ring_ptr     = nullptr;
+      size_t                   ring_size    = 0;
+      void*                    sqe_ptr      = nullptr;
+      size_t                   sqe_size     = 0;
+      size_t                   buffer_ring_size = 0;
+      /**
+       * @var sq_array, sq_head, sq_mask, sq_tail, sq_entries, sqes
+       * Pointers into the submission queue shared with the kernel.
+       */
+      unsigned*                sq_array     = nullptr;
+      unsigned*                sq_head      = nullptr;
+      unsigned*                sq_mask      = nullptr;
+      unsigned*                sq_tail      = nullptr;
+      unsigned                 sq_entries   = 0;
+      struct io_uring_sqe*     sqes         = nullptr;
+      /**
+       * @var tokens
+       * The most recently allocated token.
+       */
+      uint64_t                 tokens       = 0;
+
+      struct io_uring_sqe* acquire(uint64_t user_data);
+      void                 enter(unsigned wait);
+      void                 reap();
+
+    public:
+      IOUring(unsigned entries = 256, unsigned buffer_count = 256,
+        unsigned buffer_size = MAX_BYTES);
+     ~IOUring();
+      uint64_t     allocateToken();
+      void         cancel(uint64_t token);
+      const char*  getBuffer(const Completion& completion) const;
+      unsigned     getBufferSize()                         const;
+      bool         poll(uint64_t token, Completion& completion);
+      void         prepareAccept(int descriptor, uint64_t token);
+      void         prepareReceive(int descriptor, uint64_t token);
+      void         prepareSend(int descriptor, const void* data, size_t length,
+                     uint64_t token);
+      void         prepareSendMessage(int descriptor,
+                     const struct msghdr* message, uint64_t token);
+      void         recycle(const Completion& completion);
+      Completion   wait(uint64_t token);
+  };
+}
+
+#endif
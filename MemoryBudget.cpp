@@ -0,0 +1,73 @@
+/**
+ * @file      MemoryBudget.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `MemoryBudget` object.
+ */
+
+#include <atomic>            // for memory_order_relaxed
+#include <cstddef>           // for size_t
+#include "MemoryBudget.hpp"  // for MemoryBudget
+
+namespace CFNetwork {
+  /**
+   * Fetches the maximum number of bytes that may be reserved at once.
+   *
+   * @return The limit of the budget in bytes.
+   */
+  size_t MemoryBudget::getLimit() {
+    return MemoryBudget::limit.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Fetches the number of bytes currently reserved by every `Buffer`.
+   *
+   * @return The usage of the budget in bytes.
+   */
+  size_t MemoryBudget::getUsage() {
+    return MemoryBudget::usage.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns bytes previously reserved using `reserve()` to the budget.
+   *
+   * @param length The number of bytes to return
+   */
+  void MemoryBudget::release(size_t length) {
+    MemoryBudget::usage.fetch_sub(length, std::memory_order_relaxed);
+  }
+
+  /**
+   * Attempts to reserve bytes from the budget.
+   *
+   * The reservation either succeeds entirely or leaves the budget unchanged,
+   * so concurrent reservations can never exceed the limit.
+   *
+   * @param  length The number of bytes to reserve
+   *
+   * @return `true` if the bytes were reserved, `false` if the reservation
+   *         would exceed the limit.
+   */
+  bool MemoryBudget::reserve(size_t length) {
+    size_t limit = MemoryBudget::limit.load(std::memory_order_relaxed);
+    size_t usage = MemoryBudget::usage.load(std::memory_order_relaxed);
+    do {
+      if (length > limit || usage > limit - length) return false;
+    } while (!MemoryBudget::usage.compare_exchange_weak(usage, usage + length,
+      std::memory_order_relaxed));
+    return true;
+  }
+
+  /**
+   * Changes the maximum number of bytes that may be reserved at once.
+   *
+   * Lowering the limit below the current usage doesn't release any memory,
+   * but prevents any buffer from growing until enough memory was returned.
+   *
+   * @param limit The new limit of the budget in bytes
+   */
+  void MemoryBudget::setLimit(size_t limit) {
+    MemoryBudget::limit.store(limit, std::memory_order_relaxed);
+  }
+}
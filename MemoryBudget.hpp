@@ -0,0 +1,54 @@
+/**
+ * @file      MemoryBudget.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `MemoryBudget` object.
+ */
+
+#ifndef _CFNETWORKMEMORYBUDGET_H
+#define _CFNETWORKMEMORYBUDGET_H
+
+#include <atomic>         // for atomic
+#include <cstddef>        // for size_t
+#include "CFNetwork.hpp"  // for MemoryBudget
+
+namespace CFNetwork {
+  /**
+   * @class MemoryBudget
+   * A process-wide limit on the memory held by the buffers of every
+   * `Connection`.
+   *
+   * Each `Buffer` reserves its allocation from the budget before growing and
+   * returns it when it is released, so the usage reflects the memory that
+   * buffers actually hold rather than the number of bytes buffered. A
+   * `Connection` whose buffer can't grow within the budget reacts according
+   * to its `BufferPolicy` (by throwing `BufferLimitExceeded` or by pausing
+   * reads), which keeps a large number of slow or misbehaving peers from
+   * exhausting the host's memory.
+   *
+   * The budget is unlimited by default.
+   */
+  class MemoryBudget {
+    protected:
+      /**
+       * @var limit
+       * The maximum number of bytes that may be reserved at once.
+       */
+      static inline std::atomic<size_t> limit = static_cast<size_t>(-1);
+      /**
+       * @var usage
+       * The number of bytes currently reserved.
+       */
+      static inline std::atomic<size_t> usage = 0;
+
+    public:
+      static size_t getLimit();
+      static size_t getUsage();
+      static void   release(size_t length);
+      static bool   reserve(size_t length);
+      static void   setLimit(size_t limit);
+  };
+}
+
+#endif
@@ -0,0 +1,481 @@
+/**
+ * @file      Metrics.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `Metrics` object and related items.
+ */
+
+#include <atomic>       // for atomic, memory_order_relaxed, ...
+#include <chrono>       // for duration_cast, nanoseconds
+#include <cmath>        // for ceil
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <mutex>        // for mutex, lock_guard
+#include "Metrics.hpp"  // for ConnectionMetrics, Histogram, Metrics, ...
+
+namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  namespace {
+    /**
+     * @var SHARDS
+     * The number of independently locked parts of the registry.
+     */
+    const size_t SHARDS = 16;
+
+    /**
+     * @struct Registry
+     * The registered metrics and the retired totals of destroyed objects
+     * belonging to one shard of the registry.
+     */
+    struct Registry {
+      ConnectionMetrics* connections      = nullptr;
+      std::mutex         mutex;
+      size_t             open_connections = 0;
+      size_t             open_sockets     = 0;
+      ConnectionStats    retired_connections;
+      Histogram          retired_delim_wait;
+      Histogram          retired_flush_latency;
+      SocketStats        retired_sockets;
+      SocketMetrics*     sockets          = nullptr;
+    };
+
+    /**
+     * Fetches a shard of the process-wide registry (constructing the registry
+     * on first use so that objects with static storage duration can be
+     * registered).
+     */
+    Registry& registry(size_t shard) {
+      static Registry instances[SHARDS];
+      return instances[shard];
+    }
+
+    /**
+     * Fetches the shard of the registry used by the calling thread (threads
+     * are assigned shards in turn on first use).
+     */
+    size_t localShard() {
+      static std::atomic<size_t> threads = 0;
+      thread_local size_t shard = threads.fetch_add(1,
+        std::memory_order_relaxed) % SHARDS;
+      return shard;
+    }
+
+    /**
+     * Adds the counters of one `ConnectionStats` to another.
+     */
+    void accumulate(ConnectionStats& total, const ConnectionStats& stats) {
+      total.bytes_in     += stats.bytes_in;
+      total.bytes_out    += stats.bytes_out;
+      total.read_eagain  += stats.read_eagain;
+      total.reads        += stats.reads;
+      total.short_writes += stats.short_writes;
+      total.write_eagain += stats.write_eagain;
+      total.writes       += stats.writes;
+      if (stats.buffer_high_water > total.buffer_high_water)
+        total.buffer_high_water = stats.buffer_high_water;
+    }
+
+    /**
+     * Adds the counters of one `SocketStats` to another.
+     */
+    void accumulate(SocketStats& total, const SocketStats& stats) {
+      total.accept_errors += stats.accept_errors;
+      total.accepts       += stats.accepts;
+    }
+
+    /**
+     * Reads a counter that may be concurrently updated.
+     */
+    uint64_t load(const std::atomic<uint64_t>& counter) {
+      return counter.load(std::memory_order_relaxed);
+    }
+  }
+  #endif
+
+  /**
+   * `Histogram` copy Constructor.
+   *
+   * Takes a snapshot of another `Histogram`, which may be recorded to
+   * concurrently.
+   *
+   * @param other The `Histogram` to copy
+   */
+  Histogram::Histogram(const Histogram& other) {
+    this->merge(other);
+  }
+
+  /**
+   * `Histogram` copy assignment operator.
+   *
+   * @param  other The `Histogram` to copy
+   *
+   * @return A reference to this `Histogram`.
+   */
+  Histogram& Histogram::operator= (const Histogram& other) {
+    if (this != &other) {
+      this->reset();
+      this->merge(other);
+    }
+    return *this;
+  }
+
+  /**
+   * Fetches the number of samples that were recorded.
+   *
+   * @return `uint64_t` of the number of samples.
+   */
+  uint64_t Histogram::getCount() const {
+    return load(this->count);
+  }
+
+  /**
+   * Fetches the largest sample that was recorded.
+   *
+   * @return `uint64_t` of the largest sample (or zero if none were recorded).
+   */
+  uint64_t Histogram::getMax() const {
+    return load(this->maximum);
+  }
+
+  /**
+   * Calculates the arithmetic mean of the recorded samples.
+   *
+   * @return `double` of the mean (or zero if no samples were recorded).
+   */
+  double Histogram::getMean() const {
+    uint64_t count = load(this->count);
+    return count ? static_cast<double>(load(this->total)) / count : 0;
+  }
+
+  /**
+   * Estimates the value below which the provided percentage of samples fall.
+   *
+   * The result is the upper bound of the bucket holding the requested sample
+   * (but never more than the largest recorded sample).
+   *
+   * @param  percentile The percentage of samples (between 0 and 100)
+   *
+   * @return `uint64_t` of the estimated value (or zero if no samples were
+   *         recorded).
+   */
+  uint64_t Histogram::getPercentile(double percentile) const {
+    uint64_t count = 0;
+    for (const auto& bucket : this->counts) count += load(bucket);
+    if (count == 0) return 0;
+    if (percentile < 0)   percentile = 0;
+    if (percentile > 100) percentile = 100;
+    // Determine the (one-based) rank of the requested sample
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100 * count));
+    if (rank == 0) rank = 1;
+    uint64_t maximum = load(this->maximum), seen = 0;
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+      if ((seen += load(this->counts[i])) < rank) continue;
+      uint64_t bound = Histogram::upperBound(i);
+      return bound < maximum ? bound : maximum;
+    }
+    return maximum;
+  }
+
+  /**
+   * Determines the bucket that a value is counted in.
+   *
+   * Values below 32 map directly onto the first 32 buckets. Larger values are
+   * shifted right until they fit between 16 and 31, and each shift moves the
+   * value into the next group of 16 buckets.
+   *
+   * @param  value The value to locate
+   *
+   * @return The index of the bucket.
+   */
+  size_t Histogram::locate(uint64_t value) {
+    if (value > Histogram::MAX_VALUE) value = Histogram::MAX_VALUE;
+    size_t shift = value < 32 ? 0 : 59 - __builtin_clzll(value);
+    return shift * 16 + static_cast<size_t>(value >> shift);
+  }
+
+  /**
+   * Adds the samples of another `Histogram` to this `Histogram`.
+   *
+   * @param other The `Histogram` to add
+   */
+  void Histogram::merge(const Histogram& other) {
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i)
+      this->counts[i].fetch_add(load(other.counts[i]),
+        std::memory_order_relaxed);
+    this->count.fetch_add(load(other.count), std::memory_order_relaxed);
+    this->total.fetch_add(load(other.total), std::memory_order_relaxed);
+    uint64_t maximum = load(other.maximum);
+    uint64_t current = load(this->maximum);
+    while (current < maximum && !this->maximum.compare_exchange_weak(current,
+      maximum, std::memory_order_relaxed));
+  }
+
+  /**
+   * Records a sample.
+   *
+   * @param value The sample to record
+   */
+  void Histogram::record(uint64_t value) {
+    this->counts[Histogram::locate(value)].fetch_add(1,
+      std::memory_order_relaxed);
+    this->count.fetch_add(1, std::memory_order_relaxed);
+    this->total.fetch_add(value, std::memory_order_relaxed);
+    uint64_t current = load(this->maximum);
+    while (current < value && !this->maximum.compare_exchange_weak(current,
+      value, std::memory_order_relaxed));
+  }
+
+  /**
+   * Discards every recorded sample.
+   */
+  void Histogram::reset() {
+    for (auto& bucket : this->counts)
+      bucket.store(0, std::memory_order_relaxed);
+    this->count.store(0, std::memory_order_relaxed);
+    this->maximum.store(0, std::memory_order_relaxed);
+    this->total.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * Determines the largest value that is counted in a bucket.
+   *
+   * @param  index The index of the bucket
+   *
+   * @return The largest value counted in the bucket.
+   */
+  uint64_t Histogram::upperBound(size_t index) {
+    size_t shift = index < 32 ? 0 : index / 16 - 1;
+    return ((static_cast<uint64_t>(index - shift * 16) + 1) << shift) - 1;
+  }
+
+  /**
+   * Registers a `ConnectionMetrics` with the calling thread's shard of the
+   * registry.
+   *
+   * @param metrics The `ConnectionMetrics` to register
+   */
+  void Metrics::attach(ConnectionMetrics& metrics) {
+    metrics.shard = localShard();
+    Registry& registry = CFNetwork::registry(metrics.shard);
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    metrics.next = registry.connections;
+    if (registry.connections) registry.connections->previous = &metrics;
+    registry.connections = &metrics;
+    ++registry.open_connections;
+  }
+
+  /**
+   * Registers a `SocketMetrics` with the calling thread's shard of the
+   * registry.
+   *
+   * @param metrics The `SocketMetrics` to register
+   */
+  void Metrics::attach(SocketMetrics& metrics) {
+    metrics.shard = localShard();
+    Registry& registry = CFNetwork::registry(metrics.shard);
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    metrics.next = registry.sockets;
+    if (registry.sockets) registry.sockets->previous = &metrics;
+    registry.sockets = &metrics;
+    ++registry.open_sockets;
+  }
+
+  /**
+   * Unregisters a `ConnectionMetrics`, folding its counters and histograms
+   * into the retired totals.
+   *
+   * @param metrics The `ConnectionMetrics` to unregister
+   */
+  void Metrics::detach(ConnectionMetrics& metrics) {
+    Registry& registry = CFNetwork::registry(metrics.shard);
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    if (metrics.previous) metrics.previous->next = metrics.next;
+    else registry.connections = metrics.next;
+    if (metrics.next) metrics.next->previous = metrics.previous;
+    --registry.open_connections;
+    accumulate(registry.retired_connections, metrics.getStats());
+    if (Histogram* histogram = metrics.delim_wait.load())
+      registry.retired_delim_wait.merge(*histogram);
+    if (Histogram* histogram = metrics.flush_latency.load())
+      registry.retired_flush_latency.merge(*histogram);
+  }
+
+  /**
+   * Unregisters a `SocketMetrics`, folding its counters into the retired
+   * totals.
+   *
+   * @param metrics The `SocketMetrics` to unregister
+   */
+  void Metrics::detach(SocketMetrics& metrics) {
+    Registry& registry = CFNetwork::registry(metrics.shard);
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    if (metrics.previous) metrics.previous->next = metrics.next;
+    else registry.sockets = metrics.next;
+    if (metrics.next) metrics.next->previous = metrics.previous;
+    --registry.open_sockets;
+    accumulate(registry.retired_sockets, metrics.getStats());
+  }
+
+  /**
+   * Toggles the recording of latency histograms.
+   *
+   * Objects only allocate their histograms once a sample is recorded, so
+   * histograms don't cost any memory or time until they are enabled.
+   * Disabling them stops further samples from being recorded but retains the
+   * samples recorded so far.
+   *
+   * @param enabled Whether or not histograms should be recorded
+   */
+  void Metrics::enableHistograms(bool enabled) {
+    Metrics::histograms.store(enabled, std::memory_order_relaxed);
+  }
+
+  /**
+   * Combines the metrics of every `Connection` and `Socket`.
+   *
+   * Each shard of the registry is locked in turn while its live counters are
+   * read, which only delays the construction and destruction of objects
+   * registered with that shard. The counters of
+   * a single object are read individually, so a snapshot taken during I/O may
+   * be (very slightly) inconsistent between counters.
+   *
+   * @return `MetricsSnapshot` of the current totals.
+   */
+  MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot snapshot;
+    for (size_t shard = 0; shard < SHARDS; ++shard) {
+      Registry& registry = CFNetwork::registry(shard);
+      std::lock_guard<std::mutex> lock{registry.mutex};
+      accumulate(snapshot.connections, registry.retired_connections);
+      snapshot.delim_wait.merge(registry.retired_delim_wait);
+      snapshot.flush_latency.merge(registry.retired_flush_latency);
+      snapshot.open_connections += registry.open_connections;
+      snapshot.open_sockets     += registry.open_sockets;
+      accumulate(snapshot.sockets, registry.retired_sockets);
+      for (ConnectionMetrics* metrics = registry.connections; metrics;
+          metrics = metrics->next) {
+        accumulate(snapshot.connections, metrics->getStats());
+        if (Histogram* histogram = metrics->delim_wait.load(
+            std::memory_order_acquire))
+          snapshot.delim_wait.merge(*histogram);
+        if (Histogram* histogram = metrics->flush_latency.load(
+            std::memory_order_acquire))
+          snapshot.flush_latency.merge(*histogram);
+      }
+      for (SocketMetrics* metrics = registry.sockets; metrics;
+          metrics = metrics->next)
+        accumulate(snapshot.sockets, metrics->getStats());
+    }
+    return snapshot;
+  }
+
+  /**
+   * `ConnectionMetrics` Constructor.
+   *
+   * Registers the `ConnectionMetrics` with the `Metrics` registry.
+   */
+  ConnectionMetrics::ConnectionMetrics() {
+    Metrics::attach(*this);
+  }
+
+  /**
+   * `ConnectionMetrics` Destructor.
+   *
+   * Folds the counters into the `Metrics` registry's retired totals and
+   * releases the histograms (if any).
+   */
+  ConnectionMetrics::~ConnectionMetrics() {
+    Metrics::detach(*this);
+    delete this->delim_wait.load();
+    delete this->flush_latency.load();
+  }
+
+  /**
+   * Takes a snapshot of the `readDelim()` wait time histogram.
+   *
+   * @return `Histogram` of nanoseconds spent in each successful `readDelim()`
+   *         (which is empty if histograms were never enabled).
+   */
+  Histogram ConnectionMetrics::getDelimWait() const {
+    Histogram* histogram = this->delim_wait.load(std::memory_order_acquire);
+    return histogram ? *histogram : Histogram{};
+  }
+
+  /**
+   * Takes a snapshot of the flush latency histogram.
+   *
+   * @return `Histogram` of nanoseconds taken to write queued data (which is
+   *         empty if histograms were never enabled).
+   */
+  Histogram ConnectionMetrics::getFlushLatency() const {
+    Histogram* histogram = this->flush_latency.load(std::memory_order_acquire);
+    return histogram ? *histogram : Histogram{};
+  }
+
+  /**
+   * Takes a snapshot of the counters.
+   *
+   * @return `ConnectionStats` of the current counters.
+   */
+  ConnectionStats ConnectionMetrics::getStats() const {
+    ConnectionStats stats;
+    stats.bytes_in          = load(this->bytes_in);
+    stats.bytes_out         = load(this->bytes_out);
+    stats.buffer_high_water = load(this->buffer_high_water);
+    stats.read_eagain       = load(this->read_eagain);
+    stats.reads             = load(this->reads);
+    stats.short_writes      = load(this->short_writes);
+    stats.write_eagain      = load(this->write_eagain);
+    stats.writes            = load(this->writes);
+    return stats;
+  }
+
+  /**
+   * Records a duration in a histogram, allocating the histogram if needed.
+   *
+   * @param histogram The histogram to record in
+   * @param elapsed   The duration to record
+   */
+  void ConnectionMetrics::record(std::atomic<Histogram*>& histogram,
+      Clock::duration elapsed) {
+    Histogram* target = histogram.load(std::memory_order_relaxed);
+    if (target == nullptr) {
+      // Publish the histogram only once it has been constructed
+      target = new Histogram;
+      histogram.store(target, std::memory_order_release);
+    }
+    target->record(static_cast<uint64_t>(std::chrono::duration_cast<
+      std::chrono::nanoseconds>(elapsed).count()));
+  }
+
+  /**
+   * `SocketMetrics` Constructor.
+   *
+   * Registers the `SocketMetrics` with the `Metrics` registry.
+   */
+  SocketMetrics::SocketMetrics() {
+    Metrics::attach(*this);
+  }
+
+  /**
+   * `SocketMetrics` Destructor.
+   *
+   * Folds the counters into the `Metrics` registry's retired totals.
+   */
+  SocketMetrics::~SocketMetrics() {
+    Metrics::detach(*this);
+  }
+
+  /**
+   * Takes a snapshot of the counters.
+   *
+   * @return `SocketStats` of the current counters.
+   */
+  SocketStats SocketMetrics::getStats() const {
+    SocketStats stats;
+    stats.accept_errors = load(this->accept_errors);
+    stats.accepts       = load(this->accepts);
+    return stats;
+  }
+}
@@ -0,0 +1,492 @@
+/**
+ * @file      Metrics.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Metrics` object and related items.
+ */
+
+#ifndef _CFNETWORKMETRICS_H
+#define _CFNETWORKMETRICS_H
+
+#include <atomic>         // for atomic, memory_order_relaxed
+#include <chrono>         // for nanoseconds, steady_clock
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint64_t
+#include "CFNetwork.hpp"  // for ConnectionMetrics, Histogram, Metrics, ...
+
+namespace CFNetwork {
+  /**
+   * @class Histogram
+   * A log-linear histogram of non-negative integer samples (e.g. durations in
+   * nanoseconds).
+   *
+   * Like an HDR histogram, samples below 32 are counted exactly and each
+   * following power of two is divided into 16 equally sized buckets, so every
+   * reported percentile is within 6.25% of the true value. Samples are
+   * clamped to `MAX_VALUE` (about 18 minutes in nanoseconds), which bounds the
+   * histogram to a fixed array of 592 counters.
+   *
+   * Samples are recorded using relaxed atomic operations, so a `Histogram` may
+   * be read (or copied to take a snapshot of it) while it is being recorded
+   * to without stopping the recording thread.
+   */
+  class Histogram {
+    public:
+      /**
+       * @var BUCKETS
+       * The number of buckets needed to cover every value up to `MAX_VALUE`.
+       */
+      static const size_t   BUCKETS   = 592;
+      /**
+       * @var MAX_VALUE
+       * The largest value that can be recorded without being clamped.
+       */
+      static const uint64_t MAX_VALUE = (uint64_t{1} << 40) - 1;
+
+    protected:
+      /**
+       * @var count
+       * The number of samples that were recorded.
+       */
+      std::atomic<uint64_t> count   = 0;
+      /**
+       * @var counts
+       * The number of samples that were recorded in each bucket.
+       */
+      std::atomic<uint64_t> counts[BUCKETS] = {};
+      /**
+       * @var maximum
+       * The largest sample that was recorded.
+       */
+      std::atomic<uint64_t> maximum = 0;
+      /**
+       * @var total
+       * The sum of every sample that was recorded.
+       */
+      std::atomic<uint64_t> total   = 0;
+
+      static size_t   locate(uint64_t value);
+      static uint64_t upperBound(size_t index);
+
+    public:
+      Histogram() = default;
+      Histogram(const Histogram& other);
+      Histogram& operator= (const Histogram& other);
+      uint64_t   getCount()                                         const;
+      uint64_t   getMax()                                           const;
+      double     getMean()                                          const;
+      uint64_t   getPercentile(double percentile)                   const;
+      void       merge(const Histogram& other);
+      void       record(uint64_t value);
+      void       reset();
+  };
+
+  /**
+   * @struct ConnectionStats
+   * A snapshot of the counters of one (or many) `Connection` objects.
+   */
+  struct ConnectionStats {
+    /**
+     * @var bytes_in
+     * The number of bytes received.
+     */
+    uint64_t bytes_in          = 0;
+    /**
+     * @var bytes_out
+     * The number of bytes sent.
+     */
+    uint64_t bytes_out         = 0;
+    /**
+     * @var buffer_high_water
+     * The largest number of bytes held by the internal buffer at once.
+     */
+    uint64_t buffer_high_water = 0;
+    /**
+     * @var read_eagain
+     * The number of receive system calls that reported `EAGAIN`.
+     */
+    uint64_t read_eagain       = 0;
+    /**
+     * @var reads
+     * The number of receive system calls (or `IOUring` completions).
+     */
+    uint64_t reads             = 0;
+    /**
+     * @var short_writes
+     * The number of send system calls that accepted less than requested.
+     */
+    uint64_t short_writes      = 0;
+    /**
+     * @var write_eagain
+     * The number of send system calls that reported `EAGAIN`.
+     */
+    uint64_t write_eagain      = 0;
+    /**
+     * @var writes
+     * The number of send system calls (including `sendfile(2)`).
+     */
+    uint64_t writes            = 0;
+  };
+
+  /**
+   * @struct SocketStats
+   * A snapshot of the counters of one (or many) `Socket` objects.
+   */
+  struct SocketStats {
+    /**
+     * @var accept_errors
+     * The number of failed attempts to accept a client.
+     */
+    uint64_t accept_errors = 0;
+    /**
+     * @var accepts
+     * The number of clients that were accepted.
+     */
+    uint64_t accepts       = 0;
+  };
+
+  /**
+   * @struct MetricsSnapshot
+   * The combined counters and histograms of every `Connection` and `Socket`
+   * (both open and already destroyed) at the time of `Metrics::snapshot()`.
+   */
+  struct MetricsSnapshot {
+    /**
+     * @var connections
+     * The combined counters of every `Connection`.
+     */
+    ConnectionStats connections;
+    /**
+     * @var delim_wait
+     * The time (in nanoseconds) spent in each successful `readDelim()`.
+     */
+    Histogram       delim_wait;
+    /**
+     * @var flush_latency
+     * The time (in nanoseconds) from a `flush()` with queued data until the
+     * queue was fully written.
+     */
+    Histogram       flush_latency;
+    /**
+     * @var open_connections
+     * The number of `Connection` objects that currently exist.
+     */
+    size_t          open_connections = 0;
+    /**
+     * @var open_sockets
+     * The number of `Socket` objects that currently exist.
+     */
+    size_t          open_sockets     = 0;
+    /**
+     * @var sockets
+     * The combined counters of every `Socket`.
+     */
+    SocketStats     sockets;
+  };
+
+  /**
+   * @class Metrics
+   * The process-wide registry of `Connection` and `Socket` metrics.
+   *
+   * Every `Connection` and `Socket` registers its counters on construction
+   * and folds them into the registry's retired totals on destruction, so a
+   * snapshot always covers the lifetime of the process. The registry is split
+   * into shards with their own locks, and each thread registers with a shard
+   * of its own, so threads accepting and closing connections concurrently
+   * (such as those of a `ShardedSocket`) don't contend with each other.
+   * Taking a snapshot locks one shard at a time, and threads performing I/O
+   * are never stopped since the counters are read using relaxed atomic
+   * loads.
+   *
+   * Latency histograms are disabled by default since they require reading the
+   * clock on the hot paths; they can be toggled at any time using
+   * `enableHistograms()`.
+   */
+  class Metrics {
+    private:
+      friend class ConnectionMetrics;
+      friend class SocketMetrics;
+
+    protected:
+      /**
+       * @var histograms
+       * Whether or not latency histograms are recorded.
+       */
+      static inline std::atomic<bool> histograms = false;
+
+      static void attach(ConnectionMetrics& metrics);
+      static void attach(SocketMetrics& metrics);
+      static void detach(ConnectionMetrics& metrics);
+      static void detach(SocketMetrics& metrics);
+
+    public:
+      static void            enableHistograms(bool enabled);
+      static MetricsSnapshot snapshot();
+
+      /**
+       * Determines whether or not latency histograms are recorded.
+       *
+       * @return `true` if histograms are recorded, `false` otherwise.
+       */
+      static bool isHistogramsEnabled() {
+        return Metrics::histograms.load(std::memory_order_relaxed);
+      }
+  };
+
+  /**
+   * @class ConnectionMetrics
+   * The live counters and histograms of a single `Connection`.
+   *
+   * Each counter only has a single writer (the thread currently using the
+   * `Connection`), so counting is a relaxed load and store rather than an
+   * atomic read-modify-write, which keeps the cost of each update to a plain
+   * memory access. Histograms are only allocated once a sample is recorded
+   * while `Metrics::isHistogramsEnabled()`.
+   *
+   * The `ConnectionMetrics` object is not copyable or assignable since it is
+   * registered with `Metrics` by address.
+   */
+  class ConnectionMetrics {
+    private:
+      ConnectionMetrics(const ConnectionMetrics&);
+      ConnectionMetrics& operator= (const ConnectionMetrics&);
+      friend class Metrics;
+
+    public:
+      /**
+       * @typedef Clock
+       * The clock used to measure latencies.
+       */
+      typedef std::chrono::steady_clock Clock;
+
+    protected:
+      /**
+       * @var bytes_in
+       * The number of bytes received.
+       */
+      std::atomic<uint64_t>   bytes_in          = 0;
+      /**
+       * @var bytes_out
+       * The number of bytes sent.
+       */
+      std::atomic<uint64_t>   bytes_out         = 0;
+      /**
+       * @var buffer_high_water
+       * The largest number of bytes held by the internal buffer at once.
+       */
+      std::atomic<uint64_t>   buffer_high_water = 0;
+      /**
+       * @var delim_wait
+       * The histogram of time spent in successful `readDelim()` calls.
+       */
+      std::atomic<Histogram*> delim_wait        = nullptr;
+      /**
+       * @var flush_latency
+       * The histogram of time taken to write queued data.
+       */
+      std::atomic<Histogram*> flush_latency     = nullptr;
+      /**
+       * @var flush_start
+       * When the queued data currently being written was first flushed.
+       */
+      Clock::time_point       flush_start       = {};
+      /**
+       * @var next
+       * The next `ConnectionMetrics` registered with `Metrics`.
+       */
+      ConnectionMetrics*      next              = nullptr;
+      /**
+       * @var previous
+       * The previous `ConnectionMetrics` registered with `Metrics`.
+       */
+      ConnectionMetrics*      previous          = nullptr;
+      /**
+       * @var read_eagain
+       * The number of receive system calls that reported `EAGAIN`.
+       */
+      std::atomic<uint64_t>   read_eagain       = 0;
+      /**
+       * @var reads
+       * The number of receive system calls.
+       */
+      std::atomic<uint64_t>   reads             = 0;
+      /**
+       * @var shard
+       * The part of the `Metrics` registry that the `ConnectionMetrics` is
+       * registered with.
+       */
+      size_t                  shard             = 0;
+      /**
+       * @var short_writes
+       * The number of send system calls that accepted less than requested.
+       */
+      std::atomic<uint64_t>   short_writes      = 0;
+      /**
+       * @var write_eagain
+       * The number of send system calls that reported `EAGAIN`.
+       */
+      std::atomic<uint64_t>   write_eagain      = 0;
+      /**
+       * @var writes
+       * The number of send system calls.
+       */
+      std::atomic<uint64_t>   writes            = 0;
+
+      static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+          std::memory_order_relaxed);
+      }
+      static void record(std::atomic<Histogram*>& histogram,
+        Clock::duration elapsed);
+
+    public:
+      ConnectionMetrics();
+     ~ConnectionMetrics();
+      Histogram       getDelimWait()                                const;
+      Histogram       getFlushLatency()                             const;
+      ConnectionStats getStats()                                    const;
+
+      /**
+       * Marks the start of a `flush()` with queued data.
+       */
+      void beginFlush() {
+        if (this->flush_start == Clock::time_point{} &&
+            Metrics::isHistogramsEnabled())
+          this->flush_start = Clock::now();
+      }
+
+      /**
+       * Counts a receive system call that reported `EAGAIN`.
+       */
+      void countBlockedRead() {
+        ConnectionMetrics::bump(this->read_eagain, 1);
+      }
+
+      /**
+       * Counts a send system call that reported `EAGAIN`.
+       */
+      void countBlockedWrite() {
+        ConnectionMetrics::bump(this->write_eagain, 1);
+      }
+
+      /**
+       * Counts a successful receive system call.
+       *
+       * @param length The number of bytes that were received
+       */
+      void countRead(size_t length) {
+        ConnectionMetrics::bump(this->reads, 1);
+        ConnectionMetrics::bump(this->bytes_in, length);
+      }
+
+      /**
+       * Counts a successful send system call.
+       *
+       * @param length    The number of bytes that were sent
+       * @param requested The number of bytes that were offered
+       */
+      void countWrite(size_t length, size_t requested) {
+        ConnectionMetrics::bump(this->writes, 1);
+        ConnectionMetrics::bump(this->bytes_out, length);
+        if (length < requested) ConnectionMetrics::bump(this->short_writes, 1);
+      }
+
+      /**
+       * Marks the end of a `flush()` that wrote all queued data.
+       */
+      void endFlush() {
+        if (this->flush_start == Clock::time_point{}) return;
+        ConnectionMetrics::record(this->flush_latency,
+          Clock::now() - this->flush_start);
+        this->flush_start = {};
+      }
+
+      /**
+       * Updates the high-water mark of the internal buffer.
+       *
+       * @param size The number of bytes held by the internal buffer
+       */
+      void observeBuffer(size_t size) {
+        if (size > this->buffer_high_water.load(std::memory_order_relaxed))
+          this->buffer_high_water.store(size, std::memory_order_relaxed);
+      }
+
+      /**
+       * Records the time spent in a successful `readDelim()`.
+       *
+       * @param start When the `readDelim()` began (or the epoch if histograms
+       *              were disabled at the time)
+       */
+      void recordDelimWait(Clock::time_point start) {
+        if (start != Clock::time_point{})
+          ConnectionMetrics::record(this->delim_wait, Clock::now() - start);
+      }
+  };
+
+  /**
+   * @class SocketMetrics
+   * The live counters of a single `Socket`.
+   *
+   * A `Socket` may accept clients on several threads at once, so its counters
+   * are updated using relaxed atomic increments.
+   *
+   * The `SocketMetrics` object is not copyable or assignable since it is
+   * registered with `Metrics` by address.
+   */
+  class SocketMetrics {
+    private:
+      SocketMetrics(const SocketMetrics&);
+      SocketMetrics& operator= (const SocketMetrics&);
+      friend class Metrics;
+
+    protected:
+      /**
+       * @var accept_errors
+       * The number of failed attempts to accept a client.
+       */
+      std::atomic<uint64_t> accept_errors = 0;
+      /**
+       * @var accepts
+       * The number of clients that were accepted.
+       */
+      std::atomic<uint64_t> accepts       = 0;
+      /**
+       * @var next
+       * The next `SocketMetrics` registered with `Metrics`.
+       */
+      SocketMetrics*        next          = nullptr;
+      /**
+       * @var previous
+       * The previous `SocketMetrics` registered with `Metrics`.
+       */
+      SocketMetrics*        previous      = nullptr;
+      /**
+       * @var shard
+       * The part of the `Metrics` registry that the `SocketMetrics` is
+       * registered with.
+       */
+      size_t                shard         = 0;
+
+    public:
+      SocketMetrics();
+     ~SocketMetrics();
+      SocketStats getStats()                                        const;
+
+      /**
+       * Counts an accepted client.
+       */
+      void countAccept() {
+        this->accepts.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      /**
+       * Counts a failed attempt to accept a client.
+       */
+      void countAcceptError() {
+        this->accept_errors.fetch_add(1, std::memory_order_relaxed);
+      }
+  };
+}
+
+#endif
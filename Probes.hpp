@@ -0,0 +1,48 @@
+/**
+ * @file      Probes.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Static tracepoints (USDT probes) for the `CFNetwork` namespace.
+ *
+ * Each probe is declared with the `cfnetwork` provider using `<sys/sdt.h>`,
+ * which compiles to a single `nop` instruction and a note in the binary
+ * describing the probe's location and arguments. Tracers such as `bpftrace`
+ * and `perf` patch the `nop` only while attached, so the probes cost nothing
+ * when unused and no recompilation is needed to trace a production binary
+ * (see the scripts in `scripts/`).
+ *
+ * The following probes are provided (every argument is an integer):
+ *   - `accept(listen_fd, client_fd)` when `Socket` accepts a client
+ *   - `enqueue(fd, requested, received)` when `Connection::enqueueData()`
+ *     returns
+ *   - `read_delim(fd, length)` when `Connection::readDelim()` (or one of its
+ *     variants) finds a message
+ *   - `send(fd, length)` when the kernel accepts data written by a
+ *     `Connection` (from `flush()`, `sendFile()`, `pipeTo()` or
+ *     `sendDescriptor()`), which covers every outbound path
+ *   - `write(fd, length)` when `Connection::write()` queues data
+ *
+ * If `<sys/sdt.h>` isn't available (or `CFNETWORK_NO_PROBES` is defined) the
+ * probes expand to nothing and their arguments aren't evaluated.
+ */
+
+#ifndef _CFNETWORKPROBES_H
+#define _CFNETWORKPROBES_H
+
+#if !defined(CFNETWORK_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>  // for STAP_PROBEV
+#define CFNETWORK_PROBES 1
+#endif
+#endif
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+#ifdef CFNETWORK_PROBES
+#define CFNETWORK_PROBE(name, ...) STAP_PROBEV(cfnetwork, name, __VA_ARGS__)
+#else
+#define CFNETWORK_PROBE(name, ...) do {} while (0)
+#endif
+#endif
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * @file      Resolver.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `Resolver` object.
+ */
+
+#include <algorithm>       // for max
+#include <chrono>          // for steady_clock
+#include <cstring>         // for memcmp, memcpy
+#include <exception>       // for current_exception, make_exception_ptr
+#include <future>          // for future_status, promise, shared_future
+#include <memory>          // for make_shared, shared_ptr, unique_ptr
+#include <mutex>           // for lock_guard, mutex, unique_lock
+#include <netdb.h>         // for addrinfo, freeaddrinfo, getaddrinfo
+#include <string>          // for string
+#include <sys/socket.h>    // for sockaddr_storage, AF_INET, AF_INET6
+#include <thread>          // for thread
+#include <utility>         // for move
+#include "CFNetwork.hpp"   // for ConnectionTimedOut, InvalidArgument, ...
+#include "Connection.hpp"  // for Connection
+#include "Resolver.hpp"    // for Resolver
+
+namespace CFNetwork {
+  /**
+   * `Resolver` Constructor.
+   *
+   * Constructs a `Resolver` object and starts its worker threads.
+   *
+   * @param threads      The number of lookups that can run concurrently
+   * @param ttl          How long a successful lookup is cached
+   * @param negative_ttl How long a failed lookup is cached
+   */
+  Resolver::Resolver(size_t threads, std::chrono::steady_clock::duration ttl,
+      std::chrono::steady_clock::duration negative_ttl) :
+      negative_ttl{negative_ttl}, ttl{ttl} {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i)
+      this->workers.emplace_back(&Resolver::work, this);
+  }
+
+  /**
+   * `Resolver` Destructor.
+   *
+   * Upon destruction of a `Resolver` object, fail every queued lookup and wait
+   * for the lookups that are in progress to finish.
+   */
+  Resolver::~Resolver() {
+    std::deque<Request> abandoned{};
+    {
+      std::lock_guard<std::mutex> lock{this->mutex};
+      this->stopping = true;
+      abandoned.swap(this->queue);
+    }
+    this->ready.notify_all();
+    for (Request& request : abandoned)
+      request.promise->set_exception(std::make_exception_ptr(UnexpectedError{
+        "The resolver was destroyed before resolving " + request.host}));
+    for (std::thread& worker : this->workers)
+      worker.join();
+  }
+
+  /**
+   * Discards every cached lookup.
+   *
+   * Lookups that are in progress are unaffected.
+   */
+  void Resolver::clear() {
+    std::lock_guard<std::mutex> lock{this->mutex};
+    for (auto it = this->cache.begin(); it != this->cache.end();) {
+      if (it->second.expires == std::chrono::steady_clock::time_point::max())
+        ++it;
+      else it = this->cache.erase(it);
+    }
+  }
+
+  /**
+   * Resolves a host name and connects to the first reachable address.
+   *
+   * The timeout covers both the lookup (which may already be cached) and the
+   * connection attempts. A timeout of zero waits indefinitely for both.
+   *
+   * @see    `Connection::connect()` for more information regarding how the
+   *         resolved addresses are attempted.
+   *
+   * @throws `InvalidArgument`    if the host name couldn't be resolved or the
+   *                              port or timeout is invalid.
+   * @throws `ConnectionTimedOut` if the host name couldn't be resolved, or no
+   *                              address could be connected to, before the
+   *                              timeout expired.
+   * @throws `UnexpectedError`    if every address failed before the timeout
+   *                              expired.
+   *
+   * @param  host          The host name (or address) of the remote endpoint
+   * @param  port          The port of the remote endpoint
+   * @param  timeout       The maximum amount of time to wait for a connection
+   *                       (or zero to wait indefinitely)
+   * @param  attempt_delay How long to wait for an attempt before racing it
+   *                       against the next address
+   *
+   * @return `Connection` object connected to the first responsive address.
+   */
+  std::shared_ptr<Connection> Resolver::connect(const std::string& host,
+      int port, std::chrono::milliseconds timeout,
+      std::chrono::milliseconds attempt_delay) {
+    if (timeout.count() < 0)
+      throw InvalidArgument{"The connection timeout is invalid."};
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::shared_future<Addresses> result = this->resolve(host);
+    // A timeout of zero waits indefinitely for the lookup and the connection
+    if (timeout.count() == 0)
+      return Connection::connect(result.get(), port, timeout, attempt_delay);
+    if (result.wait_until(deadline) != std::future_status::ready)
+      throw ConnectionTimedOut{"Timed out while resolving " + host};
+    // Don't let a remaining time of zero be mistaken for no deadline
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0)
+      throw ConnectionTimedOut{"Timed out before connecting to " + host};
+    return Connection::connect(result.get(), port, remaining, attempt_delay);
+  }
+
+  /**
+   * Resolves a host name to all of its IPv4 and IPv6 addresses.
+   *
+   * This is the blocking `getaddrinfo(3)` call performed by the worker
+   * threads. Duplicate addresses are removed while preserving the order of
+   * preference reported by the system.
+   *
+   * @throws `InvalidArgument` if the host name couldn't be resolved.
+   *
+   * @param  host The host name (or address) to resolve
+   *
+   * @return The addresses that the host name resolved to.
+   */
+  Resolver::Addresses Resolver::lookup(const std::string& host) {
+    struct addrinfo hints = {}, *res = nullptr;
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_ADDRCONFIG;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0)
+      throw InvalidArgument{"Could not resolve " + host};
+    // Free the results even if copying them throws (e.g. `std::bad_alloc`)
+    std::unique_ptr<struct addrinfo, decltype(&freeaddrinfo)> results{res,
+      &freeaddrinfo};
+    Addresses addresses{};
+    for (struct addrinfo* it = res; it != nullptr; it = it->ai_next) {
+      if (it->ai_family != AF_INET && it->ai_family != AF_INET6) continue;
+      struct sockaddr_storage address = {};
+      memcpy(&address, it->ai_addr, it->ai_addrlen);
+      bool duplicate = false;
+      for (const struct sockaddr_storage& other : addresses)
+        duplicate = duplicate || memcmp(&other, &address, sizeof(address)) == 0;
+      if (!duplicate) addresses.push_back(address);
+    }
+    if (addresses.empty())
+      throw InvalidArgument{"Could not resolve " + host};
+    return addresses;
+  }
+
+  /**
+   * Discards every cached lookup that has expired.
+   *
+   * Pruning happens whenever the cache doubles in size (relative to the number
+   * of entries that survived the previous pruning), so the cache stays
+   * proportional to the number of host names resolved within a time to live
+   * while each lookup bears a constant amortized cost. The caller must hold
+   * the `mutex`.
+   *
+   * @param now The current time
+   */
+  void Resolver::prune(std::chrono::steady_clock::time_point now) {
+    if (this->cache.size() < this->prune_at) return;
+    for (auto it = this->cache.begin(); it != this->cache.end();) {
+      if (now < it->second.expires) ++it;
+      else it = this->cache.erase(it);
+    }
+    this->prune_at = std::max<size_t>(64, this->cache.size() * 2);
+  }
+
+  /**
+   * Resolves a host name without blocking the calling thread.
+   *
+   * A cached result is returned immediately if it hasn't expired, and a lookup
+   * that is already in progress for the same host name is shared rather than
+   * repeated. Otherwise a new lookup is queued for a worker thread, and
+   * expired entries are pruned from the cache as it grows.
+   *
+   * If the lookup fails, calling `get()` on the result throws an
+   * `InvalidArgument` exception (or whichever exception, such as
+   * `std::bad_alloc`, interrupted the lookup).
+   *
+   * @param  host The host name (or address) to resolve
+   *
+   * @return `std::shared_future` that provides the resolved addresses.
+   */
+  std::shared_future<Resolver::Addresses> Resolver::resolve(
+      const std::string& host) {
+    // Numeric addresses don't require a lookup (and host names are told apart
+    // from them without throwing an exception)
+    struct sockaddr_storage address = {};
+    if (tryParseAddress(host, address)) {
+      std::promise<Addresses> numeric{};
+      numeric.set_value(Addresses{address});
+      return numeric.get_future().share();
+    }
+    std::unique_lock<std::mutex> lock{this->mutex};
+    auto now = std::chrono::steady_clock::now();
+    auto it  = this->cache.find(host);
+    if (it != this->cache.end() && now < it->second.expires)
+      return it->second.result;
+    this->prune(now);
+    // Queue a new lookup, which remains in the cache while in progress
+    Request request{host, std::make_shared<std::promise<Addresses>>()};
+    std::shared_future<Addresses> result =
+      request.promise->get_future().share();
+    this->cache[host] = Entry{result,
+      std::chrono::steady_clock::time_point::max()};
+    this->queue.push_back(std::move(request));
+    lock.unlock();
+    this->ready.notify_one();
+    return result;
+  }
+
+  /**
+   * Performs queued lookups until the `Resolver` is destroyed.
+   */
+  void Resolver::work() {
+    std::unique_lock<std::mutex> lock{this->mutex};
+    while (true) {
+      this->ready.wait(lock, [this]() {
+        return this->stopping || !this->queue.empty();
+      });
+      if (this->stopping) return;
+      Request request = std::move(this->queue.front());
+      this->queue.pop_front();
+      lock.unlock();
+      // Perform the lookup without holding the lock (passing any exception,
+      // such as `std::bad_alloc`, on to the waiting callers rather than
+      // letting it escape the worker thread)
+      bool success = true;
+      try {
+        request.promise->set_value(Resolver::lookup(request.host));
+      }
+      catch (...) {
+        request.promise->set_exception(std::current_exception());
+        success = false;
+      }
+      lock.lock();
+      // Start the entry's time to live now that the lookup has finished
+      auto it = this->cache.find(request.host);
+      if (it != this->cache.end())
+        it->second.expires = std::chrono::steady_clock::now() +
+          (success ? this->ttl : this->negative_ttl);
+    }
+  }
+}
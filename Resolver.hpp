@@ -0,0 +1,138 @@
+/**
+ * @file      Resolver.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Resolver` object.
+ */
+
+#ifndef _CFNETWORKRESOLVER_H
+#define _CFNETWORKRESOLVER_H
+
+#include <chrono>              // for milliseconds, seconds, steady_clock
+#include <condition_variable>  // for condition_variable
+#include <deque>               // for deque
+#include <future>              // for promise, shared_future
+#include <memory>              // for shared_ptr
+#include <mutex>               // for mutex
+#include <string>              // for string
+#include <sys/socket.h>        // for sockaddr_storage
+#include <thread>              // for thread
+#include <unordered_map>       // for unordered_map
+#include <vector>              // for vector
+#include "CFNetwork.hpp"       // for Connection
+
+namespace CFNetwork {
+  /**
+   * @class Resolver
+   * An asynchronous, caching host name resolver.
+   *
+   * The `Resolver` object resolves host names to all of their IPv4 and IPv6
+   * addresses using `getaddrinfo(3)` on a small pool of worker threads, so
+   * that the caller never blocks on a lookup unless it chooses to wait for the
+   * result. Results are cached for a configurable time to live, failed lookups
+   * are cached (for a separate, usually shorter, time to live), and concurrent
+   * requests for the same host name share a single lookup.
+   *
+   * Numeric addresses are parsed on the calling thread and are never cached.
+   *
+   * The `Resolver` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class Resolver {
+    private:
+      Resolver(const Resolver&);
+      Resolver& operator= (const Resolver&);
+
+    public:
+      /**
+       * @typedef Addresses
+       * The addresses that a host name resolved to, in order of preference.
+       */
+      typedef std::vector<struct sockaddr_storage> Addresses;
+
+    protected:
+      /**
+       * @struct Entry
+       * A cached (or in-flight) lookup and the time that it expires.
+       */
+      struct Entry {
+        std::shared_future<Addresses>         result;
+        std::chrono::steady_clock::time_point expires;
+      };
+
+      /**
+       * @struct Request
+       * A lookup waiting for a worker thread.
+       */
+      struct Request {
+        std::string                              host;
+        std::shared_ptr<std::promise<Addresses>> promise;
+      };
+
+      /**
+       * @var cache
+       * Maps each host name to its cached (or in-flight) lookup.
+       */
+      std::unordered_map<std::string, Entry> cache;
+      /**
+       * @var mutex
+       * Guards every member that is shared with the worker threads.
+       */
+      std::mutex                             mutex;
+      /**
+       * @var negative_ttl
+       * How long a failed lookup is cached.
+       */
+      std::chrono::steady_clock::duration    negative_ttl;
+      /**
+       * @var prune_at
+       * The cache size at which expired entries are next pruned.
+       */
+      size_t                                 prune_at = 64;
+      /**
+       * @var queue
+       * The lookups waiting for a worker thread.
+       */
+      std::deque<Request>                    queue;
+      /**
+       * @var ready
+       * Signals the worker threads when a lookup is queued.
+       */
+      std::condition_variable                ready;
+      /**
+       * @var stopping
+       * Whether or not the worker threads should exit.
+       */
+      bool                                   stopping = false;
+      /**
+       * @var ttl
+       * How long a successful lookup is cached.
+       */
+      std::chrono::steady_clock::duration    ttl;
+      /**
+       * @var workers
+       * The threads that perform lookups.
+       */
+      std::vector<std::thread>               workers;
+
+      static Addresses lookup(const std::string& host);
+      void             prune(std::chrono::steady_clock::time_point now);
+      void             work();
+
+    public:
+      Resolver(size_t threads = 2, std::chrono::steady_clock::duration ttl =
+        std::chrono::seconds{60}, std::chrono::steady_clock::duration
+        negative_ttl = std::chrono::seconds{5});
+     ~Resolver();
+      void                          clear();
+      std::shared_ptr<Connection>   connect(const std::string& host, int port,
+                                      std::chrono::milliseconds timeout,
+                                      std::chrono::milliseconds
+                                      attempt_delay =
+                                      std::chrono::milliseconds{250});
+      std::shared_future<Addresses> resolve(const std::string& host);
+  };
+}
+
+#endif
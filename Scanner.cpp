@@ -0,0 +1,170 @@
+/**
+ * @file      Scanner.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the delimiter scanning helper functions.
+ */
+
+#include <cstring>        // for memchr, memcmp
+#include <string>         // for string
+#include "Scanner.hpp"    // for ScannerKind
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>    // for _mm_*, _mm256_*
+#define CFNETWORK_SCANNER_X86
+#endif
+
+namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  namespace {
+    typedef size_t (*ScanFunction)(const char*, size_t, const char*, size_t);
+
+    // Finds a delimiter using `memchr` to locate candidates for its first byte
+    size_t scanScalar(const char* data, size_t length, const char* delim,
+        size_t delim_length) {
+      if (delim_length > length) return std::string::npos;
+      const char* end = data + (length - delim_length) + 1;
+      for (const char* p = data; p < end; ++p) {
+        p = static_cast<const char*>(memchr(p, delim[0],
+          static_cast<size_t>(end - p)));
+        if (p == nullptr) break;
+        if (memcmp(p + 1, delim + 1, delim_length - 1) == 0)
+          return static_cast<size_t>(p - data);
+      }
+      return std::string::npos;
+    }
+
+    #ifdef CFNETWORK_SCANNER_X86
+    // Each vector implementation compares one block against the first byte of
+    // the delimiter and an overlapping block against its last byte. Positions
+    // matching both are candidates whose middle bytes are then verified, which
+    // filters nearly all false positives for multi-byte delimiters.
+    __attribute__((target("sse2")))
+    size_t scanSSE2(const char* data, size_t length, const char* delim,
+        size_t delim_length) {
+      const __m128i first = _mm_set1_epi8(delim[0]);
+      const __m128i last  = _mm_set1_epi8(delim[delim_length - 1]);
+      size_t i = 0;
+      for (; i + delim_length - 1 + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+          data + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+          data + i + delim_length - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+          _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        for (; mask != 0; mask &= mask - 1) {
+          size_t offset = i + static_cast<size_t>(__builtin_ctz(mask));
+          if (delim_length <= 2 ||
+              memcmp(data + offset + 1, delim + 1, delim_length - 2) == 0)
+            return offset;
+        }
+      }
+      size_t rest = scanScalar(data + i, length - i, delim, delim_length);
+      return rest == std::string::npos ? rest : i + rest;
+    }
+
+    __attribute__((target("avx2")))
+    size_t scanAVX2(const char* data, size_t length, const char* delim,
+        size_t delim_length) {
+      if (delim_length == 1) {
+        // Single-byte delimiters only need one comparison per block, and two
+        // blocks are tested per iteration to amortize the branch
+        const __m256i byte = _mm256_set1_epi8(delim[0]);
+        size_t i = 0;
+        for (; i + 64 <= length; i += 64) {
+          __m256i a = _mm256_cmpeq_epi8(byte, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i)));
+          __m256i b = _mm256_cmpeq_epi8(byte, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i + 32)));
+          if (_mm256_testz_si256(_mm256_or_si256(a, b),
+              _mm256_or_si256(a, b)))
+            continue;
+          unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(a));
+          if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+          mask = static_cast<unsigned>(_mm256_movemask_epi8(b));
+          return i + 32 + static_cast<size_t>(__builtin_ctz(mask));
+        }
+        size_t rest = scanSSE2(data + i, length - i, delim, delim_length);
+        return rest == std::string::npos ? rest : i + rest;
+      }
+      const __m256i first = _mm256_set1_epi8(delim[0]);
+      const __m256i last  = _mm256_set1_epi8(delim[delim_length - 1]);
+      size_t i = 0;
+      for (; i + delim_length - 1 + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+          data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+          data + i + delim_length - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+          _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                           _mm256_cmpeq_epi8(b, last))));
+        for (; mask != 0; mask &= mask - 1) {
+          size_t offset = i + static_cast<size_t>(__builtin_ctz(mask));
+          if (delim_length <= 2 ||
+              memcmp(data + offset + 1, delim + 1, delim_length - 2) == 0)
+            return offset;
+        }
+      }
+      size_t rest = scanSSE2(data + i, length - i, delim, delim_length);
+      return rest == std::string::npos ? rest : i + rest;
+    }
+    #endif
+
+    // Selects the widest implementation supported by the current processor
+    ScannerKind detectScannerKind() {
+      #ifdef CFNETWORK_SCANNER_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) return ScannerKind::AVX2;
+      if (__builtin_cpu_supports("sse2")) return ScannerKind::SSE2;
+      #endif
+      return ScannerKind::Scalar;
+    }
+
+    ScanFunction selectScanFunction() {
+      switch (getScannerKind()) {
+        #ifdef CFNETWORK_SCANNER_X86
+        case ScannerKind::AVX2: return scanAVX2;
+        case ScannerKind::SSE2: return scanSSE2;
+        #endif
+        default:                return scanScalar;
+      }
+    }
+  }
+  #endif
+
+  /**
+   * Searches the provided data for the first occurrence of a (possibly
+   * multi-byte) delimiter.
+   *
+   * The search is vectorized using the widest instruction set supported by
+   * the current processor, which is detected once at runtime.
+   *
+   * @see    `getScannerKind()` for the selected implementation.
+   *
+   * @param  data         A pointer to the data to search
+   * @param  length       The number of bytes to search
+   * @param  delim        A pointer to the delimiter
+   * @param  delim_length The length of the delimiter (must be non-zero)
+   *
+   * @return              The offset of the first byte of the delimiter, or
+   *                      `std::string::npos` if it wasn't found.
+   */
+  size_t findDelimiter(const char* data, size_t length, const char* delim,
+      size_t delim_length) {
+    static const ScanFunction scan = selectScanFunction();
+    if (delim_length == 0 || delim_length > length) return std::string::npos;
+    return scan(data, length, delim, delim_length);
+  }
+
+  /**
+   * Fetches the implementation selected by `findDelimiter()` for the current
+   * processor.
+   *
+   * @return `ScannerKind` value describing the implementation.
+   */
+  ScannerKind getScannerKind() {
+    static const ScannerKind kind = detectScannerKind();
+    return kind;
+  }
+}
@@ -0,0 +1,43 @@
+/**
+ * @file      Scanner.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Forward declaration of the delimiter scanning helper functions.
+ */
+
+#ifndef _CFNETWORKSCANNER_H
+#define _CFNETWORKSCANNER_H
+
+#include <cstddef>  // for size_t
+
+namespace CFNetwork {
+  /**
+   * @enum ScannerKind
+   * The `ScannerKind` enum describes which implementation `findDelimiter()`
+   * dispatches to on the current processor.
+   */
+  enum class ScannerKind {
+    /**
+     * @var Scalar
+     * A portable implementation without explicit vectorization.
+     */
+    Scalar,
+    /**
+     * @var SSE2
+     * A 16-byte wide implementation using SSE2 instructions.
+     */
+    SSE2,
+    /**
+     * @var AVX2
+     * A 32-byte wide implementation using AVX2 instructions.
+     */
+    AVX2
+  };
+
+  size_t      findDelimiter(const char* data, size_t length, const char* delim,
+                size_t delim_length);
+  ScannerKind getScannerKind();
+}
+
+#endif
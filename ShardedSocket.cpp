@@ -0,0 +1,167 @@
+/**
+ * @file      ShardedSocket.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `ShardedSocket` object.
+ */
+
+#include <memory>             // for shared_ptr, unique_ptr
+#include <pthread.h>          // for pthread_setaffinity_np
+#include <sched.h>            // for cpu_set_t, sched_getaffinity, CPU_SET, ...
+#include <string>             // for string
+#include <sys/socket.h>       // for setsockopt, SOL_SOCKET, SO_INCOMING_CPU
+#include <thread>             // for thread
+#include <utility>            // for move
+#include <vector>             // for vector
+#include "CFNetwork.hpp"      // for InvalidArgument, UnexpectedError
+#include "Connection.hpp"     // for Connection
+#include "EventLoop.hpp"      // for EventLoop
+#include "ShardedSocket.hpp"  // for ShardedSocket
+#include "Socket.hpp"         // for Socket
+
+namespace CFNetwork {
+  /**
+   * `ShardedSocket` Constructor.
+   *
+   * Constructs a `ShardedSocket` object given a listening address/port and
+   * opens `count` listeners on it. Worker threads aren't started until
+   * `start()` is called, although the kernel begins queueing clients for each
+   * listener immediately.
+   *
+   * Shards are assigned round-robin to the processors that the calling thread
+   * is allowed to run on. If `count` is zero, one shard is opened for each of
+   * those processors.
+   *
+   * @throws `InvalidArgument` if the port or address is invalid.
+   * @throws `UnexpectedError` if any listener couldn't be opened.
+   *
+   * @param  addr    `std::string` object containing the listen address
+   * @param  port    `int` containing the port number to listen on
+   * @param  count   The number of listeners (and worker threads) to open
+   * @param  backlog The maximum number of pending clients held by the kernel
+   *                 for each listener
+   */
+  ShardedSocket::ShardedSocket(const std::string& addr, int port, size_t count,
+      int backlog) {
+    // Collect the processors available to this process
+    std::vector<int> cpus{};
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    if (count == 0) count = cpus.empty() ? 1 : cpus.size();
+    for (size_t i = 0; i < count; ++i) {
+      std::unique_ptr<Shard> shard{new Shard{}};
+      shard->socket.reset(new Socket{addr, port, backlog, true});
+      shard->loop.reset(new EventLoop{});
+      if (!cpus.empty()) {
+        // Prefer this listener for clients handled on the shard's processor
+        shard->cpu = cpus[i % cpus.size()];
+        setsockopt(shard->socket->getDescriptor(), SOL_SOCKET,
+          SO_INCOMING_CPU, &shard->cpu, sizeof(int));
+      }
+      this->shards.push_back(std::move(shard));
+    }
+  }
+
+  /**
+   * `ShardedSocket` Destructor.
+   *
+   * Upon destruction of a `ShardedSocket` object, stop and join its worker
+   * threads before closing each listener.
+   */
+  ShardedSocket::~ShardedSocket() {
+    this->stop();
+  }
+
+  /**
+   * Fetches the number of listeners held by the `ShardedSocket`.
+   *
+   * @return The number of shards.
+   */
+  size_t ShardedSocket::getCount() const {
+    return this->shards.size();
+  }
+
+  /**
+   * Fetches the processor that a shard's worker thread is pinned to.
+   *
+   * @throws `InvalidArgument` if `index` is out of range.
+   *
+   * @param  index The index of the shard
+   *
+   * @return       The processor number, or `-1` if the shard isn't pinned.
+   */
+  int ShardedSocket::getCPU(size_t index) const {
+    if (index >= this->shards.size())
+      throw InvalidArgument{"The provided shard index is out of range."};
+    return this->shards[index]->cpu;
+  }
+
+  /**
+   * Fetches the listening `Socket` of a shard.
+   *
+   * @throws `InvalidArgument` if `index` is out of range.
+   *
+   * @param  index The index of the shard
+   *
+   * @return       The `Socket` associated with the shard.
+   */
+  Socket& ShardedSocket::getSocket(size_t index) {
+    if (index >= this->shards.size())
+      throw InvalidArgument{"The provided shard index is out of range."};
+    return *this->shards[index]->socket;
+  }
+
+  /**
+   * Starts one worker thread per shard.
+   *
+   * Each worker pins itself to its shard's processor, registers the shard's
+   * listener with its own `EventLoop`, and dispatches events until `stop()` is
+   * called. `accepted` is invoked on the worker thread for every client.
+   *
+   * @throws `UnexpectedError` if the `ShardedSocket` was already started.
+   *
+   * @param  accepted The callback to invoke with each accepted `Connection`
+   */
+  void ShardedSocket::start(AcceptHandler accepted) {
+    if (this->running.exchange(true))
+      throw UnexpectedError{"The sharded socket was already started."};
+    for (auto& shard : this->shards) {
+      Shard* current = shard.get();
+      current->thread = std::thread{[this, current, accepted]() {
+        if (current->cpu >= 0) {
+          cpu_set_t set;
+          CPU_ZERO(&set);
+          CPU_SET(current->cpu, &set);
+          pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+        EventLoop& loop = *current->loop;
+        loop.add(*current->socket,
+            [&loop, &accepted](std::shared_ptr<Connection> client) {
+          accepted(loop, std::move(client));
+        });
+        // Poll directly rather than using `run()` so that a `stop()` issued
+        // before this thread starts polling isn't lost
+        while (this->running)
+          loop.poll();
+      }};
+    }
+  }
+
+  /**
+   * Stops every worker thread and waits for them to return.
+   *
+   * This method must not be called from a worker thread.
+   */
+  void ShardedSocket::stop() {
+    this->running = false;
+    for (auto& shard : this->shards) {
+      shard->loop->stop();
+      if (shard->thread.joinable())
+        shard->thread.join();
+    }
+  }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file      ShardedSocket.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `ShardedSocket` object.
+ */
+
+#ifndef _CFNETWORKSHARDEDSOCKET_H
+#define _CFNETWORKSHARDEDSOCKET_H
+
+#include <atomic>          // for atomic
+#include <functional>      // for function
+#include <memory>          // for shared_ptr, unique_ptr
+#include <string>          // for string
+#include <sys/socket.h>    // for SOMAXCONN
+#include <thread>          // for thread
+#include <vector>          // for vector
+#include "CFNetwork.hpp"   // for Connection, EventLoop, Socket
+
+namespace CFNetwork {
+  /**
+   * @class ShardedSocket
+   * A group of `SO_REUSEPORT` listeners that accept clients on many threads.
+   *
+   * The `ShardedSocket` object opens one `Socket` per shard on the same address
+   * and port. Each shard is served by its own worker thread and `EventLoop`,
+   * and the worker thread is pinned to a single processor. Every listener also
+   * asks the kernel (using `SO_INCOMING_CPU`) to prefer it for clients whose
+   * traffic is processed on that same processor, so accepted connections stay
+   * local to one processor for their lifetime.
+   *
+   * Each accepted `Connection` is passed to the handler together with the
+   * `EventLoop` of the shard that accepted it; the `Connection` should be
+   * registered with that loop (and only that loop) since loops are not shared
+   * between threads.
+   *
+   * The `ShardedSocket` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class ShardedSocket {
+    private:
+      ShardedSocket(const ShardedSocket&);
+      ShardedSocket& operator= (const ShardedSocket&);
+
+    public:
+      /**
+       * @typedef AcceptHandler
+       * Callback invoked on a worker thread with each accepted `Connection`
+       * and the `EventLoop` of the shard that accepted it.
+       */
+      typedef std::function<void(EventLoop&, std::shared_ptr<Connection>)>
+        AcceptHandler;
+
+    protected:
+      /**
+       * @struct Shard
+       * A single listener along with the loop and thread that serve it.
+       */
+      struct Shard {
+        int                        cpu = -1;
+        std::unique_ptr<EventLoop> loop;
+        std::unique_ptr<Socket>    socket;
+        std::thread                thread;
+      };
+
+      /**
+       * @var running
+       * Whether or not the worker threads should continue polling for events.
+       */
+      std::atomic<bool>                   running{false};
+      /**
+       * @var shards
+       * Holds every listener of a `ShardedSocket`.
+       */
+      std::vector<std::unique_ptr<Shard>> shards;
+
+    public:
+      ShardedSocket(const std::string& addr, int port, size_t count = 0,
+        int backlog = SOMAXCONN);
+     ~ShardedSocket();
+      size_t  getCount()                        const;
+      int     getCPU(size_t index)              const;
+      Socket& getSocket(size_t index);
+      void    start(AcceptHandler accepted);
+      void    stop();
+  };
+}
+
+#endif
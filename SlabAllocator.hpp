@@ -0,0 +1,232 @@
+/**
+ * @file      SlabAllocator.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `SlabAllocator` object.
+ */
+
+#ifndef _CFNETWORKSLABALLOCATOR_H
+#define _CFNETWORKSLABALLOCATOR_H
+
+#include <cstddef>  // for size_t, max_align_t
+#include <memory>   // for allocator
+#include <new>      // for operator new, operator delete
+
+namespace CFNetwork {
+  /**
+   * @var SLAB_CACHE_LIMIT
+   * The maximum number of free blocks of each size retained by each thread.
+   */
+  const size_t SLAB_CACHE_LIMIT = 1024;
+
+  /**
+   * @class SlabCache
+   * A per-thread cache of free memory blocks of a single size.
+   *
+   * Blocks released by a thread are kept on that thread's free list (up to
+   * `SLAB_CACHE_LIMIT` blocks) and handed out again by its next allocation of
+   * the same size, so steady-state allocation never reaches the global heap or
+   * contends on its locks. Blocks may be released on a different thread than
+   * the one that allocated them since each block is an independent heap
+   * allocation. A thread's cached blocks are returned to the heap when the
+   * thread exits.
+   */
+  template <size_t Size>
+  class SlabCache {
+    protected:
+      /**
+       * @struct Block
+       * The header written into each free block to link the free list.
+       */
+      struct Block {
+        Block* next;
+      };
+
+      /**
+       * @struct Reaper
+       * Returns the thread's cached blocks to the heap when the thread exits.
+       */
+      struct Reaper {
+        ~Reaper() {
+          SlabCache::closed = true;
+          while (SlabCache::head != nullptr) {
+            Block* block    = SlabCache::head;
+            SlabCache::head = block->next;
+            ::operator delete(block);
+          }
+          SlabCache::count = 0;
+        }
+      };
+
+      /**
+       * @var block_size
+       * The size of each block (which must be able to hold a `Block`).
+       */
+      static constexpr size_t block_size =
+        Size < sizeof(Block) ? sizeof(Block) : Size;
+
+      // The free list is kept in trivially destructible storage so that blocks
+      // released after the `Reaper` has run can still detect it
+      static thread_local bool   closed;
+      static thread_local size_t count;
+      static thread_local Block* head;
+      static thread_local Reaper reaper;
+
+    public:
+      /**
+       * Fetches a block from the thread's free list (or the heap when empty).
+       *
+       * @return A pointer to an uninitialized block of `Size` bytes.
+       */
+      static void* acquire() {
+        if (head != nullptr) {
+          Block* block = head;
+          head = block->next;
+          --count;
+          return block;
+        }
+        return ::operator new(block_size);
+      }
+
+      /**
+       * Returns a block to the thread's free list (or the heap when full).
+       *
+       * @param pointer A block previously returned by `acquire()`
+       */
+      static void release(void* pointer) noexcept {
+        if (closed || count >= SLAB_CACHE_LIMIT) {
+          ::operator delete(pointer);
+          return;
+        }
+        // Ensure that the cache is emptied when the thread exits
+        (void)&reaper;
+        Block* block = static_cast<Block*>(pointer);
+        block->next  = head;
+        head         = block;
+        ++count;
+      }
+  };
+
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  template <size_t Size>
+  thread_local bool SlabCache<Size>::closed = false;
+  template <size_t Size>
+  thread_local size_t SlabCache<Size>::count = 0;
+  template <size_t Size>
+  thread_local typename SlabCache<Size>::Block* SlabCache<Size>::head = nullptr;
+  template <size_t Size>
+  thread_local typename SlabCache<Size>::Reaper SlabCache<Size>::reaper;
+  #endif
+
+  /**
+   * @class SlabPool
+   * Recycles allocations whose size is only known at runtime.
+   *
+   * Each request is rounded up to a power of two between 64 and 4096 bytes
+   * and served by the `SlabCache` for that size, while larger requests fall
+   * back to the heap. This suits objects (such as coroutine frames) whose size
+   * is chosen by the compiler rather than by a type.
+   */
+  class SlabPool {
+    public:
+      /**
+       * Allocates a block of at least `size` bytes.
+       *
+       * @param  size The number of bytes required
+       *
+       * @return A pointer to an uninitialized block.
+       */
+      static void* acquire(size_t size) {
+        if (size <= 64)   return SlabCache<64>::acquire();
+        if (size <= 128)  return SlabCache<128>::acquire();
+        if (size <= 256)  return SlabCache<256>::acquire();
+        if (size <= 512)  return SlabCache<512>::acquire();
+        if (size <= 1024) return SlabCache<1024>::acquire();
+        if (size <= 2048) return SlabCache<2048>::acquire();
+        if (size <= 4096) return SlabCache<4096>::acquire();
+        return ::operator new(size);
+      }
+
+      /**
+       * Releases a block previously returned by `acquire()`.
+       *
+       * @param pointer The block to release
+       * @param size    The size that the block was requested with
+       */
+      static void release(void* pointer, size_t size) noexcept {
+        if      (size <= 64)   SlabCache<64>::release(pointer);
+        else if (size <= 128)  SlabCache<128>::release(pointer);
+        else if (size <= 256)  SlabCache<256>::release(pointer);
+        else if (size <= 512)  SlabCache<512>::release(pointer);
+        else if (size <= 1024) SlabCache<1024>::release(pointer);
+        else if (size <= 2048) SlabCache<2048>::release(pointer);
+        else if (size <= 4096) SlabCache<4096>::release(pointer);
+        else ::operator delete(pointer);
+      }
+  };
+
+  /**
+   * @class SlabAllocator
+   * A standard allocator that recycles single-object allocations.
+   *
+   * Allocations of a single object are served by the `SlabCache` for the
+   * object's size, while array allocations and over-aligned types fall back to
+   * `std::allocator`. The allocator is stateless, so any two instances compare
+   * equal and memory may be released through any of them.
+   *
+   * The allocator is intended for use with `std::allocate_shared()`, which then
+   * places an object and its reference count in a single recycled block:
+   *
+   *     std::allocate_shared<Connection>(SlabAllocator<Connection>{}, ...);
+   */
+  template <typename T>
+  class SlabAllocator {
+    public:
+      typedef T value_type;
+
+      SlabAllocator() noexcept = default;
+      template <typename U>
+      SlabAllocator(const SlabAllocator<U>&) noexcept {}
+
+      /**
+       * Allocates storage for `n` objects of type `T`.
+       *
+       * @param  n The number of objects
+       *
+       * @return   A pointer to uninitialized storage.
+       */
+      T* allocate(size_t n) {
+        if (n == 1 && alignof(T) <= alignof(std::max_align_t))
+          return static_cast<T*>(SlabCache<sizeof(T)>::acquire());
+        return std::allocator<T>{}.allocate(n);
+      }
+
+      /**
+       * Releases storage previously returned by `allocate()`.
+       *
+       * @param pointer The storage to release
+       * @param n       The number of objects that the storage was allocated for
+       */
+      void deallocate(T* pointer, size_t n) noexcept {
+        if (n == 1 && alignof(T) <= alignof(std::max_align_t))
+          SlabCache<sizeof(T)>::release(pointer);
+        else
+          std::allocator<T>{}.deallocate(pointer, n);
+      }
+  };
+
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  template <typename T, typename U>
+  bool operator== (const SlabAllocator<T>&, const SlabAllocator<U>&) noexcept {
+    return true;
+  }
+
+  template <typename T, typename U>
+  bool operator!= (const SlabAllocator<T>&, const SlabAllocator<U>&) noexcept {
+    return false;
+  }
+  #endif
+}
+
+#endif
@@ -6,36 +6,79 @@
  * Implementation source for the `Socket` object.
  */
 
-#include <arpa/inet.h>     // for inet_ntop
-#include <memory>          // for shared_ptr
-#include <netinet/in.h>    // for INET_ADDRSTRLEN, INET6_ADDRSTRLEN, sockadd...
-#include <string>          // for allocator, operator+, basic_string
-#include <sys/errno.h>     // for EBADF, errno
-#include <sys/fcntl.h>     // for fcntl, F_GETFD
-#include <sys/socket.h>    // for sockaddr_storage, AF_INET, AF_INET6, accep...
-#include <unistd.h>        // for close
-#include "CFNetwork.hpp"   // for SocketFamily, UnexpectedError, SocketFamil...
-#include "Connection.hpp"  // for Connection
-#include "Socket.hpp"      // for Socket
+#include <arpa/inet.h>        // for inet_ntop
+#include <memory>             // for allocate_shared, shared_ptr
+#include <netinet/in.h>       // for INET_ADDRSTRLEN, INET6_ADDRSTRLEN, so...
+#include <string>             // for allocator, operator+, basic_string
+#include <sys/errno.h>        // for EADDRINUSE, EAGAIN, ECONNABORTED, ...
+#include <sys/socket.h>       // for sockaddr_storage, accept4, SOCK_CLOEX...
+#include <unistd.h>           // for close, unlink
+#include <utility>            // for move
+#include <vector>             // for vector
+#include "Awaiter.hpp"        // for AcceptAwaiter
+#include "CFNetwork.hpp"      // for SocketFamily, UnexpectedError, ...
+#include "Connection.hpp"     // for Connection
+#include "IOUring.hpp"        // for IOUring
+#include "Metrics.hpp"        // for SocketMetrics
+#include "Probes.hpp"         // for CFNETWORK_PROBE
+#include "SlabAllocator.hpp"  // for SlabAllocator
+#include "Socket.hpp"         // for Socket
 
 namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  namespace {
+    // Determines whether a local socket name is held by a socket file that
+    // no longer has a listener (such as one left behind by a crashed process)
+    bool isStale(const struct sockaddr_storage& address, socklen_t length) {
+      int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (probe < 0) return false;
+      bool stale = ::connect(probe, reinterpret_cast<const struct sockaddr*>(
+        &address), length) < 0 && errno == ECONNREFUSED;
+      close(probe);
+      return stale;
+    }
+  }
+  #endif
+
   /**
    * `Socket` Constructor.
    *
    * Constructs a `Socket` object given a listening address/port and begins
    * listening for clients.
    *
-   * @param addr `std::string` object containing the listen address
-   * @param port `int` containing the port number to listen on
+   * If `reuse_port` is `true`, the `SO_REUSEPORT` option is set before binding
+   * so that several `Socket` objects (usually one per thread) can listen on the
+   * same address and port, allowing the kernel to balance incoming clients
+   * between them.
+   *
+   * The address may also be a local socket name (see `parseAddress()`), such
+   * as `/run/app.sock` or `@app` for the abstract namespace, in which case the
+   * port is ignored (and reported as zero). A socket file left behind by a
+   * listener that no longer exists is replaced, and the socket file is
+   * removed once the `Socket` is destroyed.
+   *
+   * @see    `ShardedSocket` for a group of `SO_REUSEPORT` listeners.
+   *
+   * @throws `InvalidArgument` if the port or address is invalid, or if port
+   *         reuse is requested for a local socket name.
+   * @throws `UnexpectedError` if the socket couldn't be created, bound or
+   *         placed in listening mode.
+   *
+   * @param  addr       `std::string` object containing the listen address
+   * @param  port       `int` containing the port number to listen on
+   * @param  backlog    The maximum number of pending clients held by the kernel
+   * @param  reuse_port Whether or not other sockets may bind to the same
+   *                    address and port
    */
-  Socket::Socket(const std::string& addr, int port) {
-    // Ensure the validity of the provided port
-    if (port < 1 || port > 65535)
-      throw InvalidArgument{"The provided port number is out of range."};
+  Socket::Socket(const std::string& addr, int port, int backlog,
+      bool reuse_port) {
     // Fetch a finalized sockaddr_storage for the given address
     struct sockaddr_storage address  = parseAddress(addr);
     // Use the appropriate setup helper depending on the address family
     if (address.ss_family == AF_INET || address.ss_family == AF_INET6) {
+      // Ensure the validity of the provided port
+      if (port < 1 || port > 65535)
+        throw InvalidArgument{"The provided port number is out of range."};
       // Assign the appropriate address family to describe the `Connection`
       this->family = (address.ss_family == AF_INET ?
         SocketFamily::IPv4 : SocketFamily::IPv6);
@@ -49,6 +92,15 @@ namespace CFNetwork {
       // Assign the port to the sockaddr struct
       *(this->family == SocketFamily::IPv4 ? port4(address) : port6(address)) =
         htons(this->port = port);
+      this->address = address;
+    }
+    else if (address.ss_family == AF_UNIX) {
+      // Only one listener may hold a local socket name
+      if (reuse_port)
+        throw InvalidArgument{"Local socket names can't be reused."};
+      this->family  = SocketFamily::Unix;
+      this->host    = formatAddress(address);
+      this->address = address;
     }
     else {
       // Remote address has an unexpected address family
@@ -57,20 +109,40 @@ namespace CFNetwork {
     }
     // Setup the socket using the appropriate address family and type
     this->socket = ::socket(address.ss_family, SOCK_STREAM, 0);
-    // Attempt to bind the socket to the listening address
-    if (bind(this->socket, addr_(address), this->family == SocketFamily::IPv4 ?
-        sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6)) < 0) {
+    if (this->socket < 0)
+      throw UnexpectedError{"Couldn't create a socket for [" + this->host +
+        "]:" + std::to_string(this->port)};
+    // Allow reusing the address (and optionally the port); these options only
+    // take effect if they are set before binding
+    int reuse = 1;
+    setsockopt(this->socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
+    if (reuse_port && setsockopt(this->socket, SOL_SOCKET, SO_REUSEPORT,
+        &reuse, sizeof(int)) < 0) {
+      close(this->socket);
+      throw UnexpectedError{"Couldn't enable port reuse for [" + this->host +
+        "]:" + std::to_string(this->port)};
+    }
+    // Attempt to bind the socket to the listening address, replacing a stale
+    // socket file that holds the requested local socket name
+    socklen_t length = addressLength(address);
+    int bound = bind(this->socket, addr_(address), length);
+    if (bound < 0 && errno == EADDRINUSE && this->family ==
+        SocketFamily::Unix && this->host[0] != '@' && isStale(address, length)
+        && unlink(this->host.c_str()) == 0)
+      bound = bind(this->socket, addr_(address), length);
+    if (bound < 0) {
       // A problem occurred, close the socket and throw an exception
       close(this->socket);
       throw UnexpectedError{"Couldn't bind to [" + this->host + "]:" +
         std::to_string(this->port)};
     }
-    else {
-      // Allow reusing the socket
-      int reuse = 1;
-      setsockopt(this->socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
-      // Listen with a backlog of 16 clients
-      listen(this->socket, 16);
+    // Listen with the requested backlog of clients
+    if (listen(this->socket, backlog) < 0) {
+      close(this->socket);
+      if (this->family == SocketFamily::Unix && this->host[0] != '@')
+        unlink(this->host.c_str());
+      throw UnexpectedError{"Couldn't listen on [" + this->host + "]:" +
+        std::to_string(this->port)};
     }
   }
 
@@ -78,58 +150,181 @@ namespace CFNetwork {
    * `Socket` Destructor.
    *
    * Upon destruction of a `Socket` object, close its associated file
-   * descriptor.
+   * descriptor (and remove its socket file, if any).
+   *
+   * If the cancellation of an outstanding `IOUring` request can't be
+   * submitted right away, it remains queued in the `IOUring` and is submitted
+   * along with its next request.
    */
   Socket::~Socket() {
-    if (this->valid())
+    if (this->ring) try {
+      this->ring->cancel(this->ring_token);
+    }
+    catch (const UnexpectedError&) {}
+    if (this->valid()) {
       close(this->socket);
+      if (this->family == SocketFamily::Unix && this->host[0] != '@')
+        unlink(this->host.c_str());
+    }
   }
 
   /**
    * Accepts an incoming client and creates a `Connection` object for it.
    *
-   * This method blocks execution until a client is accepted.
+   * This method blocks execution until a client is accepted. If the `Socket`
+   * was placed in non-blocking mode and no client is pending, an empty
+   * `std::shared_ptr` is returned instead.
+   *
+   * If an `IOUring` is attached to the `Socket`, clients are collected from a
+   * multishot accept request instead of calling `accept4(2)`.
+   *
+   * @see    `setBlocking()` for more information regarding non-blocking mode.
+   * @see    `setRing()`     for more information regarding the `IOUring`
+   *                         backend.
+   *
+   * @throws `UnexpectedError` if the `Socket` is invalid or the client couldn't
+   *         be accepted.
    *
    * @return `Connection` object representing the accepted client.
    */
   std::shared_ptr<Connection> Socket::accept() const {
-    // Create storage to accept and capture the client's remote address
-    std::string raddress{};
+    return this->acceptClient(this->blocking, SOCK_CLOEXEC);
+  }
+
+  /**
+   * Accepts every pending client, up to a limit, in a single call.
+   *
+   * Each accepted `Connection` is appended to `clients` and is already in
+   * non-blocking mode (as required by an `EventLoop`), so no further system
+   * calls are needed to prepare it.
+   *
+   * In blocking mode, this method waits for the first client and returns it
+   * alone since the kernel can't be asked whether more clients are pending
+   * without blocking again.
+   *
+   * @throws `UnexpectedError` if the `Socket` is invalid or a client couldn't
+   *         be accepted.
+   *
+   * @param  clients The container to append the accepted clients to
+   * @param  max     The maximum number of clients to accept
+   *
+   * @return         The number of clients that were accepted.
+   */
+  size_t Socket::accept(std::vector<std::shared_ptr<Connection>>& clients,
+      size_t max) const {
+    size_t count = 0;
+    while (count < max) {
+      std::shared_ptr<Connection> client = this->acceptClient(
+        count == 0 && this->blocking, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (!client) break;
+      clients.push_back(std::move(client));
+      ++count;
+      // A blocking listener can't be drained without waiting for more clients
+      if (this->blocking && !this->ring) break;
+    }
+    return count;
+  }
+
+  /**
+   * Accepts an incoming client from a coroutine without blocking its thread.
+   *
+   * The `Socket` is placed in non-blocking mode. Awaiting the result suspends
+   * the coroutine until a client is accepted, and the `EventLoop` resumes it
+   * with the client (already in non-blocking mode):
+   *
+   *     std::shared_ptr<Connection> client = co_await socket.acceptAsync(loop);
+   *
+   * @see    `Awaiter` for more information regarding awaitable operations.
+   *
+   * @throws `InvalidArgument` if an `IOUring` is attached to the `Socket`.
+   *
+   * @param  loop The `EventLoop` that resumes the awaiting coroutine
+   *
+   * @return `AcceptAwaiter` producing the accepted `Connection`.
+   */
+  AcceptAwaiter Socket::acceptAsync(EventLoop& loop) {
+    if (this->ring)
+      throw InvalidArgument{"Clients can't be awaited alongside a ring."};
+    if (this->blocking) this->setBlocking(false);
+    return AcceptAwaiter{loop, *this};
+  }
+
+  /**
+   * Accepts a single client using the provided `accept4(2)` flags.
+   *
+   * The `Connection` is constructed directly from the raw addresses reported
+   * by the kernel so that no address is formatted or parsed unless requested,
+   * and is allocated using a `SlabAllocator` so that clients accepted after
+   * others have closed reuse their memory.
+   *
+   * @throws `UnexpectedError` if the `Socket` is invalid or the client couldn't
+   *         be accepted.
+   *
+   * @param  wait  Whether or not to wait for a client when using an `IOUring`
+   * @param  flags The flags to pass to `accept4(2)`
+   *
+   * @return `Connection` object representing the accepted client, or an empty
+   *         `std::shared_ptr` if no client is pending.
+   */
+  std::shared_ptr<Connection> Socket::acceptClient(bool wait, int flags) const {
+    // Create storage to capture the client's remote address
     struct sockaddr_storage cli_addr = {};
-    socklen_t cli_addr_len = sizeof(struct sockaddr);
+    socklen_t cli_addr_len = sizeof(struct sockaddr_storage);
     int cli_fd = -1;
 
-    // Check if the Socket is valid
-    if (this->valid()) {
-      // Accept an incoming client
-      cli_fd = ::accept(this->socket, (struct sockaddr*)&cli_addr,
-        &cli_addr_len);
-      // Store a text-based representation of the remote address
-      if (cli_addr.ss_family == AF_INET || cli_addr.ss_family == AF_INET6) {
-        // Determine the appropriate pointer type for the remote address
-        auto addrPtr = (cli_addr.ss_family == AF_INET ?
-          addr4(cli_addr) : addr6(cli_addr));
-        // Assign the resulting address to the raddress string
-        char addressString[INET6_ADDRSTRLEN + 1] = {};
-        raddress = inet_ntop(cli_addr.ss_family, addrPtr, addressString,
-          INET6_ADDRSTRLEN);
+    // Cannot accept a client on an invalid Socket
+    if (this->socket < 0)
+      throw UnexpectedError{"Couldn't accept client on [" + this->host +
+        "]:" + std::to_string(this->port) + " - Invalid socket"};
+    if (this->ring) {
+      // Arm a multishot accept request if one isn't already outstanding
+      if (!this->ring_armed) {
+        this->ring->prepareAccept(this->socket, this->ring_token);
+        this->ring_armed = true;
       }
-      // If cli_fd is negative, an error occurred
-      if (cli_fd < 0) {
-        throw UnexpectedError{"Couldn't accept client on [" + this->host +
-          "]:" + std::to_string(this->port) + " - Invalid client file "
-          "descriptor"};
+      // Claim the next accepted client (if any) from the ring
+      IOUring::Completion completion = {};
+      if (wait)
+        completion = this->ring->wait(this->ring_token);
+      else if (!this->ring->poll(this->ring_token, completion))
+        return std::shared_ptr<Connection>{};
+      if (!(completion.flags & IORING_CQE_F_MORE))
+        this->ring_armed = false;
+      // Multishot accept doesn't report the peer, so ask for it explicitly
+      if ((cli_fd = completion.result) >= 0) {
+        getpeername(cli_fd, addr_(cli_addr), &cli_addr_len);
+        // The ring's accept request is shared by every caller, so it always
+        // produces blocking descriptors
+        if (flags & SOCK_NONBLOCK) CFNetwork::setBlocking(cli_fd, false);
       }
     }
     else {
-      // Cannot accept a client on an invalid Socket
+      // Accept an incoming client (retrying if interrupted by a signal or if
+      // the client disconnected before it could be accepted)
+      do {
+        cli_fd = accept4(this->socket, addr_(cli_addr), &cli_addr_len, flags);
+        if (cli_fd < 0 && errno == ECONNABORTED)
+          this->metrics.countAcceptError();
+      } while (cli_fd < 0 && (errno == EINTR || errno == ECONNABORTED));
+      // A non-blocking `Socket` without any pending clients has nothing to do
+      if (cli_fd < 0 && !this->blocking &&
+          (errno == EAGAIN || errno == EWOULDBLOCK))
+        return std::shared_ptr<Connection>{};
+    }
+    // If cli_fd is negative, an error occurred
+    if (cli_fd < 0) {
+      this->metrics.countAcceptError();
       throw UnexpectedError{"Couldn't accept client on [" + this->host +
-        "]:" + std::to_string(this->port) + " - Invalid socket"};
+        "]:" + std::to_string(this->port) + " - Invalid client file "
+        "descriptor"};
     }
-    // Return a shared_ptr to the newly created Connection object
-    return std::shared_ptr<Connection>{
-      new Connection{this->host, raddress, this->port, cli_fd}
-    };
+    this->metrics.countAccept();
+    CFNETWORK_PROBE(accept, this->socket, cli_fd);
+    // Return a shared_ptr to the newly created Connection object, placing it
+    // and its reference count in a single recycled block
+    return std::allocate_shared<Connection>(SlabAllocator<Connection>{},
+      this->address, cli_addr, this->port, cli_fd,
+      (flags & SOCK_NONBLOCK) == 0);
   }
 
   /**
@@ -158,8 +353,9 @@ namespace CFNetwork {
   /**
    * Fetches the listening address of the associated `Socket`.
    *
-   * This method can produce a `std::string` of either an IPv4 address or an
-   * IPv6 address. This method will not produce hostnames.
+   * This method can produce a `std::string` of either an IPv4 address, an
+   * IPv6 address or a local socket name. This method will not produce
+   * hostnames.
    *
    * @return `std::string` of the listening address.
    */
@@ -167,6 +363,17 @@ namespace CFNetwork {
     return this->host;
   }
 
+  /**
+   * Fetches the metrics of the `Socket` instance.
+   *
+   * @see    `Metrics::snapshot()` for the combined metrics of every `Socket`.
+   *
+   * @return `SocketMetrics` of the `Socket`.
+   */
+  const SocketMetrics& Socket::getMetrics() const {
+    return this->metrics;
+  }
+
   /**
    * Fetches the port of the `Socket` instance.
    *
@@ -179,19 +386,66 @@ namespace CFNetwork {
   }
 
   /**
-   * Determines if the file descriptor is considered valid for read, write, or
-   * any other operations.
+   * Fetches the transport type of the `Socket` instance.
    *
-   * A file descriptor is considered invalid if a call requesting its flags
-   * fails with the return value of `-1` or `errno` is set to `EBADF` (the
-   * provided argument is not an open file descriptor). If neither case is
-   * satisfied, the file descriptor is considered valid.
+   * @see    `SocketType` for more information on transport types.
+   *
+   * @return `SocketType::TCP`
+   */
+  SocketType Socket::getType() const {
+    return SocketType::TCP;
+  }
+
+  /**
+   * Determines whether or not the `Socket` blocks while waiting for clients.
+   *
+   * @return `true` if the `Socket` is in blocking mode, `false` otherwise.
+   */
+  bool Socket::isBlocking() const {
+    return this->blocking;
+  }
+
+  /**
+   * Toggles blocking mode for the `Socket`.
+   *
+   * A non-blocking `Socket` returns immediately from `accept()` when no client
+   * is pending, allowing many sockets to be multiplexed on a single thread by
+   * an `EventLoop`.
+   *
+   * @param blocking Whether or not the `Socket` should block
+   */
+  void Socket::setBlocking(bool blocking) {
+    CFNetwork::setBlocking(this->socket, blocking);
+    this->blocking = blocking;
+  }
+
+  /**
+   * Attaches an `IOUring` execution backend to the `Socket`.
+   *
+   * Once attached, `accept()` collects clients from a multishot accept request
+   * armed in the ring rather than calling `accept(2)` for every client.
+   * Passing an empty `std::shared_ptr` detaches the current ring (cancelling
+   * any outstanding request) and restores the plain system call path.
+   *
+   * @param ring The `IOUring` to attach (or `nullptr` to detach)
+   */
+  void Socket::setRing(std::shared_ptr<IOUring> ring) {
+    if (this->ring) this->ring->cancel(this->ring_token);
+    this->ring       = std::move(ring);
+    this->ring_armed = false;
+    this->ring_token = this->ring ? this->ring->allocateToken() : 0;
+  }
+
+  /**
+   * Determines if the file descriptor is considered valid for accepting
+   * clients or any other operations.
    *
-   * @see    `fcntl(2)` for more information regarding this procedure's test.
+   * The `Socket` owns its file descriptor from construction until destruction,
+   * so this test doesn't require a system call.
    *
    * @return `true` if the file descriptor is valid, `false` otherwise.
    */
   bool Socket::valid() const {
-    return (fcntl(this->socket, F_GETFD) != -1 || errno != EBADF);
+    return this->socket >= 0;
   }
 }
@@ -9,9 +9,15 @@
 #ifndef _CFNETWORKSOCKET_H
 #define _CFNETWORKSOCKET_H
 
+#include <cstdint>        // for uint64_t
 #include <memory>         // for shared_ptr
 #include <string>         // for string
-#include "CFNetwork.hpp"  // for SocketFamily
+#include <sys/socket.h>   // for sockaddr_storage, SOMAXCONN
+#include <vector>         // for vector
+#include "Awaiter.hpp"    // for AcceptAwaiter
+#include "CFNetwork.hpp"  // for SocketFamily, SocketType
+#include "IOUring.hpp"    // for IOUring
+#include "Metrics.hpp"    // for SocketMetrics
 
 namespace CFNetwork {
   /**
@@ -28,37 +34,81 @@ namespace CFNetwork {
     private:
       Socket(const Socket&);
       Socket& operator= (const Socket&);
+      friend class AcceptAwaiter;
 
     protected:
+      /**
+       * @var address
+       * Holds the raw listening address associated with a `Socket`.
+       */
+      struct sockaddr_storage address = {};
+      /**
+       * @var blocking
+       * Whether or not the file descriptor of a `Socket` blocks when no clients
+       * are pending.
+       */
+      bool         blocking = true;
       /**
        * @var family
        * Used to describe the socket family type of a `Socket`.
        */
-      SocketFamily family = SocketFamily::IPv4;
+      SocketFamily family   = SocketFamily::IPv4;
       /**
        * @var host
        * Holds the listening address associated with a `Socket`.
        */
-      std::string  host   = "0.0.0.0";
+      std::string  host     = "0.0.0.0";
+      /**
+       * @var metrics
+       * The counters describing the clients accepted by a `Socket`.
+       */
+      mutable SocketMetrics metrics;
       /**
        * @var port
        * Holds the listening port associated with a `Socket`.
        */
-      int          port   =  0;
+      int          port     =  0;
+      /**
+       * @var ring
+       * The optional `IOUring` used to accept clients on a `Socket`.
+       */
+      std::shared_ptr<IOUring> ring;
+      /**
+       * @var ring_armed
+       * Whether or not a multishot accept request is armed in the `ring`.
+       */
+      mutable bool ring_armed = false;
+      /**
+       * @var ring_token
+       * Identifies the requests of a `Socket` in its `ring`.
+       */
+      uint64_t     ring_token = 0;
       /**
        * @var socket
        * Holds the file descriptor associated with a `Socket`.
        */
-      int          socket = -1;
+      int          socket   = -1;
+
+      std::shared_ptr<Connection> acceptClient(bool wait, int flags) const;
 
     public:
-      Socket(const std::string& addr, int port);
+      Socket(const std::string& addr, int port, int backlog = SOMAXCONN,
+        bool reuse_port = false);
      ~Socket();
       std::shared_ptr<Connection> accept()        const;
+      size_t                      accept(std::vector<std::shared_ptr<
+                                    Connection>>& clients,
+                                    size_t max = 64)  const;
+      AcceptAwaiter               acceptAsync(EventLoop& loop);
       int                         getDescriptor() const;
       SocketFamily                getFamily()     const;
       const std::string&          getHost()       const;
+      const SocketMetrics&        getMetrics()    const;
       int                         getPort()       const;
+      SocketType                  getType()       const;
+      bool                        isBlocking()    const;
+      void                        setBlocking(bool blocking);
+      void                        setRing(std::shared_ptr<IOUring> ring);
       bool                        valid()         const;
   };
 }
@@ -0,0 +1,334 @@
+/**
+ * @file      TLSTransport.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `TLSTransport` object.
+ */
+
+#include <climits>           // for INT_MAX
+#include <cstring>           // for memcpy
+#include <memory>            // for shared_ptr
+#include <openssl/bio.h>     // for BIO_get_ktls_recv, BIO_get_ktls_send
+#include <openssl/err.h>     // for ERR_clear_error, ERR_error_string_n, ...
+#include <openssl/ssl.h>     // for SSL_read, SSL_write, SSL_sendfile, ...
+#include <string>            // for string
+#include <sys/errno.h>       // for EAGAIN, ECONNRESET, EPROTO, errno
+#include <sys/types.h>       // for off_t, ssize_t
+#include <sys/uio.h>         // for iovec
+#include <unistd.h>          // for pread
+#include <utility>           // for move
+#include "CFNetwork.hpp"     // for InvalidArgument, UnexpectedError
+#include "TLSTransport.hpp"  // for TLSTransport, TLSRole
+
+namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  namespace {
+    // The largest plaintext carried by a single TLS record
+    const size_t TLS_RECORD_BYTES = 16384;
+
+    // Describes (and clears) the most recent OpenSSL error
+    std::string describeError() {
+      char description[256] = {};
+      unsigned long error = ERR_peek_last_error();
+      if (error != 0)
+        ERR_error_string_n(error, description, sizeof(description));
+      ERR_clear_error();
+      return error != 0 ? description : "unknown error";
+    }
+
+    // Creates a context that requests kernel TLS offload
+    std::shared_ptr<SSL_CTX> createContext(const SSL_METHOD* method) {
+      std::shared_ptr<SSL_CTX> context{SSL_CTX_new(method), SSL_CTX_free};
+      if (!context)
+        throw UnexpectedError{"Couldn't create a TLS context: " +
+          describeError()};
+      SSL_CTX_set_min_proto_version(context.get(), TLS1_2_VERSION);
+      SSL_CTX_set_options(context.get(), SSL_OP_ENABLE_KTLS);
+      return context;
+    }
+  }
+  #endif
+
+  /**
+   * `TLSTransport` Constructor.
+   *
+   * Constructs a `TLSTransport` object that performs the given side of the
+   * handshake using the provided context. The handshake itself begins once
+   * the `TLSTransport` is attached to a `Connection`.
+   *
+   * @throws `InvalidArgument` if the context is empty.
+   * @throws `UnexpectedError` if the session couldn't be created.
+   *
+   * @param  context  The configuration to create the session from
+   * @param  role     The side of the handshake to perform
+   * @param  hostname The name of the server (clients only) used for SNI and
+   *                  certificate verification
+   */
+  TLSTransport::TLSTransport(std::shared_ptr<SSL_CTX> context, TLSRole role,
+      const std::string& hostname) {
+    if (!context)
+      throw InvalidArgument{"The provided TLS context is empty."};
+    this->ssl = SSL_new(context.get());
+    if (this->ssl == nullptr)
+      throw UnexpectedError{"Couldn't create a TLS session: " +
+        describeError()};
+    this->context  = std::move(context);
+    this->hostname = hostname;
+    this->role     = role;
+    // Allow writes to be retried from a different (but equivalent) buffer
+    SSL_set_mode(this->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE |
+      SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (role == TLSRole::Client && !hostname.empty()) {
+      SSL_set_tlsext_host_name(this->ssl, hostname.c_str());
+      SSL_set1_host(this->ssl, hostname.c_str());
+    }
+  }
+
+  /**
+   * `TLSTransport` Destructor.
+   *
+   * Upon destruction of a `TLSTransport` object, release its session. No
+   * closure alert is sent since the file descriptor may already be closed.
+   */
+  TLSTransport::~TLSTransport() {
+    SSL_free(this->ssl);
+  }
+
+  /**
+   * Associates the `TLSTransport` with the file descriptor of a `Connection`.
+   *
+   * @throws `UnexpectedError` if the file descriptor couldn't be attached.
+   *
+   * @param  socket The file descriptor to read from and write to
+   */
+  void TLSTransport::attach(int socket) {
+    if (SSL_set_fd(this->ssl, socket) != 1)
+      throw UnexpectedError{"Couldn't attach a TLS session: " +
+        describeError()};
+    if (this->role == TLSRole::Client)
+      SSL_set_connect_state(this->ssl);
+    else
+      SSL_set_accept_state(this->ssl);
+  }
+
+  /**
+   * Creates a context suitable for client `TLSTransport` objects.
+   *
+   * The context verifies the server's certificate against the provided
+   * certificate authorities (or the system's default authorities if no file
+   * is provided) and requests kernel TLS offload.
+   *
+   * @throws `UnexpectedError` if the context couldn't be created.
+   *
+   * @param  ca_file The certificate authorities (PEM) to trust
+   * @param  verify  Whether or not the server's certificate is verified
+   *
+   * @return `std::shared_ptr` owning the context.
+   */
+  std::shared_ptr<SSL_CTX> TLSTransport::createClientContext(
+      const std::string& ca_file, bool verify) {
+    std::shared_ptr<SSL_CTX> context = createContext(TLS_client_method());
+    if (verify) {
+      int loaded = ca_file.empty() ?
+        SSL_CTX_set_default_verify_paths(context.get()) :
+        SSL_CTX_load_verify_locations(context.get(), ca_file.c_str(), nullptr);
+      if (loaded != 1)
+        throw UnexpectedError{"Couldn't load the certificate authorities: " +
+          describeError()};
+    }
+    SSL_CTX_set_verify(context.get(), verify ? SSL_VERIFY_PEER :
+      SSL_VERIFY_NONE, nullptr);
+    return context;
+  }
+
+  /**
+   * Creates a context suitable for server `TLSTransport` objects.
+   *
+   * The context presents the provided certificate and requests kernel TLS
+   * offload.
+   *
+   * @throws `UnexpectedError` if the context couldn't be created or the
+   *         certificate or key couldn't be loaded.
+   *
+   * @param  certificate_file The certificate chain (PEM) to present
+   * @param  key_file         The private key (PEM) of the certificate
+   *
+   * @return `std::shared_ptr` owning the context.
+   */
+  std::shared_ptr<SSL_CTX> TLSTransport::createServerContext(
+      const std::string& certificate_file, const std::string& key_file) {
+    std::shared_ptr<SSL_CTX> context = createContext(TLS_server_method());
+    if (SSL_CTX_use_certificate_chain_file(context.get(),
+          certificate_file.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(context.get(), key_file.c_str(),
+          SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(context.get()) != 1)
+      throw UnexpectedError{"Couldn't load the certificate or key: " +
+        describeError()};
+    return context;
+  }
+
+  /**
+   * Fetches the name of the negotiated cipher suite.
+   *
+   * @return `std::string` naming the cipher, or an empty `std::string` if the
+   *         handshake hasn't completed.
+   */
+  std::string TLSTransport::getCipher() const {
+    const char* name = SSL_get_cipher_name(this->ssl);
+    return name != nullptr && SSL_is_init_finished(this->ssl) ? name : "";
+  }
+
+  /**
+   * Fetches the OpenSSL session of the `TLSTransport` instance.
+   *
+   * The session can be used to perform more advanced actions (such as
+   * inspecting the peer's certificate) that this class doesn't accommodate
+   * for.
+   *
+   * @return `SSL*` of the session.
+   */
+  SSL* TLSTransport::getSession() const {
+    return this->ssl;
+  }
+
+  /**
+   * Advances the TLS handshake.
+   *
+   * A blocking file descriptor completes the handshake before returning. The
+   * handshake is also advanced implicitly by `receive()` and `send()`.
+   *
+   * @throws `UnexpectedError` if the handshake failed.
+   *
+   * @return `true` once the handshake is complete, `false` if it would block.
+   */
+  bool TLSTransport::handshake() {
+    int value = SSL_do_handshake(this->ssl);
+    if (value == 1) return true;
+    int error = SSL_get_error(this->ssl, value);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+      return false;
+    throw UnexpectedError{"TLS handshake failed: " + describeError()};
+  }
+
+  /**
+   * Determines whether or not the kernel decrypts received records.
+   *
+   * @return `true` if kernel TLS offload is active for receiving.
+   */
+  bool TLSTransport::isKernelReceive() const {
+    return BIO_get_ktls_recv(SSL_get_rbio(this->ssl));
+  }
+
+  /**
+   * Determines whether or not the kernel encrypts sent records.
+   *
+   * @return `true` if kernel TLS offload is active for sending.
+   */
+  bool TLSTransport::isKernelSend() const {
+    return BIO_get_ktls_send(SSL_get_wbio(this->ssl));
+  }
+
+  /**
+   * Receives decrypted data in the manner of `read(2)`.
+   *
+   * @param  data   The storage to receive data into
+   * @param  length The size of the storage
+   *
+   * @return The number of bytes received, zero once the peer sent its
+   *         closure alert, or a negative value on error.
+   */
+  ssize_t TLSTransport::receive(char* data, size_t length) {
+    return this->result(SSL_read(this->ssl, data,
+      static_cast<int>(length < INT_MAX ? length : INT_MAX)));
+  }
+
+  /**
+   * Translates the return value of an OpenSSL I/O function into the
+   * conventions of a system call.
+   *
+   * @param  value The value returned by OpenSSL
+   *
+   * @return `value` if it was positive, zero at the end of the stream, or -1
+   *         with `errno` describing the error (`EAGAIN` if the operation
+   *         would block).
+   */
+  ssize_t TLSTransport::result(int value) {
+    if (value > 0) return value;
+    int error = errno;
+    switch (SSL_get_error(this->ssl, value)) {
+      case SSL_ERROR_ZERO_RETURN:
+        return 0;
+      case SSL_ERROR_WANT_READ:
+      case SSL_ERROR_WANT_WRITE:
+        error = EAGAIN;
+        break;
+      case SSL_ERROR_SYSCALL:
+        // OpenSSL reports an abrupt closure without setting `errno`
+        if (error == 0) error = ECONNRESET;
+        break;
+      default:
+        error = EPROTO;
+        break;
+    }
+    ERR_clear_error();
+    errno = error;
+    return -1;
+  }
+
+  /**
+   * Encrypts and sends data in the manner of `writev(2)`.
+   *
+   * Small segments are gathered into a single record before encryption so
+   * that many small messages don't each cost a record.
+   *
+   * @param  iov   The segments to send
+   * @param  count The number of segments
+   *
+   * @return The number of bytes sent, or a negative value on error.
+   */
+  ssize_t TLSTransport::send(const struct iovec* iov, int count) {
+    if (count <= 0) return 0;
+    if (count == 1 || iov[0].iov_len >= TLS_RECORD_BYTES)
+      return this->result(SSL_write(this->ssl, iov[0].iov_base,
+        static_cast<int>(iov[0].iov_len < INT_MAX ? iov[0].iov_len : INT_MAX)));
+    char record[TLS_RECORD_BYTES];
+    size_t length = 0;
+    for (int i = 0; i < count && length < TLS_RECORD_BYTES; ++i) {
+      size_t chunk = TLS_RECORD_BYTES - length < iov[i].iov_len ?
+        TLS_RECORD_BYTES - length : iov[i].iov_len;
+      memcpy(record + length, iov[i].iov_base, chunk);
+      length += chunk;
+    }
+    return this->result(SSL_write(this->ssl, record, static_cast<int>(length)));
+  }
+
+  /**
+   * Sends part of a file in the manner of `sendfile(2)`.
+   *
+   * If kernel TLS offload is active for sending, the file is encrypted and
+   * sent by the kernel using `SSL_sendfile()`. Otherwise a chunk of the file is
+   * read and encrypted in user space.
+   *
+   * @param  descriptor The file to send
+   * @param  offset     The offset of the first byte to send
+   * @param  length     The number of bytes to send
+   *
+   * @return The number of bytes sent, zero at the end of the file, or a
+   *         negative value on error.
+   */
+  ssize_t TLSTransport::sendFile(int descriptor, off_t offset, size_t length) {
+    if (this->isKernelSend()) {
+      ossl_ssize_t sent = SSL_sendfile(this->ssl, descriptor, offset, length,
+        0);
+      return sent >= 0 ? sent : this->result(-1);
+    }
+    char chunk[TLS_RECORD_BYTES];
+    ssize_t available = pread(descriptor, chunk, length < TLS_RECORD_BYTES ?
+      length : TLS_RECORD_BYTES, offset);
+    if (available <= 0) return available;
+    return this->result(SSL_write(this->ssl, chunk,
+      static_cast<int>(available)));
+  }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file      TLSTransport.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `TLSTransport` object.
+ */
+
+#ifndef _CFNETWORKTLSTRANSPORT_H
+#define _CFNETWORKTLSTRANSPORT_H
+
+#include <cstddef>         // for size_t
+#include <memory>          // for shared_ptr
+#include <openssl/ssl.h>   // for SSL, SSL_CTX
+#include <string>          // for string
+#include <sys/types.h>     // for off_t, ssize_t
+#include <sys/uio.h>       // for iovec
+#include "CFNetwork.hpp"   // for TLSTransport
+#include "Transport.hpp"   // for Transport
+
+namespace CFNetwork {
+  /**
+   * @enum TLSRole
+   * The `TLSRole` enum describes which side of the handshake a `TLSTransport`
+   * performs.
+   */
+  enum class TLSRole {
+    /**
+     * @var Client
+     * The `TLSTransport` initiates the handshake.
+     */
+    Client,
+    /**
+     * @var Server
+     * The `TLSTransport` responds to the handshake.
+     */
+    Server
+  };
+
+  /**
+   * @class TLSTransport
+   * A `Transport` that encrypts a `Connection` using TLS (via OpenSSL).
+   *
+   * Contexts created by `createClientContext()` and `createServerContext()`
+   * request kernel TLS offload. When the kernel and the negotiated cipher
+   * support it, OpenSSL installs the `tls` upper layer protocol on the socket
+   * once the handshake completes, after which records are encrypted (and
+   * possibly decrypted) by the kernel: `sendFile()` then uses `SSL_sendfile()`
+   * so that file data never enters user space, and `Connection::pipeTo()` can
+   * splice through the socket. Without kernel support every record is handled
+   * by OpenSSL in user space, and `sendFile()` reads the file in chunks.
+   *
+   * The `TLSTransport` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class TLSTransport : public Transport {
+    private:
+      TLSTransport(const TLSTransport&);
+      TLSTransport& operator= (const TLSTransport&);
+
+    protected:
+      /**
+       * @var context
+       * The shared configuration that `ssl` was created from.
+       */
+      std::shared_ptr<SSL_CTX> context;
+      /**
+       * @var hostname
+       * The name of the server that a client `TLSTransport` verifies and
+       * requests using SNI.
+       */
+      std::string              hostname;
+      /**
+       * @var role
+       * The side of the handshake that the `TLSTransport` performs.
+       */
+      TLSRole                  role = TLSRole::Client;
+      /**
+       * @var ssl
+       * The OpenSSL session associated with the `TLSTransport`.
+       */
+      SSL*                     ssl  = nullptr;
+
+      ssize_t                  result(int value);
+
+    public:
+      TLSTransport(std::shared_ptr<SSL_CTX> context, TLSRole role,
+        const std::string& hostname = "");
+     ~TLSTransport();
+      static std::shared_ptr<SSL_CTX> createClientContext(
+        const std::string& ca_file = "", bool verify = true);
+      static std::shared_ptr<SSL_CTX> createServerContext(
+        const std::string& certificate_file, const std::string& key_file);
+      void                     attach(int socket)                  override;
+      std::string              getCipher()                         const;
+      SSL*                     getSession()                        const;
+      bool                     handshake()                         override;
+      bool                     isKernelReceive()             const override;
+      bool                     isKernelSend()                const override;
+      ssize_t                  receive(char* data, size_t length)  override;
+      ssize_t                  send(const struct iovec* iov, int count)
+                                 override;
+      ssize_t                  sendFile(int descriptor, off_t offset,
+                                 size_t length)                    override;
+  };
+}
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * @file      Task.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Task` object.
+ */
+
+#ifndef _CFNETWORKTASK_H
+#define _CFNETWORKTASK_H
+
+#include <coroutine>          // for coroutine_handle, suspend_always, ...
+#include <cstddef>            // for size_t
+#include <exception>          // for exception_ptr, rethrow_exception, ...
+#include <optional>           // for optional
+#include <utility>            // for exchange, move
+#include "CFNetwork.hpp"      // for Task
+#include "SlabAllocator.hpp"  // for SlabPool
+
+namespace CFNetwork {
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  /**
+   * @class TaskPromiseBase
+   * The parts of a `Task`'s promise that don't depend on its result type.
+   */
+  class TaskPromiseBase {
+    public:
+      /**
+       * @struct FinalAwaiter
+       * Resumes the awaiting coroutine (if any) once a `Task` finishes, or
+       * releases the frame of a detached `Task`.
+       */
+      struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<Promise> handle) noexcept {
+          TaskPromiseBase& promise = handle.promise();
+          if (promise.detached) {
+            handle.destroy();
+            return std::noop_coroutine();
+          }
+          return promise.continuation ?
+            promise.continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+      };
+
+      /**
+       * @var continuation
+       * The coroutine awaiting the result of the `Task`.
+       */
+      std::coroutine_handle<> continuation;
+      /**
+       * @var detached
+       * Whether or not the `Task` owns its own frame.
+       */
+      bool                    detached = false;
+      /**
+       * @var error
+       * The exception that escaped the `Task` (if any).
+       */
+      std::exception_ptr      error;
+
+      static void* operator new(size_t size) {
+        return SlabPool::acquire(size);
+      }
+      static void operator delete(void* pointer, size_t size) noexcept {
+        SlabPool::release(pointer, size);
+      }
+
+      std::suspend_always initial_suspend() const noexcept { return {}; }
+      FinalAwaiter        final_suspend()   const noexcept { return {}; }
+      void unhandled_exception() noexcept {
+        // Nobody is left to observe the exception of a detached `Task`
+        if (this->detached) std::terminate();
+        this->error = std::current_exception();
+      }
+  };
+
+  /**
+   * @class TaskPromise
+   * The promise of a `Task` producing a value of type `T`.
+   */
+  template <typename T>
+  class TaskPromise : public TaskPromiseBase {
+    public:
+      std::optional<T> value;
+
+      Task<T> get_return_object() noexcept;
+      void    return_value(T value) {
+        this->value.emplace(std::move(value));
+      }
+      T       result() {
+        if (this->error) std::rethrow_exception(this->error);
+        return std::move(*this->value);
+      }
+  };
+
+  /**
+   * @class TaskPromise
+   * The promise of a `Task` that doesn't produce a value.
+   */
+  template <>
+  class TaskPromise<void> : public TaskPromiseBase {
+    public:
+      Task<void> get_return_object() noexcept;
+      void       return_void() const noexcept {}
+      void       result() {
+        if (this->error) std::rethrow_exception(this->error);
+      }
+  };
+  #endif
+
+  /**
+   * @class Task
+   * A lazily started coroutine producing a value of type `T`.
+   *
+   * A function returning `Task` may use `co_await` (for example on the
+   * awaitables returned by `Socket::acceptAsync()` and
+   * `Connection::readDelimAsync()`) to wait for an `EventLoop` without
+   * blocking its thread, which allows sequential code to be written for
+   * thousands of concurrent connections:
+   *
+   *     Task<> serve(EventLoop& loop, std::shared_ptr<Connection> client) {
+   *       while (true) {
+   *         std::string line = co_await client->readDelimAsync(loop);
+   *         co_await client->writeAsync(loop, line, false);
+   *       }
+   *     }
+   *
+   * A `Task` doesn't run until it is awaited by another coroutine (which is
+   * then resumed with its result) or detached using `detach()`. Coroutine
+   * frames are allocated from a `SlabPool`, so steady-state use doesn't reach
+   * the global heap.
+   *
+   * The `Task` object is not copyable since it owns its coroutine frame.
+   */
+  template <typename T = void>
+  class Task {
+    private:
+      Task(const Task&);
+      Task& operator= (const Task&);
+
+    public:
+      typedef TaskPromise<T> promise_type;
+
+    protected:
+      /**
+       * @var handle
+       * The coroutine frame owned by the `Task`.
+       */
+      std::coroutine_handle<promise_type> handle;
+
+    public:
+      /**
+       * @struct Awaitable
+       * Starts the `Task` when awaited, and resumes the awaiting coroutine
+       * with its result once it finishes.
+       */
+      struct Awaitable {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() const noexcept {
+          return !this->handle || this->handle.done();
+        }
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<> awaiting) noexcept {
+          this->handle.promise().continuation = awaiting;
+          return this->handle;
+        }
+        T await_resume() {
+          return this->handle.promise().result();
+        }
+      };
+
+      /**
+       * `Task` Constructor.
+       *
+       * @param handle The coroutine frame to take ownership of
+       */
+      explicit Task(std::coroutine_handle<promise_type> handle) noexcept :
+        handle(handle) {}
+
+      /**
+       * `Task` move Constructor.
+       *
+       * @param other The `Task` to take ownership of the frame from
+       */
+      Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+      /**
+       * `Task` Destructor.
+       *
+       * Destroys the coroutine frame (if it is still owned by the `Task`).
+       */
+     ~Task() {
+        if (this->handle) this->handle.destroy();
+      }
+
+      /**
+       * Starts the `Task` without waiting for its result.
+       *
+       * The `Task` runs until its first suspension point and then owns its
+       * own frame, which is released when it finishes. An exception escaping
+       * a detached `Task` terminates the program (as it would a `std::thread`),
+       * so a detached `Task` should handle its own errors.
+       */
+      void detach() {
+        std::coroutine_handle<promise_type> handle =
+          std::exchange(this->handle, {});
+        if (!handle) return;
+        handle.promise().detached = true;
+        handle.resume();
+      }
+
+      /**
+       * Determines whether or not the `Task` has finished.
+       *
+       * @return `true` if the `Task` has finished, `false` otherwise.
+       */
+      bool done() const {
+        return !this->handle || this->handle.done();
+      }
+
+      /**
+       * Awaits the result of the `Task`.
+       *
+       * @return An awaitable that produces the result of the `Task` (or
+       *         rethrows the exception that escaped it).
+       */
+      Awaitable operator co_await() && noexcept {
+        return Awaitable{this->handle};
+      }
+  };
+
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  template <typename T>
+  Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+  }
+
+  inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>{
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+  }
+  #endif
+}
+
+#endif
@@ -0,0 +1,349 @@
+/**
+ * @file      TimerWheel.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `TimerWheel` object.
+ */
+
+#include <chrono>          // for ceil, milliseconds, steady_clock
+#include <climits>         // for INT_MAX
+#include <cstddef>         // for size_t
+#include <cstdint>         // for uint32_t, uint64_t
+#include <utility>         // for exchange, move
+#include "CFNetwork.hpp"   // for InvalidArgument, UnexpectedError
+#include "TimerWheel.hpp"  // for TimerWheel
+
+namespace CFNetwork {
+  /**
+   * `TimerWheel` Constructor.
+   *
+   * Constructs an empty `TimerWheel` whose tick zero is the current time.
+   *
+   * @throws `InvalidArgument` if the resolution isn't positive.
+   *
+   * @param  resolution The duration of a single tick
+   */
+  TimerWheel::TimerWheel(std::chrono::milliseconds resolution) {
+    if (resolution.count() <= 0)
+      throw InvalidArgument{"The timer resolution is invalid."};
+    for (uint32_t& head : this->heads) head = NONE;
+    this->origin     = Clock::now();
+    this->resolution = resolution;
+  }
+
+  /**
+   * Fires every timer whose deadline has passed.
+   *
+   * Rather than visiting every elapsed tick, the wheel skips directly to the
+   * next tick with a timer to fire or redistribute, so the cost depends only on
+   * the number of timers involved (and not on how long ago this method was
+   * last called). Each timer is disarmed before its handler is invoked, so a
+   * handler may schedule or cancel any timer (including re-arming itself).
+   *
+   * Exceptions thrown by handlers are not caught by this method; the timers
+   * that remain due are fired by the next call.
+   *
+   * @param  now The current time
+   *
+   * @return The number of timers that were fired.
+   */
+  size_t TimerWheel::advance(Clock::time_point now) {
+    uint64_t target = now > this->origin ?
+      static_cast<uint64_t>((now - this->origin) / this->resolution) : 0;
+    size_t fired = 0;
+    while (this->count > 0) {
+      uint64_t tick = this->next();
+      if (tick > target) break;
+      this->current = tick;
+      fired += this->process(tick);
+    }
+    if (target > this->current) this->current = target;
+    return fired;
+  }
+
+  /**
+   * Disarms a timer before it expires.
+   *
+   * @param  timer The identifier returned by `schedule()`
+   *
+   * @return `true` if the timer was disarmed, `false` if it had already fired
+   *         (or been cancelled).
+   */
+  bool TimerWheel::cancel(uint64_t timer) {
+    uint32_t index = this->find(timer);
+    if (index == NONE) return false;
+    this->unlink(index);
+    this->timers[index].handler = nullptr;
+    this->release(index);
+    return true;
+  }
+
+  /**
+   * Converts a deadline to the first tick at (or after) it.
+   *
+   * Deadlines that already passed are moved to the next tick, which guarantees
+   * that a timer armed by a handler is never fired by the same tick.
+   *
+   * @param  deadline The point in time to convert
+   *
+   * @return The tick at which a timer with the deadline expires.
+   */
+  uint64_t TimerWheel::expiry(Clock::time_point deadline) const {
+    uint64_t tick = 0;
+    if (deadline > this->origin) {
+      Clock::duration elapsed = deadline - this->origin;
+      tick = static_cast<uint64_t>(elapsed / this->resolution) +
+        (elapsed % this->resolution != Clock::duration::zero());
+    }
+    return tick > this->current ? tick : this->current + 1;
+  }
+
+  /**
+   * Locates the storage of an armed timer.
+   *
+   * @param  timer The identifier of the timer
+   *
+   * @return The index of the timer, or `NONE` if it isn't armed.
+   */
+  uint32_t TimerWheel::find(uint64_t timer) const {
+    uint32_t index = static_cast<uint32_t>(timer);
+    if (index >= this->timers.size()) return NONE;
+    const Timer& entry = this->timers[index];
+    return (entry.slot != FREE && entry.generation == (timer >> 32)) ?
+      index : NONE;
+  }
+
+  /**
+   * Files a timer into the slot corresponding to its expiry.
+   *
+   * The wheel is chosen by the highest base-64 digit in which the expiry
+   * differs from the current tick, so the slot is always reached (and its
+   * timers redistributed) exactly when the current tick enters its range.
+   *
+   * @param index The index of the timer to file
+   */
+  void TimerWheel::link(uint32_t index) {
+    Timer&   timer = this->timers[index];
+    uint64_t diff  = timer.expires ^ this->current;
+    unsigned level = diff == 0 ? 0 :
+      static_cast<unsigned>(63 - __builtin_clzll(diff)) / BITS;
+    unsigned slot  = SPILL;
+    if (level < LEVELS) {
+      unsigned digit = static_cast<unsigned>(
+        timer.expires >> (level * BITS)) & (SLOTS - 1);
+      slot = level * SLOTS + digit;
+      this->occupied[level] |= uint64_t{1} << digit;
+    }
+    timer.slot = static_cast<uint16_t>(slot);
+    timer.prev = NONE;
+    timer.next = this->heads[slot];
+    if (timer.next != NONE) this->timers[timer.next].prev = index;
+    this->heads[slot] = index;
+  }
+
+  /**
+   * Determines the next tick at which a timer must be fired or redistributed.
+   *
+   * @return The next tick with work to do, or the maximum value if no timers
+   *         are armed.
+   */
+  uint64_t TimerWheel::next() const {
+    for (unsigned level = 0; level < LEVELS; ++level) {
+      unsigned shift = level * BITS;
+      unsigned digit = static_cast<unsigned>(
+        this->current >> shift) & (SLOTS - 1);
+      // The innermost wheel may still hold timers due at the current tick (if
+      // a handler threw), while an outer wheel's current slot is always empty
+      if (level > 0) ++digit;
+      uint64_t later = digit < SLOTS ?
+        this->occupied[level] & (~uint64_t{0} << digit) : 0;
+      // Slots of an inner wheel are always reached before those of an outer
+      // wheel, so the first occupied slot found is the earliest
+      if (later != 0)
+        return ((this->current >> (shift + BITS)) << (shift + BITS)) |
+          (static_cast<uint64_t>(__builtin_ctzll(later)) << shift);
+    }
+    if (this->heads[SPILL] != NONE)
+      return ((this->current >> (LEVELS * BITS)) + 1) << (LEVELS * BITS);
+    return static_cast<uint64_t>(-1);
+  }
+
+  /**
+   * Calculates the number of milliseconds until `advance()` has work to do.
+   *
+   * The result is suitable for use as the timeout of `epoll_wait(2)`. It may
+   * be shorter than the time until the next timer expires, since timers are
+   * occasionally redistributed between wheels before they expire.
+   *
+   * @param  now The current time
+   *
+   * @return The number of milliseconds to wait, or `-1` if no timers are
+   *         armed.
+   */
+  int TimerWheel::nextTimeout(Clock::time_point now) const {
+    if (this->count == 0) return -1;
+    uint64_t tick = this->next();
+    // Avoid overflowing the time point for a tick in the distant future
+    if (tick - this->current > static_cast<uint64_t>(
+        std::chrono::milliseconds{INT_MAX} / this->resolution))
+      return INT_MAX;
+    Clock::time_point when = this->origin +
+      this->resolution * static_cast<Clock::rep>(tick);
+    if (when <= now) return 0;
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(when - now);
+    return wait.count() < INT_MAX ? static_cast<int>(wait.count()) : INT_MAX;
+  }
+
+  /**
+   * Processes a single tick by redistributing any outer slot whose range
+   * begins at it and then firing the timers of its innermost slot.
+   *
+   * @param  tick The tick to process (which must be the current tick)
+   *
+   * @return The number of timers that were fired.
+   */
+  size_t TimerWheel::process(uint64_t tick) {
+    // Redistribute each outer slot whose range begins at this tick
+    for (unsigned level = 1; level <= LEVELS; ++level) {
+      unsigned shift = level * BITS;
+      if ((tick & ((uint64_t{1} << shift) - 1)) != 0) break;
+      unsigned digit = static_cast<unsigned>(tick >> shift) & (SLOTS - 1);
+      unsigned slot  = level < LEVELS ? level * SLOTS + digit : SPILL;
+      // Detach the whole list first since timers in the overflow list may be
+      // filed right back into it
+      uint32_t index = std::exchange(this->heads[slot], NONE);
+      if (level < LEVELS) this->occupied[level] &= ~(uint64_t{1} << digit);
+      while (index != NONE) {
+        uint32_t next = this->timers[index].next;
+        this->link(index);
+        index = next;
+      }
+    }
+    // Fire the timers that are due at this tick
+    size_t   fired = 0;
+    uint32_t& head = this->heads[tick & (SLOTS - 1)];
+    while (head != NONE) {
+      uint32_t index = head;
+      this->unlink(index);
+      Handler handler = std::move(this->timers[index].handler);
+      this->release(index);
+      ++fired;
+      handler();
+    }
+    return fired;
+  }
+
+  /**
+   * Returns the storage of a disarmed timer to the free list.
+   *
+   * The generation is advanced so that the timer's identifier is invalidated.
+   *
+   * @param index The index of the timer to release
+   */
+  void TimerWheel::release(uint32_t index) {
+    Timer& timer = this->timers[index];
+    timer.slot = FREE;
+    if (++timer.generation == 0) timer.generation = 1;
+    timer.next = this->free_list;
+    this->free_list = index;
+    --this->count;
+  }
+
+  /**
+   * Moves an armed timer to a new deadline.
+   *
+   * This is cheaper than cancelling the timer and scheduling a new one since
+   * its handler is kept in place, which makes it suitable for postponing an
+   * idle timeout whenever activity occurs.
+   *
+   * @param  timer    The identifier returned by `schedule()`
+   * @param  deadline The new point in time at which the timer should fire
+   *
+   * @return `true` if the timer was moved, `false` if it had already fired
+   *         (or been cancelled).
+   */
+  bool TimerWheel::reschedule(uint64_t timer, Clock::time_point deadline) {
+    uint32_t index = this->find(timer);
+    if (index == NONE) return false;
+    this->unlink(index);
+    this->timers[index].expires = this->expiry(deadline);
+    this->link(index);
+    return true;
+  }
+
+  /**
+   * Arms a timer that fires once the provided deadline has passed.
+   *
+   * The handler is invoked by the first call to `advance()` that observes the
+   * deadline (rounded up to the next tick), and never earlier.
+   *
+   * @throws `InvalidArgument` if the handler is empty.
+   * @throws `UnexpectedError` if too many timers are armed.
+   *
+   * @param  deadline The point in time at which the timer should fire
+   * @param  handler  The callback to invoke once the timer expires
+   *
+   * @return A non-zero identifier that can be passed to `cancel()` or
+   *         `reschedule()`.
+   */
+  uint64_t TimerWheel::schedule(Clock::time_point deadline, Handler handler) {
+    if (!handler)
+      throw InvalidArgument{"The provided handler is invalid."};
+    uint32_t index = this->free_list;
+    if (index != NONE)
+      this->free_list = this->timers[index].next;
+    else if (this->timers.size() < NONE) {
+      index = static_cast<uint32_t>(this->timers.size());
+      this->timers.emplace_back();
+    }
+    else throw UnexpectedError{"Too many timers are armed."};
+    Timer& timer  = this->timers[index];
+    timer.expires = this->expiry(deadline);
+    timer.handler = std::move(handler);
+    this->link(index);
+    ++this->count;
+    return (static_cast<uint64_t>(timer.generation) << 32) | index;
+  }
+
+  /**
+   * Arms a timer that fires once the provided delay has elapsed.
+   *
+   * @see    `schedule(Clock::time_point, Handler)` for more information.
+   *
+   * @param  delay   The amount of time to wait before firing the timer
+   * @param  handler The callback to invoke once the timer expires
+   *
+   * @return A non-zero identifier that can be passed to `cancel()` or
+   *         `reschedule()`.
+   */
+  uint64_t TimerWheel::schedule(std::chrono::milliseconds delay,
+      Handler handler) {
+    return this->schedule(Clock::now() + delay, std::move(handler));
+  }
+
+  /**
+   * Fetches the number of timers that are currently armed.
+   *
+   * @return The number of armed timers.
+   */
+  size_t TimerWheel::size() const {
+    return this->count;
+  }
+
+  /**
+   * Removes an armed timer from its slot.
+   *
+   * @param index The index of the timer to remove
+   */
+  void TimerWheel::unlink(uint32_t index) {
+    Timer& timer = this->timers[index];
+    if (timer.prev != NONE) this->timers[timer.prev].next = timer.next;
+    else this->heads[timer.slot] = timer.next;
+    if (timer.next != NONE) this->timers[timer.next].prev = timer.prev;
+    // Mark the slot as empty once its last timer was removed
+    if (timer.slot < SPILL && this->heads[timer.slot] == NONE)
+      this->occupied[timer.slot / SLOTS] &=
+        ~(uint64_t{1} << (timer.slot % SLOTS));
+  }
+}
@@ -0,0 +1,174 @@
+/**
+ * @file      TimerWheel.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `TimerWheel` object.
+ */
+
+#ifndef _CFNETWORKTIMERWHEEL_H
+#define _CFNETWORKTIMERWHEEL_H
+
+#include <chrono>         // for milliseconds, steady_clock
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint16_t, uint32_t, uint64_t
+#include <functional>     // for function
+#include <vector>         // for vector
+#include "CFNetwork.hpp"  // for TimerWheel
+
+namespace CFNetwork {
+  /**
+   * @class TimerWheel
+   * A hierarchical timing wheel that schedules callbacks in constant time.
+   *
+   * Time is divided into ticks (one millisecond by default) and each timer is
+   * filed into a slot of one of six wheels of 64 slots, chosen by the highest
+   * digit (in base 64) in which its expiry differs from the current tick. The
+   * innermost wheel holds the timers due within the current 64 ticks, and the
+   * timers of an outer slot are redistributed to the inner wheels once the
+   * current tick reaches it. Timers further than 2^36 ticks away are parked
+   * in an overflow list that is redistributed in the same way.
+   *
+   * Scheduling, rescheduling and cancelling a timer only link or unlink it
+   * from a slot, and the timers are stored in a single vector (recycled via a
+   * free list), so millions of timers can be armed without any system call
+   * or allocation per timer. A bitmap of occupied slots per wheel lets
+   * `advance()` skip directly to the next tick that has work to do.
+   *
+   * Timers are identified by a non-zero 64-bit value which combines their
+   * storage index with a generation count, so the identifier of a timer that
+   * already fired (or was cancelled) is never mistaken for a later timer.
+   *
+   * The `TimerWheel` object isn't thread safe; it is intended to be driven by
+   * the thread that runs an `EventLoop`.
+   *
+   * The `TimerWheel` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class TimerWheel {
+    private:
+      TimerWheel(const TimerWheel&);
+      TimerWheel& operator= (const TimerWheel&);
+
+    public:
+      /**
+       * @typedef Clock
+       * The monotonic clock used to express deadlines.
+       */
+      typedef std::chrono::steady_clock Clock;
+      /**
+       * @typedef Handler
+       * Callback invoked once a timer expires.
+       */
+      typedef std::function<void()>     Handler;
+
+    protected:
+      /**
+       * @var BITS
+       * The number of bits of a tick covered by each wheel.
+       */
+      static constexpr unsigned BITS     = 6;
+      /**
+       * @var LEVELS
+       * The number of wheels.
+       */
+      static constexpr unsigned LEVELS   = 6;
+      /**
+       * @var SLOTS
+       * The number of slots in each wheel.
+       */
+      static constexpr unsigned SLOTS    = 1u << BITS;
+      /**
+       * @var SPILL
+       * The slot index of the overflow list.
+       */
+      static constexpr unsigned SPILL    = LEVELS * SLOTS;
+      /**
+       * @var FREE
+       * The slot index of a `Timer` that isn't armed.
+       */
+      static constexpr uint16_t FREE     = 0xffff;
+      /**
+       * @var NONE
+       * The index used to terminate a list of `Timer` objects.
+       */
+      static constexpr uint32_t NONE     = 0xffffffff;
+
+      /**
+       * @struct Timer
+       * The storage of a timer, which doubles as a node of its slot's
+       * doubly-linked list.
+       */
+      struct Timer {
+        uint64_t expires    = 0;
+        Handler  handler;
+        uint32_t next       = NONE;
+        uint32_t prev       = NONE;
+        uint32_t generation = 1;
+        uint16_t slot       = FREE;
+      };
+
+      /**
+       * @var count
+       * The number of timers that are currently armed.
+       */
+      size_t            count     = 0;
+      /**
+       * @var current
+       * The most recent tick that was processed by `advance()`.
+       */
+      uint64_t          current   = 0;
+      /**
+       * @var free_list
+       * The index of the first unused `Timer` in `timers`.
+       */
+      uint32_t          free_list = NONE;
+      /**
+       * @var heads
+       * The index of the first `Timer` filed into each slot (followed by the
+       * overflow list).
+       */
+      uint32_t          heads[SPILL + 1];
+      /**
+       * @var occupied
+       * A bitmap of the non-empty slots of each wheel.
+       */
+      uint64_t          occupied[LEVELS] = {};
+      /**
+       * @var origin
+       * The point in time corresponding to tick zero.
+       */
+      Clock::time_point origin;
+      /**
+       * @var resolution
+       * The duration of a single tick.
+       */
+      Clock::duration   resolution;
+      /**
+       * @var timers
+       * The storage of every armed (or recycled) timer.
+       */
+      std::vector<Timer> timers;
+
+      uint64_t expiry(Clock::time_point deadline)        const;
+      uint32_t find(uint64_t timer)                      const;
+      void     link(uint32_t index);
+      uint64_t next()                                    const;
+      size_t   process(uint64_t tick);
+      void     release(uint32_t index);
+      void     unlink(uint32_t index);
+
+    public:
+      TimerWheel(std::chrono::milliseconds resolution =
+        std::chrono::milliseconds{1});
+      size_t   advance(Clock::time_point now = Clock::now());
+      bool     cancel(uint64_t timer);
+      int      nextTimeout(Clock::time_point now = Clock::now()) const;
+      bool     reschedule(uint64_t timer, Clock::time_point deadline);
+      uint64_t schedule(Clock::time_point deadline, Handler handler);
+      uint64_t schedule(std::chrono::milliseconds delay, Handler handler);
+      size_t   size()                                    const;
+  };
+}
+
+#endif
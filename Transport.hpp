@@ -0,0 +1,112 @@
+/**
+ * @file      Transport.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `Transport` interface.
+ */
+
+#ifndef _CFNETWORKTRANSPORT_H
+#define _CFNETWORKTRANSPORT_H
+
+#include <cstddef>        // for size_t
+#include <sys/types.h>    // for off_t, ssize_t
+#include <sys/uio.h>      // for iovec
+#include "CFNetwork.hpp"  // for Transport
+
+namespace CFNetwork {
+  /**
+   * @class Transport
+   * An interface for layers that transform the byte stream of a `Connection`.
+   *
+   * A `Connection` normally reads and writes its file descriptor directly.
+   * Once a `Transport` is attached using `Connection::setTransport()`, every
+   * read, write and file transfer is routed through the `Transport` instead,
+   * which allows a protocol such as TLS to sit underneath the same `read()`,
+   * `readDelim()` and `write()` API.
+   *
+   * Each operation follows the conventions of the system call that it replaces:
+   * a negative return value indicates an error described by `errno` (`EAGAIN`
+   * if the operation would block), and a `receive()` of zero bytes indicates
+   * that the remote peer finished sending.
+   *
+   * The `Transport` object is not copyable or assignable since it is expected
+   * to hold resources that do not lend themselves well to duplication.
+   */
+  class Transport {
+    private:
+      Transport(const Transport&);
+      Transport& operator= (const Transport&);
+
+    public:
+      Transport() = default;
+      virtual ~Transport() = default;
+
+      /**
+       * Associates the `Transport` with the file descriptor of a `Connection`.
+       *
+       * @param socket The file descriptor to read from and write to
+       */
+      virtual void    attach(int socket) = 0;
+
+      /**
+       * Advances any negotiation required before data can be exchanged.
+       *
+       * @return `true` once negotiation is complete, `false` if it would block.
+       */
+      virtual bool    handshake() = 0;
+
+      /**
+       * Determines whether or not data received by the file descriptor can be
+       * consumed directly (by `splice(2)`) without passing through the
+       * `Transport`.
+       *
+       * @return `true` if the file descriptor yields plain data.
+       */
+      virtual bool    isKernelReceive()                          const = 0;
+
+      /**
+       * Determines whether or not data written to the file descriptor directly
+       * (by `splice(2)`) is handled correctly without passing through the
+       * `Transport`.
+       *
+       * @return `true` if the file descriptor accepts plain data.
+       */
+      virtual bool    isKernelSend()                             const = 0;
+
+      /**
+       * Receives data in the manner of `read(2)`.
+       *
+       * @param  data   The storage to receive data into
+       * @param  length The size of the storage
+       *
+       * @return The number of bytes received, zero at the end of the stream,
+       *         or a negative value on error.
+       */
+      virtual ssize_t receive(char* data, size_t length) = 0;
+
+      /**
+       * Sends data in the manner of `writev(2)`.
+       *
+       * @param  iov   The segments to send
+       * @param  count The number of segments
+       *
+       * @return The number of bytes sent, or a negative value on error.
+       */
+      virtual ssize_t send(const struct iovec* iov, int count) = 0;
+
+      /**
+       * Sends part of a file in the manner of `sendfile(2)`.
+       *
+       * @param  descriptor The file to send
+       * @param  offset     The offset of the first byte to send
+       * @param  length     The number of bytes to send
+       *
+       * @return The number of bytes sent, zero at the end of the file, or a
+       *         negative value on error.
+       */
+      virtual ssize_t sendFile(int descriptor, off_t offset, size_t length) = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * @file      WriteQueue.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation source for the `WriteQueue` object.
+ */
+
+#include <memory>          // for shared_ptr
+#include <string>          // for string
+#include <string_view>     // for string_view
+#include <sys/uio.h>       // for iovec
+#include <utility>         // for move
+#include "CFNetwork.hpp"   // for InvalidArgument
+#include "WriteQueue.hpp"  // for WriteQueue
+
+namespace CFNetwork {
+  /**
+   * Discards the provided number of bytes from the front of the queue.
+   *
+   * Fully written segments are released and a partially written segment is
+   * adjusted to begin at the first unwritten byte.
+   *
+   * @throws `InvalidArgument` if `length` exceeds the size of the queue.
+   *
+   * @param  length The number of bytes that were written
+   */
+  void WriteQueue::advance(size_t length) {
+    if (length > this->total)
+      throw InvalidArgument{"The advanced length exceeds the write queue."};
+    this->total -= length;
+    while (length > 0) {
+      Segment& front = this->segments.front();
+      if (length < front.length) {
+        front.data   += length;
+        front.length -= length;
+        break;
+      }
+      length -= front.length;
+      this->segments.pop_front();
+    }
+  }
+
+  /**
+   * Discards every queued segment.
+   */
+  void WriteQueue::clear() {
+    this->segments.clear();
+    this->total = 0;
+  }
+
+  /**
+   * Determines whether or not any data is queued.
+   *
+   * @return `true` if the queue is empty, `false` otherwise.
+   */
+  bool WriteQueue::empty() const {
+    return this->total == 0;
+  }
+
+  /**
+   * Describes the queued segments as an `iovec` array suitable for
+   * `writev(2)` or `sendmsg(2)`.
+   *
+   * @param  iov Storage for at least `max` `iovec` structures
+   * @param  max The maximum number of segments to describe
+   *
+   * @return     The number of `iovec` structures that were filled.
+   */
+  int WriteQueue::gather(struct iovec* iov, int max) const {
+    int count = 0;
+    for (auto it = this->segments.begin();
+        it != this->segments.end() && count < max; ++it, ++count) {
+      iov[count].iov_base = const_cast<char*>(it->data);
+      iov[count].iov_len  = it->length;
+    }
+    return count;
+  }
+
+  /**
+   * Queues a `std::string`, taking ownership of its storage.
+   *
+   * @param data The data to queue
+   */
+  void WriteQueue::push(std::string&& data) {
+    if (data.empty()) return;
+    // Take ownership in place since moving a segment could move the data of a
+    // short string
+    this->segments.emplace_back();
+    Segment& segment = this->segments.back();
+    segment.owned    = std::move(data);
+    segment.data     = segment.owned.data();
+    segment.length   = segment.owned.length();
+    this->total     += segment.length;
+  }
+
+  /**
+   * Queues a shared buffer without copying it.
+   *
+   * The queue retains a reference to the buffer until it has been written,
+   * which allows the same buffer to be queued on many connections at once.
+   *
+   * @param data The data to queue
+   */
+  void WriteQueue::push(std::shared_ptr<const std::string> data) {
+    if (!data || data->empty()) return;
+    this->segments.emplace_back();
+    Segment& segment = this->segments.back();
+    segment.data     = data->data();
+    segment.length   = data->length();
+    segment.shared   = std::move(data);
+    this->total     += segment.length;
+  }
+
+  /**
+   * Queues a view of data without copying or owning it.
+   *
+   * The viewed data must remain valid until it has been written.
+   *
+   * @param data The data to queue
+   */
+  void WriteQueue::push(std::string_view data) {
+    if (data.empty()) return;
+    this->segments.emplace_back();
+    Segment& segment = this->segments.back();
+    segment.data     = data.data();
+    segment.length   = data.length();
+    this->total     += segment.length;
+  }
+
+  /**
+   * Fetches the number of bytes waiting to be written.
+   *
+   * @return The size of the queue in bytes.
+   */
+  size_t WriteQueue::size() const {
+    return this->total;
+  }
+}
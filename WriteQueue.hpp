@@ -0,0 +1,81 @@
+/**
+ * @file      WriteQueue.hpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Implementation reference for the `WriteQueue` object.
+ */
+
+#ifndef _CFNETWORKWRITEQUEUE_H
+#define _CFNETWORKWRITEQUEUE_H
+
+#include <cstddef>        // for size_t
+#include <deque>          // for deque
+#include <memory>         // for shared_ptr
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <sys/uio.h>      // for iovec
+#include "CFNetwork.hpp"  // for WriteQueue
+
+namespace CFNetwork {
+  /**
+   * @class WriteQueue
+   * An ordered queue of outbound data segments.
+   *
+   * The `WriteQueue` object holds data that has been queued for writing but not
+   * yet accepted by the kernel. Segments can own their data (a moved
+   * `std::string`), share it (a `std::shared_ptr<const std::string>` that may
+   * be queued on many connections at once), or merely reference it (a
+   * `std::string_view` whose data must outlive the segment). None of these
+   * options copy the data.
+   *
+   * The queued segments are exposed as an `iovec` array using `gather()` so
+   * that many small messages can be written with a single system call, after
+   * which `advance()` discards however many bytes the kernel accepted
+   * (including partial segments).
+   *
+   * The `WriteQueue` object is not copyable or assignable since it contains
+   * resources that do not lend themselves well to duplication.
+   */
+  class WriteQueue {
+    private:
+      WriteQueue(const WriteQueue&);
+      WriteQueue& operator= (const WriteQueue&);
+
+    protected:
+      /**
+       * @struct Segment
+       * A single queued run of bytes and (optionally) the storage backing it.
+       */
+      struct Segment {
+        const char*                        data   = nullptr;
+        size_t                             length = 0;
+        std::string                        owned;
+        std::shared_ptr<const std::string> shared;
+      };
+
+      /**
+       * @var segments
+       * The queued segments in the order that they should be written.
+       */
+      std::deque<Segment> segments;
+      /**
+       * @var total
+       * The total number of bytes held by the `segments`.
+       */
+      size_t              total = 0;
+
+    public:
+      WriteQueue() = default;
+      void   advance(size_t length);
+      void   clear();
+      bool   empty()                                        const;
+      int    gather(struct iovec* iov, int max)             const;
+      void   push(std::string&& data);
+      void   push(std::shared_ptr<const std::string> data);
+      void   push(std::string_view data);
+      size_t size()                                         const;
+  };
+}
+
+#endif
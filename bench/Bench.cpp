@@ -0,0 +1,344 @@
+/**
+ * @file      Bench.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Measures the hot paths of `Socket` and `Connection` over loopback.
+ *
+ * The suite measures the accept rate of a `Socket`, the throughput of
+ * `Connection::read()` at several request lengths, the rate at which
+ * `Connection::readDelim()` extracts lines of several lengths, the rate at
+ * which `Connection::write()` sends small messages (individually and queued in
+ * batches), and the round-trip latency of a line echoed by a peer. Each
+ * workload runs over a loopback TCP connection with the peer on its own
+ * thread, so results are comparable between revisions of the library on the
+ * same machine.
+ *
+ * A summary is printed to `stderr` while the suite runs and the results are
+ * written as JSON to `stdout` (or to the file named by `--output`). The
+ * `--scale` option multiplies the size of every workload.
+ *
+ * Usage: `Bench [--output file] [--scale factor]`
+ */
+
+#include <netinet/in.h>    // for sockaddr_in, htons, INADDR_LOOPBACK
+#include <netinet/tcp.h>   // for TCP_NODELAY
+#include <algorithm>       // for sort
+#include <chrono>          // for steady_clock, duration
+#include <cstdio>          // for fprintf, fopen, fclose, FILE
+#include <cstdlib>         // for strtod
+#include <cstring>         // for strcmp
+#include <memory>          // for shared_ptr, unique_ptr, make_unique
+#include <string>          // for string, to_string
+#include <string_view>     // for string_view
+#include <sys/socket.h>    // for socket, connect, setsockopt, AF_INET
+#include <thread>          // for thread
+#include <unistd.h>        // for close, getpid, read, write
+#include <utility>         // for pair
+#include <vector>          // for vector
+#include "CFNetwork.hpp"   // for UnexpectedError
+#include "Connection.hpp"  // for Connection
+#include "Socket.hpp"      // for Socket
+
+using namespace CFNetwork;
+
+namespace {
+  typedef std::chrono::steady_clock              Clock;
+  typedef std::vector<std::pair<const char*, double>> Fields;
+
+  /**
+   * A single measurement and the name of the workload that produced it.
+   */
+  struct Result {
+    std::string name;
+    Fields      fields;
+  };
+
+  std::vector<Result> results;
+
+  /**
+   * Records a measurement and prints it to `stderr`.
+   */
+  void record(const std::string& name, Fields fields) {
+    std::fprintf(stderr, "%-20s", name.c_str());
+    for (const auto& field : fields)
+      std::fprintf(stderr, " %s=%.6g", field.first, field.second);
+    std::fprintf(stderr, "\n");
+    results.push_back(Result{name, std::move(fields)});
+  }
+
+  /**
+   * Writes every recorded measurement as a JSON document.
+   */
+  void writeJSON(FILE* output, double scale) {
+    std::fprintf(output, "{\n  \"suite\": \"CFNetwork\",\n  \"scale\": %g,\n"
+      "  \"results\": [", scale);
+    for (size_t i = 0; i < results.size(); ++i) {
+      std::fprintf(output, "%s\n    {\"name\": \"%s\"", i ? "," : "",
+        results[i].name.c_str());
+      for (const auto& field : results[i].fields)
+        std::fprintf(output, ", \"%s\": %.10g", field.first, field.second);
+      std::fprintf(output, "}");
+    }
+    std::fprintf(output, "\n  ]\n}\n");
+  }
+
+  /**
+   * Computes the number of seconds elapsed since `start`.
+   */
+  double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  /**
+   * Creates a listening `Socket` on the first free loopback port.
+   */
+  std::unique_ptr<Socket> listen(int& port) {
+    static int next = 20000 + getpid() % 20000;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+      port = next++;
+      try {
+        return std::make_unique<Socket>("127.0.0.1", port);
+      }
+      catch (const UnexpectedError&) {}
+    }
+    throw UnexpectedError{"Couldn't find a free port for the benchmark."};
+  }
+
+  /**
+   * Connects a raw socket to the provided loopback port.
+   */
+  int dial(int port) {
+    int descriptor = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (descriptor < 0 || ::connect(descriptor, reinterpret_cast<
+        struct sockaddr*>(&address), sizeof(address)) < 0)
+      throw UnexpectedError{"Couldn't connect to the benchmark listener."};
+    return descriptor;
+  }
+
+  /**
+   * Writes all of the provided data to a raw descriptor.
+   */
+  void send(int descriptor, std::string_view data) {
+    for (size_t sent = 0; sent < data.length();) {
+      ssize_t result = ::write(descriptor, data.data() + sent,
+        data.length() - sent);
+      if (result <= 0) return;
+      sent += static_cast<size_t>(result);
+    }
+  }
+
+  /**
+   * Reads and discards the provided number of bytes from a raw descriptor.
+   */
+  void drain(int descriptor, size_t length) {
+    std::vector<char> buffer(1 << 16);
+    for (size_t received = 0; received < length;) {
+      ssize_t result = ::read(descriptor, buffer.data(), buffer.size());
+      if (result <= 0) return;
+      received += static_cast<size_t>(result);
+    }
+  }
+
+  /**
+   * Measures how quickly a `Socket` accepts clients that connect and then
+   * immediately disconnect.
+   */
+  void benchAccept(size_t count) {
+    int port = 0;
+    std::unique_ptr<Socket> socket = listen(port);
+    std::thread clients{[port, count]() {
+      for (size_t i = 0; i < count; ++i) close(dial(port));
+    }};
+    std::vector<std::shared_ptr<Connection>> accepted;
+    auto start = Clock::now();
+    size_t total = 0;
+    while (total < count) {
+      total += socket->accept(accepted);
+      accepted.clear();
+    }
+    double seconds = elapsed(start);
+    clients.join();
+    record("accept", {{"clients", count}, {"seconds", seconds},
+      {"per_second", count / seconds}});
+  }
+
+  /**
+   * Measures the throughput of `Connection::read()` using the provided
+   * request length.
+   */
+  void benchRead(size_t request_length, size_t bytes) {
+    int port = 0;
+    std::unique_ptr<Socket> socket = listen(port);
+    std::string chunk(1 << 16, 'x');
+    std::thread writer{[port, bytes, &chunk]() {
+      int descriptor = dial(port);
+      for (size_t sent = 0; sent < bytes; sent += chunk.length())
+        send(descriptor, std::string_view{chunk}.substr(0,
+          bytes - sent < chunk.length() ? bytes - sent : chunk.length()));
+      close(descriptor);
+    }};
+    std::shared_ptr<Connection> connection = socket->accept();
+    auto start = Clock::now();
+    size_t received = 0, calls = 0;
+    while (received < bytes) {
+      size_t length = connection->read(false, request_length).length();
+      if (length == 0) break;
+      received += length;
+      ++calls;
+    }
+    double seconds = elapsed(start);
+    writer.join();
+    record("read/" + std::to_string(request_length), {
+      {"request_length", request_length}, {"bytes", received},
+      {"seconds", seconds}, {"mib_per_second", received / seconds / 1048576},
+      {"calls_per_second", calls / seconds}});
+  }
+
+  /**
+   * Measures how quickly `Connection::readDelim()` extracts lines of the
+   * provided length (including the newline).
+   */
+  void benchReadDelim(size_t line_length, size_t bytes) {
+    int port = 0;
+    std::unique_ptr<Socket> socket = listen(port);
+    size_t count = bytes / line_length;
+    std::string line(line_length - 1, 'x');
+    line += '\n';
+    std::string batch;
+    for (size_t i = 0; i < (1 << 16) / line_length + 1; ++i) batch += line;
+    size_t per_batch = batch.length() / line_length;
+    std::thread writer{[port, count, per_batch, &batch, &line]() {
+      int descriptor = dial(port);
+      size_t sent = 0;
+      for (; sent + per_batch <= count; sent += per_batch)
+        send(descriptor, batch);
+      for (; sent < count; ++sent) send(descriptor, line);
+      close(descriptor);
+    }};
+    std::shared_ptr<Connection> connection = socket->accept();
+    auto start = Clock::now();
+    size_t lines = 0;
+    for (; lines < count; ++lines)
+      if (connection->readDelim().empty()) break;
+    double seconds = elapsed(start);
+    writer.join();
+    record("readDelim/" + std::to_string(line_length), {
+      {"line_length", line_length}, {"lines", lines}, {"seconds", seconds},
+      {"lines_per_second", lines / seconds},
+      {"mib_per_second", lines * line_length / seconds / 1048576}});
+  }
+
+  /**
+   * Measures how quickly `Connection::write()` sends messages of the provided
+   * length, either flushing each message (`batch` of one) or queuing `batch`
+   * messages per flush.
+   */
+  void benchWrite(size_t message_length, size_t count, size_t batch) {
+    int port = 0;
+    std::unique_ptr<Socket> socket = listen(port);
+    std::thread reader{[&socket, message_length, count]() {
+      std::shared_ptr<Connection> connection = socket->accept();
+      drain(connection->getDescriptor(), message_length * count);
+    }};
+    Connection connection{"127.0.0.1", port};
+    std::string message(message_length, 'x');
+    auto start = Clock::now();
+    for (size_t sent = 0; sent < count;) {
+      if (batch == 1) {
+        connection.write(message, false);
+        ++sent;
+        continue;
+      }
+      for (size_t i = 0; i < batch && sent < count; ++i, ++sent)
+        connection.queue(message);
+      connection.flush();
+    }
+    reader.join();
+    double seconds = elapsed(start);
+    record(std::string{batch == 1 ? "write/" : "write_batched/"} +
+      std::to_string(message_length), {{"message_length", message_length},
+      {"messages", count}, {"batch", batch}, {"seconds", seconds},
+      {"messages_per_second", count / seconds},
+      {"mib_per_second", count * message_length / seconds / 1048576}});
+  }
+
+  /**
+   * Measures the round-trip latency of a line written by a `Connection` and
+   * echoed back by a peer `Connection`.
+   */
+  void benchLatency(size_t message_length, size_t count) {
+    int port = 0;
+    std::unique_ptr<Socket> socket = listen(port);
+    std::thread echo{[&socket, count]() {
+      std::shared_ptr<Connection> connection = socket->accept();
+      int nodelay = 1;
+      setsockopt(connection->getDescriptor(), IPPROTO_TCP, TCP_NODELAY,
+        &nodelay, sizeof(nodelay));
+      for (size_t i = 0; i < count; ++i)
+        connection->write(connection->readDelim(), false);
+    }};
+    Connection connection{"127.0.0.1", port};
+    int nodelay = 1;
+    setsockopt(connection.getDescriptor(), IPPROTO_TCP, TCP_NODELAY,
+      &nodelay, sizeof(nodelay));
+    std::string message(message_length - 1, 'x');
+    std::vector<double> samples;
+    samples.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      auto start = Clock::now();
+      connection.write(message);
+      connection.readDelim();
+      samples.push_back(elapsed(start) * 1e6);
+    }
+    echo.join();
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples) total += sample;
+    auto percentile = [&samples](double rank) {
+      return samples[static_cast<size_t>(rank * (samples.size() - 1))];
+    };
+    record("latency/" + std::to_string(message_length), {
+      {"message_length", message_length}, {"round_trips", count},
+      {"mean_us", total / count}, {"p50_us", percentile(0.5)},
+      {"p90_us", percentile(0.9)}, {"p99_us", percentile(0.99)},
+      {"p999_us", percentile(0.999)}, {"max_us", samples.back()}});
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* output = nullptr;
+  double      scale  = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--output") == 0) output = argv[i + 1];
+    else if (std::strcmp(argv[i], "--scale") == 0)
+      scale = std::strtod(argv[i + 1], nullptr);
+  }
+  if (scale <= 0) scale = 1;
+  auto scaled = [scale](double count) {
+    return static_cast<size_t>(count * scale) > 0 ?
+      static_cast<size_t>(count * scale) : 1;
+  };
+
+  benchAccept(scaled(5000));
+  for (size_t length : {64, 512, 4096, 65536})
+    benchRead(length, scaled(256 << 20));
+  for (size_t length : {16, 64, 256, 1024})
+    benchReadDelim(length, scaled(64 << 20));
+  benchWrite(64, scaled(200000), 1);
+  benchWrite(64, scaled(2000000), 64);
+  benchLatency(64, scaled(20000));
+
+  FILE* file = output ? std::fopen(output, "w") : stdout;
+  if (file == nullptr) {
+    std::fprintf(stderr, "Couldn't open %s\n", output);
+    return 1;
+  }
+  writeJSON(file, scale);
+  if (file != stdout) std::fclose(file);
+  return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file      LineDrain.cpp
+ * @copyright Copyright 2016 Clay Freeman. All rights reserved
+ * @license   GNU Lesser General Public License v3 (LGPL-3.0)
+ *
+ * Measures how quickly `Connection::readDelim()` drains a large backlog of
+ * pipelined lines.
+ *
+ * The benchmark fills a `Connection` (backed by one end of a `socketpair(2)`)
+ * with a multi-megabyte backlog of fixed-length lines and then times how long
+ * it takes to extract every line, both with `readDelim()` and with the
+ * zero-copy `readDelimView()`/`consume()` pair. For comparison, the same
+ * backlog is drained using the `std::string` `find()`/`substr()`/`erase()`
+ * sequence that `Connection` previously used for its internal buffer.
+ *
+ * Usage: `LineDrain [backlog bytes] [line length]`
+ */
+
+#include <chrono>          // for steady_clock, duration
+#include <cstdio>          // for printf
+#include <cstdlib>         // for strtoul
+#include <string>          // for string
+#include <string_view>     // for string_view
+#include <sys/socket.h>    // for socketpair, AF_UNIX, SOCK_STREAM
+#include <thread>          // for thread
+#include <unistd.h>        // for write, close
+#include "Connection.hpp"  // for Connection
+
+using namespace CFNetwork;
+
+namespace {
+  /**
+   * Builds a backlog of `count` lines that are each `length` bytes long
+   * (including the trailing newline).
+   */
+  std::string makeBacklog(size_t count, size_t length) {
+    std::string line(length - 1, 'x');
+    line += '\n';
+    std::string backlog;
+    backlog.reserve(count * length);
+    for (size_t i = 0; i < count; ++i) backlog += line;
+    return backlog;
+  }
+
+  /**
+   * Drains the backlog using the previous `std::string` based algorithm.
+   */
+  size_t drainString(std::string buffer) {
+    size_t lines = 0, location;
+    while ((location = buffer.find('\n')) != std::string::npos) {
+      std::string data = buffer.substr(0, location + 1);
+      buffer.erase(0, location + 1);
+      lines += data.length() > 0;
+    }
+    return lines;
+  }
+
+  /**
+   * Drains the backlog through `Connection::readDelim()`.
+   */
+  size_t drainConnection(Connection& connection, size_t count) {
+    size_t lines = 0;
+    for (size_t i = 0; i < count; ++i)
+      lines += connection.readDelim().length() > 0;
+    return lines;
+  }
+
+  /**
+   * Drains the backlog through `Connection::readDelimView()` without copying.
+   */
+  size_t drainView(Connection& connection, size_t count) {
+    size_t lines = 0;
+    for (size_t i = 0; i < count; ++i) {
+      std::string_view line = connection.readDelimView();
+      lines += line.length() > 0;
+      connection.consume(line.length());
+    }
+    return lines;
+  }
+
+  /**
+   * Prints a single result line.
+   */
+  void report(const char* name, size_t lines, size_t bytes,
+      std::chrono::steady_clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-12s %10zu lines %10.3f ms %14.0f lines/s %10.1f MiB/s\n",
+      name, lines, seconds * 1e3, lines / seconds,
+      bytes / seconds / (1024 * 1024));
+  }
+
+  /**
+   * Loads the backlog into a `Connection` (backed by one end of a
+   * `socketpair(2)`) and times how long the provided function takes to drain
+   * it.
+   */
+  template <typename Drain>
+  void measure(const char* name, const std::string& backlog, size_t count,
+      Drain drain) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return;
+    std::thread writer{[&]() {
+      for (size_t sent = 0; sent < backlog.length();) {
+        ssize_t result = ::write(fds[1], backlog.data() + sent,
+          backlog.length() - sent);
+        if (result <= 0) break;
+        sent += static_cast<size_t>(result);
+      }
+    }};
+    Connection connection{"127.0.0.1", "127.0.0.1", 1, fds[0]};
+    connection.enqueueData(true, backlog.length());
+    writer.join();
+    close(fds[1]);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t lines = drain(connection, count);
+    report(name, lines, backlog.length(),
+      std::chrono::steady_clock::now() - start);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t bytes  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4 << 20;
+  size_t length = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+  if (length < 1) length = 1;
+  size_t count  = bytes / length;
+  std::string backlog = makeBacklog(count, length);
+
+  // Drain the backlog using the previous algorithm
+  auto start = std::chrono::steady_clock::now();
+  size_t lines = drainString(backlog);
+  report("std::string", lines, backlog.length(),
+    std::chrono::steady_clock::now() - start);
+
+  measure("Connection", backlog, count, drainConnection);
+  measure("View", backlog, count, drainView);
+  return 0;
+}